@@ -1,13 +1,17 @@
 #include <GameOfLife/Renderers/CinderRenderer.h>
 #include <GameOfLife/Renderers/CinderRenderer_Shaders.h>
 #include <GameOfLife/Renderers/FileStateRenderer.h>
+#include <GameOfLife/Hashlife.h>
+#include <GameOfLife/SparseGrid.h>
 
 #include <Utility/AlignedMemoryPool.h>
+#include <Utility/Cpu.h>
 
 #include <cinder/gl/gl.h>
 #include <cinder/app/RendererGl.h>
 
 #include <cctype>
+#include <map>
 #include <sstream>
 
 #include <windows.h>
@@ -19,10 +23,112 @@ namespace
     std::string GetUsage(const std::string& programName)
     {
         std::stringstream ss;
-        ss << "Usage: " << programName << " <filepath to initial state>" << std::endl;
+        ss << "Usage: " << programName << " [options] <filepath to initial state> [# generations] [output path]" << std::endl
+           << "Options:" << std::endl
+           << "  --engine=sparse|hashlife" << std::endl
+           << "                         Simulation engine (default: sparse). hashlife runs on" << std::endl
+           << "                         an unbounded plane rather than a torus, and ignores" << std::endl
+           << "                         --layout, --tile and --kernel" << std::endl
+           << "  --step=<k>             Advance 2^k generations per frame (default: 0)" << std::endl
+           << "  --rule=<B/S>           Life-like rule in B/S notation, e.g. B36/S23" << std::endl
+           << "                         (default: B3/S23)" << std::endl
+           << "  --layout=bits|bytes    Subgrid cell storage (default: bits)" << std::endl
+           << "  --tile=30|62|126       Subgrid width and height in cells (default: 30)" << std::endl
+           << "  --kernel=<name>        Step kernel. adder|lut with bits (default: adder)," << std::endl
+           << "                         scalar|sse2|avx2 with bytes (default: best supported)" << std::endl
+           << "  --threads=<n>          Threads stepping the sparse engine (default: one per" << std::endl
+           << "                         hardware thread)" << std::endl
+           << "  --halo=<k>             Generations the sparse engine advances per border" << std::endl
+           << "                         exchange with --step, up to 16 (default: 1)" << std::endl
+           << "  --hugepages            Back the sparse engine's cell grids with huge pages" << std::endl
+           << "                         where the OS allows. Off by default; the effect on" << std::endl
+           << "                         TLB misses is as yet unmeasured" << std::endl
+           << "  --budget=<MB>          Memory the sparse engine's tiles may take up before" << std::endl
+           << "                         the coldest are spilled to disk (default: no limit)" << std::endl
+           << "  --spill-dir=<path>     Directory for the spill file (default: the system's" << std::endl
+           << "                         temporary directory)" << std::endl;
         return ss.str();
     }
 
+    //
+    // Splits command line arguments into positional arguments and
+    // "--name=value" options.
+    //
+    void ParseArgs(
+        const std::vector<std::string>& args,
+        std::vector<std::string>& positionalOut,
+        std::map<std::string, std::string>& optionsOut
+        )
+    {
+        for (size_t i = 1; i < args.size(); i++)
+        {
+            const std::string& Arg = args[i];
+            if (Arg.compare(0, 2, "--") != 0)
+            {
+                positionalOut.push_back(Arg);
+                continue;
+            }
+
+            const size_t Equals = Arg.find('=');
+            if (Equals == std::string::npos)
+            {
+                optionsOut[Arg.substr(2)] = "";
+            }
+            else
+            {
+                optionsOut[Arg.substr(2, Equals - 2)] = Arg.substr(Equals + 1);
+            }
+        }
+    }
+
+    //
+    // Selects the step kernel named by the --kernel option. Returns false
+    // if the kernel doesn't work with the chosen layout or isn't supported
+    // by this CPU.
+    //
+    bool ParseKernel(const std::string& name, GameOfLife::CellFormat& formatInOut)
+    {
+        using namespace GameOfLife;
+        using namespace GameOfLife::Kernels;
+
+        if (formatInOut.Layout == CellLayout::BitPacked)
+        {
+            if (name == "adder")
+            {
+                formatInOut.BitKernel = BitKernelType::Adder;
+                return true;
+            }
+
+            if (name == "lut")
+            {
+                formatInOut.BitKernel = BitKernelType::LookupTable;
+                return true;
+            }
+
+            return false;
+        }
+
+        if (name == "scalar")
+        {
+            formatInOut.ByteKernel = ByteKernelType::Scalar;
+            return true;
+        }
+
+        if (name == "sse2" && Utility::CpuHasSSE2())
+        {
+            formatInOut.ByteKernel = ByteKernelType::SSE2;
+            return true;
+        }
+
+        if (name == "avx2" && Utility::CpuHasAVX2())
+        {
+            formatInOut.ByteKernel = ByteKernelType::AVX2;
+            return true;
+        }
+
+        return false;
+    }
+
     void Fail(std::ostream& stream, const std::string& string)
     {
         stream << string;
@@ -40,27 +146,54 @@ namespace GameOfLife
               m_gameState(PAUSED),
               m_countingGenerations(false),
               m_generationsRemaining(0),
-              m_memoryPool((SubGrid::SUBGRID_WIDTH + 2) * (SubGrid::SUBGRID_HEIGHT + 2), 32)
+              m_stepLog2(0)
         {}
 
-        void CinderRenderer::InitializeState(const std::vector<Cell>& cells)
+        void CinderRenderer::InitializeState(
+            const std::vector<Cell>& cells,
+            EngineType engineType,
+            int64_t tileSize,
+            const CellFormat& cellFormat,
+            size_t numThreads,
+            uint32_t haloDepth,
+            bool useHugePages,
+            const MemoryBudget& memoryBudget
+            )
         {
-            m_spState.reset(new SparseGrid(cells, m_memoryPool));
+            if (engineType == EngineType::Hashlife)
+            {
+                m_spState = CreateHashlife(cells, cellFormat.LifeRule);
+                m_isInitialized = true;
+                return;
+            }
+
+            m_spMemoryPool.reset(
+                new Utility::AlignedMemoryPool<64>(
+                    GetCellGridBufferSize(tileSize, cellFormat.Layout), 32, 2, 16, useHugePages
+                    ));
+            m_spState = CreateSparseGrid(tileSize, cells, *m_spMemoryPool, cellFormat, numThreads, haloDepth, memoryBudget);
             m_isInitialized = true;
         }
 
         void CinderRenderer::UpdateState()
         {
-            if (m_countingGenerations && !m_generationsRemaining)
+            if (m_countingGenerations && m_generationsRemaining <= 0)
             {
                 quit();
                 return;
             }
 
+            //
+            // The camera always frames the whole world, so every tile is
+            // visible; extract each one's vertices once for the frame.
+            //
+            const CoordinateType Origin(m_spState->XMin(), m_spState->YMin());
             size_t i = 0;
-            for (auto it = m_spState->begin(); it != m_spState->end(); ++it)
+            m_spState->ForEachTile([this, &i, &Origin](const Tile& tile)
             {
-                SubGridPtr spSubgrid = it->second;
+                m_vertices.clear();
+                tile.ExtractVertices(Origin, m_vertices);
+
                 if (i >= m_meshes.size())
                 {
                     std::vector<gl::VboMesh::Layout> layouts =
@@ -68,36 +201,36 @@ namespace GameOfLife
                          gl::VboMesh::Layout().usage(GL_DYNAMIC_DRAW).attrib(geom::Attrib::POSITION, 2)
                     };
 
-                    static const size_t VertexCountPerSubgrid = SubGrid::SUBGRID_WIDTH * SubGrid::SUBGRID_HEIGHT;
+                    const size_t VertexCountPerTile = static_cast<size_t>(tile.Width() * tile.Height());
                     m_meshes.push_back(
-                        gl::VboMesh::create(VertexCountPerSubgrid, GL_POINTS, layouts)
+                        gl::VboMesh::create(VertexCountPerTile, GL_POINTS, layouts)
                         );
-                    m_meshVertexCounts.push_back(spSubgrid->GetVertexData().size());
+                    m_meshVertexCounts.push_back(m_vertices.size());
                 }
                 else
                 {
-                    m_meshVertexCounts[i] = spSubgrid->GetVertexData().size();
+                    m_meshVertexCounts[i] = m_vertices.size();
                 }
 
                 auto& meshRef = m_meshes[i];
                 auto vboRefs = meshRef->getVertexArrayVbos();
                 assert(vboRefs.size() == 1);
 
-                static_assert(sizeof(SubGrid::VertexType) == sizeof(glm::fvec2), "NOPE");
+                static_assert(sizeof(VertexType) == sizeof(glm::fvec2), "NOPE");
 
                 auto vboRef = vboRefs.back();
                 vboRef->bind();
                 vboRef->bufferSubData(
                     0,
-                    sizeof(SubGrid::VertexType) * m_meshVertexCounts[i],
-                    spSubgrid->GetVertexData().data()
+                    sizeof(VertexType) * m_meshVertexCounts[i],
+                    m_vertices.data()
                     );
                 vboRef->unbind();
 
                 meshRef->updateNumVertices(m_meshVertexCounts[i]);
 
                 ++i;
-            }
+            });
 
             m_meshesToDraw = i;
 
@@ -108,7 +241,7 @@ namespace GameOfLife
 
             if (m_countingGenerations)
             {
-                m_generationsRemaining--;
+                m_generationsRemaining -= int64_t(1) << m_stepLog2;
             }
         }
 
@@ -144,12 +277,131 @@ namespace GameOfLife
             // Initialize GoL data 
             //
             const auto& args = getCommandLineArgs();
-            if (args.size() < 2)
+
+            std::vector<std::string> positional;
+            std::map<std::string, std::string> options;
+            ParseArgs(args, positional, options);
+            if (positional.empty())
+            {
+                Fail(console(), GetUsage(args[0]));
+            }
+
+            EngineType engineType = EngineType::Sparse;
+            auto engineIt = options.find("engine");
+            if (engineIt != options.end())
+            {
+                if (engineIt->second == "hashlife")
+                {
+                    engineType = EngineType::Hashlife;
+                }
+                else if (engineIt->second != "sparse")
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+            }
+
+            auto stepIt = options.find("step");
+            if (stepIt != options.end())
+            {
+                const int StepLog2 = atoi(stepIt->second.c_str());
+                if (StepLog2 < 0 || StepLog2 > 30)
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+                m_stepLog2 = static_cast<uint32_t>(StepLog2);
+            }
+
+            CellFormat cellFormat;
+            auto layoutIt = options.find("layout");
+            if (layoutIt != options.end())
+            {
+                if (layoutIt->second == "bytes")
+                {
+                    cellFormat.Layout = CellLayout::BytePerCell;
+                }
+                else if (layoutIt->second != "bits")
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+            }
+
+            int64_t tileSize = 30;
+            auto tileIt = options.find("tile");
+            if (tileIt != options.end())
+            {
+                tileSize = atoi(tileIt->second.c_str());
+                if (tileSize != 30 && tileSize != 62 && tileSize != 126)
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+            }
+
+            auto ruleIt = options.find("rule");
+            if (ruleIt != options.end())
+            {
+                try
+                {
+                    cellFormat.LifeRule = Rule::Parse(ruleIt->second);
+                }
+                catch (const std::exception& e)
+                {
+                    std::stringstream ss;
+                    ss << e.what() << std::endl << GetUsage(args[0]);
+                    Fail(console(), ss.str());
+                }
+            }
+
+            size_t numThreads = 0;
+            auto threadsIt = options.find("threads");
+            if (threadsIt != options.end())
+            {
+                const int NumThreads = atoi(threadsIt->second.c_str());
+                if (NumThreads < 1)
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+                numThreads = static_cast<size_t>(NumThreads);
+            }
+
+            uint32_t haloDepth = 1;
+            auto haloIt = options.find("halo");
+            if (haloIt != options.end())
+            {
+                const int HaloDepth = atoi(haloIt->second.c_str());
+                if (HaloDepth < 1)
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+                haloDepth = static_cast<uint32_t>(HaloDepth);
+            }
+
+            const bool UseHugePages = options.find("hugepages") != options.end();
+
+            MemoryBudget memoryBudget;
+            auto budgetIt = options.find("budget");
+            if (budgetIt != options.end())
+            {
+                const int BudgetMegabytes = atoi(budgetIt->second.c_str());
+                if (BudgetMegabytes < 1)
+                {
+                    Fail(console(), GetUsage(args[0]));
+                }
+                memoryBudget.Bytes = static_cast<size_t>(BudgetMegabytes) << 20;
+            }
+
+            auto spillDirIt = options.find("spill-dir");
+            if (spillDirIt != options.end())
+            {
+                memoryBudget.SpillDirectory = spillDirIt->second;
+            }
+
+            auto kernelIt = options.find("kernel");
+            if (kernelIt != options.end() && !ParseKernel(kernelIt->second, cellFormat))
             {
                 Fail(console(), GetUsage(args[0]));
             }
 
-            const std::string filename(args[1]);
+            const std::string filename(positional[0]);
             std::ifstream in(filename);
             if (!in.good())
             {
@@ -158,15 +410,15 @@ namespace GameOfLife
                 Fail(console(), ss.str());
             }
 
-            if (args.size() > 2)
+            if (positional.size() > 1)
             {
                 m_countingGenerations = true;
-                m_generationsRemaining = atoi(args[2].c_str());
+                m_generationsRemaining = atoi(positional[1].c_str());
             }
 
-            if (args.size() > 3)
+            if (positional.size() > 2)
             {
-                m_spFileStateRenderer.reset(new FileStateRenderer(args[3]));
+                m_spFileStateRenderer.reset(new FileStateRenderer(positional[2]));
 
                 //
                 // If we're rendering to file, this is likely a test and there's
@@ -191,7 +443,7 @@ namespace GameOfLife
                 Fail(console(), ss.str());
             }
 
-            InitializeState(cells);
+            InitializeState(cells, engineType, tileSize, cellFormat, numThreads, haloDepth, UseHugePages, memoryBudget);
 
             //
             // Set up rendering parameters, shaders, etc.
@@ -229,7 +481,7 @@ namespace GameOfLife
             }
             m_takeSingleStep = false;
 
-            m_spState->AdvanceGeneration();
+            m_spState->StepPow2(m_stepLog2);
             UpdateState();
         }
         
@@ -0,0 +1,181 @@
+#pragma once
+
+//
+// Open-addressing map from tile coordinates to tiles which many threads can
+// insert into at once, for gathering the subgrids born in a generation.
+// Every thread which asks for the same coordinates gets back the one tile
+// created for them, without taking any locks.
+//
+// Capacity is fixed between calls to Reset(), which must not race with
+// insertions.
+//
+
+#include "Tile.h"
+
+#include <Utility/Hash.h>
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <thread>
+
+namespace GameOfLife
+{
+    template <typename T>
+    class ConcurrentTileMap
+    {
+    public:
+        ConcurrentTileMap() : m_numSlots(0), m_size(0) {}
+
+        //
+        // Empties the map and makes room for at least capacity tiles.
+        //
+        void Reset(size_t capacity)
+        {
+            //
+            // Keep the load factor at or below a half so probe sequences stay
+            // short, but don't hang on to a table much bigger than needed
+            // since every slot is cleared here.
+            //
+            size_t numSlots = 16;
+            while (numSlots < capacity * 2)
+            {
+                numSlots *= 2;
+            }
+
+            if (numSlots > m_numSlots || numSlots * 4 < m_numSlots)
+            {
+                m_spSlots.reset(new Slot[numSlots]);
+                m_numSlots = numSlots;
+            }
+
+            for (size_t i = 0; i < m_numSlots; i++)
+            {
+                m_spSlots[i].State.store(SLOT_EMPTY, std::memory_order_relaxed);
+                m_spSlots[i].Value.store(nullptr, std::memory_order_relaxed);
+            }
+
+            m_size.store(0);
+        }
+
+        //
+        // Returns the tile at coordinates, calling create() to make it if
+        // there isn't one yet; insertedOut is set if this call made it. If
+        // several threads insert the same coordinates at once, exactly one of
+        // them calls create() and the rest wait for its result.
+        //
+        // Throws if the map is full or create() threw on another thread.
+        //
+        template <typename CreateFunction>
+        T* InsertIfAbsent(const CoordinateType& coordinates, CreateFunction create, bool& insertedOut)
+        {
+            const size_t Mask = m_numSlots - 1;
+            size_t index = static_cast<size_t>(Hash(coordinates)) & Mask;
+
+            for (size_t probe = 0; probe < m_numSlots; probe++, index = (index + 1) & Mask)
+            {
+                Slot& slot = m_spSlots[index];
+
+                uint32_t state = slot.State.load(std::memory_order_acquire);
+                if (state == SLOT_EMPTY)
+                {
+                    if (slot.State.compare_exchange_strong(state, SLOT_CLAIMED, std::memory_order_acq_rel))
+                    {
+                        slot.X = coordinates.first;
+                        slot.Y = coordinates.second;
+                        slot.State.store(SLOT_KEYED, std::memory_order_release);
+
+                        T* pValue = nullptr;
+                        try
+                        {
+                            pValue = create();
+                        }
+                        catch (...)
+                        {
+                            slot.State.store(SLOT_FAILED, std::memory_order_release);
+                            throw;
+                        }
+
+                        slot.Value.store(pValue, std::memory_order_release);
+                        m_size++;
+
+                        insertedOut = true;
+                        return pValue;
+                    }
+                }
+
+                //
+                // Another thread claimed the slot first; its key is only a
+                // couple of stores away.
+                //
+                while (state == SLOT_CLAIMED)
+                {
+                    std::this_thread::yield();
+                    state = slot.State.load(std::memory_order_acquire);
+                }
+
+                if (slot.X != coordinates.first || slot.Y != coordinates.second)
+                {
+                    continue;
+                }
+
+                T* pValue = slot.Value.load(std::memory_order_acquire);
+                while (!pValue)
+                {
+                    if (slot.State.load(std::memory_order_acquire) == SLOT_FAILED)
+                    {
+                        throw std::exception("Another thread failed to create the tile.");
+                    }
+
+                    std::this_thread::yield();
+                    pValue = slot.Value.load(std::memory_order_acquire);
+                }
+
+                insertedOut = false;
+                return pValue;
+            }
+
+            throw std::exception("Concurrent tile map is full.");
+        }
+
+        size_t GetSize() const { return m_size.load(); }
+
+    private:
+        ConcurrentTileMap(const ConcurrentTileMap& other) = delete;
+        ConcurrentTileMap& operator=(const ConcurrentTileMap& other) = delete;
+
+        //
+        // A slot is claimed by whichever thread swaps it out of SLOT_EMPTY,
+        // which then writes the key, marks it SLOT_KEYED and finally
+        // publishes the value.
+        //
+        enum : uint32_t
+        {
+            SLOT_EMPTY,
+            SLOT_CLAIMED,
+            SLOT_KEYED,
+            SLOT_FAILED
+        };
+
+        struct Slot
+        {
+            std::atomic<uint32_t> State;
+            int64_t               X;
+            int64_t               Y;
+            std::atomic<T*>       Value;
+        };
+
+        static uint64_t Hash(const CoordinateType& coordinates)
+        {
+            return Utility::MixBits(
+                static_cast<uint64_t>(coordinates.first) ^
+                Utility::MixBits(static_cast<uint64_t>(coordinates.second))
+                );
+        }
+
+        std::unique_ptr<Slot[]> m_spSlots;
+        size_t                  m_numSlots;
+        std::atomic<size_t>     m_size;
+    };
+}
@@ -7,10 +7,12 @@
 namespace GameOfLife
 {
     std::ofstream DebugGridDumper::s_fileStream;
+    std::mutex DebugGridDumper::s_mutex;
 
     void DebugGridDumper::OpenFile(const std::string& filename)
     {
 #if defined(DEBUG)
+        std::lock_guard<std::mutex> lock(s_mutex);
         if (!s_fileStream.is_open())
         {
             s_fileStream.open(filename);
@@ -22,13 +24,14 @@ namespace GameOfLife
     void 
     DebugGridDumper::DumpGrid(
         uint32_t generation,
-        SubGrid::CoordinateType t,
+        CoordinateType t,
         const RectangularGrid& bounds,
         uint8_t const* pBefore,
         uint8_t const* pAfter
     )
     {
 #if defined(DEBUG)
+        std::lock_guard<std::mutex> lock(s_mutex);
         assert(s_fileStream);
         s_fileStream << std::dec << generation << std::endl;
         s_fileStream << "(" << t.first << ", " << t.second << ")" << std::endl;
@@ -1,29 +1,97 @@
 #pragma once
 
 #include <fstream>
+#include <mutex>
 #include <string>
 
-#include "SubGrid.h"
+#include "RectangularGrid.h"
+#include "Tile.h"
+
+#include <Utility/Bits.h>
+
+#include <cassert>
+#include <cstdint>
 
 namespace GameOfLife
 {
     //
     // Dumps subgrid state to file for debugging. Conditioned on DEBUG
-    // compile-time flag.
+    // compile-time flag. Subgrids are stepped on several threads, so writes
+    // are serialized.
     //
     class DebugGridDumper
     {
     public:
         static void OpenFile(const std::string& filename);
+        //
+        // Overloads for byte-per-cell and bit-packed cell grids, respectively.
+        // The latter is templated on the row word, which depends on the
+        // subgrid width.
+        //
         static void DumpGrid(
             uint32_t generation,
-            SubGrid::CoordinateType t,
+            CoordinateType t,
             const RectangularGrid& bounds,
             uint8_t const* pBefore,
             uint8_t const* pAfter
         );
 
+        template <typename RowType>
+        static void DumpGrid(
+            uint32_t generation,
+            CoordinateType t,
+            const RectangularGrid& bounds,
+            RowType const* pBefore,
+            RowType const* pAfter
+        );
+
     private:
         static std::ofstream s_fileStream;
+        static std::mutex s_mutex;
     };
+
+    template <typename RowType>
+    void
+    DebugGridDumper::DumpGrid(
+        uint32_t generation,
+        CoordinateType t,
+        const RectangularGrid& bounds,
+        RowType const* pBefore,
+        RowType const* pAfter
+    )
+    {
+#if defined(DEBUG)
+        std::lock_guard<std::mutex> lock(s_mutex);
+        assert(s_fileStream);
+        s_fileStream << std::dec << generation << std::endl;
+        s_fileStream << "(" << t.first << ", " << t.second << ")" << std::endl;
+
+        const int64_t MaxRow = bounds.Height() + 2;
+        const int64_t MaxCol = bounds.Width() + 2;
+        for (int64_t row = 0; row < MaxRow; row++)
+        {
+            for (int64_t col = 0; col < MaxCol; col++)
+            {
+                s_fileStream << std::hex << Utility::TestBit(pBefore[row], static_cast<uint32_t>(col));
+                if (col < MaxCol - 1)
+                {
+                    s_fileStream << ",";
+                }
+            }
+
+            s_fileStream << " ";
+
+            for (int64_t col = 0; col < MaxCol; col++)
+            {
+                s_fileStream << std::hex << Utility::TestBit(pAfter[row], static_cast<uint32_t>(col));
+                if (col < MaxCol - 1)
+                {
+                    s_fileStream << ",";
+                }
+            }
+
+            s_fileStream << std::endl;
+        }
+#endif
+    }
 }
@@ -0,0 +1,64 @@
+#include "Engine.h"
+
+#include <string>
+#include <vector>
+
+namespace GameOfLife
+{
+    bool Engine::StepPow2(uint32_t k)
+    {
+        const uint64_t Generations = uint64_t(1) << k;
+        for (uint64_t i = 0; i < Generations; i++)
+        {
+            if (!AdvanceGeneration())
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::ostream& operator<<(std::ostream& out, const Engine& engine)
+    {
+        out << "(" << engine.XMin() << "," << engine.YMin() << "," << engine.Width() << "," << engine.Height() << ")\n"
+            << engine.GetGeneration() << "\n"
+            << engine.GetTileCount() << "\n";
+
+        std::vector<VertexType> vertices;
+        std::string text;
+        engine.ForEachTile([&out, &vertices, &text](const Tile& tile)
+        {
+            out << "(" << tile.XMin() << "," << tile.YMin() << "," << tile.Width() << "," << tile.Height() << ")\n";
+
+            //
+            // Every cell is written as "0," or "1,", with the last comma in
+            // each row a newline instead. Start with every cell dead and mark
+            // the living ones, with vertices relative to the tile.
+            //
+            const size_t RowLength = 2 * static_cast<size_t>(tile.Width());
+            text.assign(RowLength * static_cast<size_t>(tile.Height()), ',');
+            for (size_t i = 0; i < text.size(); i += 2)
+            {
+                text[i] = '0';
+            }
+
+            for (size_t i = RowLength - 1; i < text.size(); i += RowLength)
+            {
+                text[i] = '\n';
+            }
+
+            vertices.clear();
+            tile.ExtractVertices(CoordinateType(tile.XMin(), tile.YMin()), vertices);
+            for (const VertexType& vertex : vertices)
+            {
+                text[static_cast<size_t>(vertex.Y) * RowLength + 2 * static_cast<size_t>(vertex.X)] = '1';
+            }
+
+            out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        });
+        out.flush();
+
+        return out;
+    }
+}
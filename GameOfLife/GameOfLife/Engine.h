@@ -0,0 +1,59 @@
+#pragma once
+
+//
+// Common interface to the game state, whatever its tile dimensions or the
+// algorithm used to advance it.
+//
+
+#include "RectangularGrid.h"
+#include "Tile.h"
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+
+namespace GameOfLife
+{
+    //
+    // Available engines. Sparse is SparseGrid, stepping tiles of a torus
+    // one generation at a time; Hashlife memoizes a quadtree of the plane.
+    //
+    enum class EngineType
+    {
+        Sparse,
+        Hashlife
+    };
+
+    class Engine : public RectangularGrid
+    {
+    public:
+        virtual ~Engine() {}
+
+        virtual bool AdvanceGeneration() = 0;
+
+        //
+        // Advances 2^k generations. Engines which can skip ahead override
+        // this; by default it just calls AdvanceGeneration() 2^k times.
+        //
+        virtual bool StepPow2(uint32_t k);
+
+        virtual uint32_t GetGeneration() const = 0;
+
+        //
+        // Number of tiles ForEachTile() visits.
+        //
+        virtual size_t GetTileCount() const = 0;
+
+        //
+        // Visits every tile holding cells of the current generation. Tile
+        // references are only valid for the duration of the call.
+        //
+        virtual void ForEachTile(const std::function<void(const Tile&)>& visitor) const = 0;
+
+        //
+        // Outputs the world bounds, generation and tile count, followed by
+        // the bounds and cell states of every tile.
+        //
+        friend std::ostream& operator<<(std::ostream& out, const Engine& engine);
+    };
+}
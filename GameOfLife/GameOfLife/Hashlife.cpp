@@ -0,0 +1,730 @@
+#include "Hashlife.h"
+#include "SubGrid.h"
+#include "Kernels/BitKernels.h"
+#include "Kernels/VertexKernels.h"
+
+#include <Utility/Bits.h>
+#include <Utility/Hash.h>
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+namespace
+{
+    //
+    // Child indices within a node.
+    //
+    enum Quadrant
+    {
+        NW,
+        NE,
+        SW,
+        SE
+    };
+
+    //
+    // A tile rasterized from the quadtree, handed to ForEachTile() visitors.
+    //
+    class BitmapTile : public GameOfLife::Tile
+    {
+    public:
+        static const int64_t SIZE = GameOfLife::Hashlife::TILE_SIZE;
+
+        BitmapTile(int64_t xMin, int64_t yMin, uint64_t const* pRows)
+            : Tile(xMin, SIZE, yMin, SIZE)
+        {
+            std::copy(pRows, pRows + SIZE, m_rows);
+        }
+
+        bool GetCellState(int64_t x, int64_t y) const override
+        {
+            assert(x >= m_xMin && x < m_xMin + SIZE);
+            assert(y >= m_yMin && y < m_yMin + SIZE);
+
+            return Utility::TestBit(m_rows[y - m_yMin], static_cast<uint32_t>(x - m_xMin));
+        }
+
+        void ExtractVertices(
+            const GameOfLife::CoordinateType& origin,
+            std::vector<GameOfLife::VertexType>& vertices
+            ) const override
+        {
+            size_t count = 0;
+            for (int64_t row = 0; row < SIZE; row++)
+            {
+                count += Utility::PopCount(m_rows[row]);
+            }
+
+            const size_t First = vertices.size();
+            vertices.resize(First + count + GameOfLife::Kernels::VERTEX_EXTRACT_SLACK, GameOfLife::VertexType(0, 0));
+
+            const float X = static_cast<float>(m_xMin - origin.first);
+            GameOfLife::VertexType* pVertices = vertices.data() + First;
+            for (int64_t row = 0; row < SIZE; row++)
+            {
+                const float Y = static_cast<float>(m_yMin + row - origin.second);
+                pVertices += GameOfLife::Kernels::ExtractBits(m_rows[row], X, Y, pVertices);
+            }
+
+            vertices.resize(First + count, GameOfLife::VertexType(0, 0));
+        }
+
+    private:
+        uint64_t m_rows[SIZE];
+    };
+
+    static_assert(
+        BitmapTile::SIZE == 64,
+        "Tile rows are rasterized into 64-bit words."
+        );
+}
+
+namespace GameOfLife
+{
+    struct Hashlife::Node
+    {
+        //
+        // Quadrants, indexed by Quadrant. Null for the two leaves, which are
+        // single cells.
+        //
+        Node* pChildren[4];
+
+        //
+        // Next node in the same cache bucket, or in the free list.
+        //
+        Node* pNext;
+
+        //
+        // Memoized center of this node, 2^ResultStep generations in the
+        // future. Null until first computed.
+        //
+        Node* pResult;
+
+        uint64_t Population;
+
+        //
+        // Nodes are 2^Level cells on a side.
+        //
+        uint32_t Level;
+        uint32_t ResultStep;
+
+        //
+        // Reachability flag for garbage collection.
+        //
+        bool IsMarked;
+    };
+
+    class Hashlife::NodeCache
+    {
+    public:
+        NodeCache() : m_pFreeList(nullptr), m_blockUsed(0), m_buckets(INITIAL_BUCKET_COUNT), m_size(0)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                Node& leaf = m_leaves[i];
+                std::fill(leaf.pChildren, leaf.pChildren + 4, nullptr);
+                leaf.pNext = nullptr;
+                leaf.pResult = nullptr;
+                leaf.Population = i;
+                leaf.Level = 0;
+                leaf.ResultStep = 0;
+
+                //
+                // Leaves aren't cached, so they're never collected.
+                //
+                leaf.IsMarked = true;
+            }
+
+            m_emptyNodes.push_back(&m_leaves[0]);
+        }
+
+        Node* GetLeaf(bool isAlive) { return &m_leaves[isAlive ? 1 : 0]; }
+
+        //
+        // The canonical empty node 2^level cells on a side.
+        //
+        Node* GetEmpty(uint32_t level)
+        {
+            while (m_emptyNodes.size() <= level)
+            {
+                Node* pEmpty = m_emptyNodes.back();
+                m_emptyNodes.push_back(Find(pEmpty, pEmpty, pEmpty, pEmpty));
+            }
+
+            return m_emptyNodes[level];
+        }
+
+        //
+        // Returns the canonical node with the given quadrants, creating it
+        // if this is the first time it's been asked for.
+        //
+        Node* Find(Node* pNW, Node* pNE, Node* pSW, Node* pSE)
+        {
+            assert(pNW->Level == pNE->Level && pNW->Level == pSW->Level && pNW->Level == pSE->Level);
+
+            Node*& pBucket = m_buckets[Hash(pNW, pNE, pSW, pSE) & (m_buckets.size() - 1)];
+            for (Node* pNode = pBucket; pNode; pNode = pNode->pNext)
+            {
+                if (pNode->pChildren[NW] == pNW && pNode->pChildren[NE] == pNE &&
+                    pNode->pChildren[SW] == pSW && pNode->pChildren[SE] == pSE)
+                {
+                    return pNode;
+                }
+            }
+
+            Node* pNode = AllocateNode();
+            pNode->pChildren[NW] = pNW;
+            pNode->pChildren[NE] = pNE;
+            pNode->pChildren[SW] = pSW;
+            pNode->pChildren[SE] = pSE;
+            pNode->pResult = nullptr;
+            pNode->Population = pNW->Population + pNE->Population + pSW->Population + pSE->Population;
+            pNode->Level = pNW->Level + 1;
+            pNode->ResultStep = 0;
+            pNode->IsMarked = false;
+
+            pNode->pNext = pBucket;
+            pBucket = pNode;
+
+            if (++m_size > m_buckets.size())
+            {
+                Rehash(m_buckets.size() * 2);
+            }
+
+            return pNode;
+        }
+
+        //
+        // The center of pNode, one level down.
+        //
+        Node* GetCenter(Node const* pNode)
+        {
+            Node* const* ppChildren = pNode->pChildren;
+            return Find(
+                ppChildren[NW]->pChildren[SE], ppChildren[NE]->pChildren[SW],
+                ppChildren[SW]->pChildren[NE], ppChildren[SE]->pChildren[NW]
+                );
+        }
+
+        size_t GetSize() const { return m_size; }
+
+        //
+        // Frees every node not reachable from pRoot, along with memoized
+        // results which refer to freed nodes.
+        //
+        void Collect(Node* pRoot)
+        {
+            Mark(pRoot);
+            for (Node* pEmpty : m_emptyNodes)
+            {
+                Mark(pEmpty);
+            }
+
+            for (Node*& pBucket : m_buckets)
+            {
+                Node** ppNode = &pBucket;
+                while (*ppNode)
+                {
+                    Node* pNode = *ppNode;
+                    if (pNode->IsMarked)
+                    {
+                        ppNode = &pNode->pNext;
+                        continue;
+                    }
+
+                    *ppNode = pNode->pNext;
+                    pNode->pResult = nullptr;
+                    pNode->pNext = m_pFreeList;
+                    m_pFreeList = pNode;
+                    --m_size;
+                }
+            }
+
+            //
+            // Freed nodes stay unmarked until they're handed out again, so
+            // check results against the marks before clearing them.
+            //
+            ForEachNode([](Node* pNode)
+            {
+                if (pNode->pResult && !pNode->pResult->IsMarked)
+                {
+                    pNode->pResult = nullptr;
+                }
+            });
+
+            ForEachNode([](Node* pNode) { pNode->IsMarked = false; });
+        }
+
+    private:
+        static const size_t INITIAL_BUCKET_COUNT = 1 << 16;
+        static const size_t NODES_PER_BLOCK = 1 << 14;
+
+        static size_t Hash(Node const* pNW, Node const* pNE, Node const* pSW, Node const* pSE)
+        {
+            size_t seed = 0;
+            Utility::hash_combine(seed, pNW);
+            Utility::hash_combine(seed, pNE);
+            Utility::hash_combine(seed, pSW);
+            Utility::hash_combine(seed, pSE);
+            return seed;
+        }
+
+        Node* AllocateNode()
+        {
+            if (m_pFreeList)
+            {
+                Node* pNode = m_pFreeList;
+                m_pFreeList = pNode->pNext;
+                return pNode;
+            }
+
+            if (m_blocks.empty() || m_blockUsed == NODES_PER_BLOCK)
+            {
+                m_blocks.emplace_back(new Node[NODES_PER_BLOCK]);
+                m_blockUsed = 0;
+            }
+
+            return &m_blocks.back()[m_blockUsed++];
+        }
+
+        void Rehash(size_t bucketCount)
+        {
+            assert(!(bucketCount & (bucketCount - 1)));
+
+            std::vector<Node*> buckets(bucketCount);
+            for (Node* pBucket : m_buckets)
+            {
+                Node* pNode = pBucket;
+                while (pNode)
+                {
+                    Node* pNext = pNode->pNext;
+
+                    Node*& pNewBucket = buckets[
+                        Hash(pNode->pChildren[NW], pNode->pChildren[NE], pNode->pChildren[SW], pNode->pChildren[SE]) &
+                        (bucketCount - 1)
+                        ];
+                    pNode->pNext = pNewBucket;
+                    pNewBucket = pNode;
+
+                    pNode = pNext;
+                }
+            }
+
+            m_buckets.swap(buckets);
+        }
+
+        void Mark(Node* pNode)
+        {
+            if (pNode->IsMarked)
+            {
+                return;
+            }
+
+            pNode->IsMarked = true;
+            for (Node* pChild : pNode->pChildren)
+            {
+                Mark(pChild);
+            }
+        }
+
+        template <typename Visitor>
+        void ForEachNode(Visitor visitor)
+        {
+            for (Node* pBucket : m_buckets)
+            {
+                for (Node* pNode = pBucket; pNode; pNode = pNode->pNext)
+                {
+                    visitor(pNode);
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Node[]>> m_blocks;
+        Node* m_pFreeList;
+
+        //
+        // Nodes handed out from the most recent block.
+        //
+        size_t m_blockUsed;
+
+        //
+        // Hash buckets; always a power of two in size.
+        //
+        std::vector<Node*> m_buckets;
+        size_t m_size;
+
+        //
+        // Dead and living single cells.
+        //
+        Node m_leaves[2];
+
+        //
+        // Canonical empty node per level.
+        //
+        std::vector<Node*> m_emptyNodes;
+    };
+
+    Hashlife::Hashlife(
+        const std::vector<Cell>& initialCells,
+        const Rule& rule,
+        size_t maxNodes
+    ) : m_spCache(new NodeCache),
+        m_generation(0),
+        m_maxNodes(maxNodes),
+        m_pLookupTable(Kernels::GetLifeLookupTable(rule))
+    {
+        assert(!initialCells.empty());
+
+        int64_t xMin = std::numeric_limits<int64_t>::max();
+        int64_t xMax = std::numeric_limits<int64_t>::min();
+        int64_t yMin = std::numeric_limits<int64_t>::max();
+        int64_t yMax = std::numeric_limits<int64_t>::min();
+
+        for (const Cell& cell : initialCells)
+        {
+            if (cell.X < xMin) { xMin = cell.X; }
+            if (cell.X > xMax) { xMax = cell.X; }
+            if (cell.Y < yMin) { yMin = cell.Y; }
+            if (cell.Y > yMax) { yMax = cell.Y; }
+        }
+
+        //
+        // World bounds are only used for rendering, but snap them to tiles
+        // the same way SparseGrid does so both engines frame a pattern
+        // identically.
+        //
+        m_xMin   = SnapCoordinateToSubgridCorner<TILE_SIZE>(xMin);
+        m_yMin   = SnapCoordinateToSubgridCorner<TILE_SIZE>(yMin);
+        m_width  = SnapCoordinateToSubgridCorner<TILE_SIZE>(xMax) + TILE_SIZE - m_xMin;
+        m_height = SnapCoordinateToSubgridCorner<TILE_SIZE>(yMax) + TILE_SIZE - m_yMin;
+
+        m_pRoot = m_spCache->GetEmpty(TILE_LEVEL);
+        m_originX = m_xMin;
+        m_originY = m_yMin;
+        while (xMax - m_originX >= (int64_t(1) << m_pRoot->Level) ||
+               yMax - m_originY >= (int64_t(1) << m_pRoot->Level))
+        {
+            Expand();
+        }
+
+        for (const Cell& cell : initialCells)
+        {
+            m_pRoot = RaiseCell(m_pRoot, cell.X - m_originX, cell.Y - m_originY);
+        }
+    }
+
+    //
+    // For NodeCache
+    //
+    Hashlife::~Hashlife() = default;
+
+    bool Hashlife::AdvanceGeneration()
+    {
+        return StepPow2(0);
+    }
+
+    bool Hashlife::StepPow2(uint32_t k)
+    {
+        //
+        // The root grows to at least k + 3 levels below, and its
+        // coordinates have to fit in world space.
+        //
+        if (k > 60)
+        {
+            throw std::exception("Step size too large.");
+        }
+
+        //
+        // The center of the root after 2^k generations only depends on
+        // cells within 2^k of it, so make sure every living cell is that
+        // far from the edges before stepping or they'd be lost.
+        //
+        while (m_pRoot->Level < k + 3 || !IsCentered())
+        {
+            Expand();
+        }
+
+        const int64_t Offset = int64_t(1) << (m_pRoot->Level - 2);
+        m_pRoot = Step(m_pRoot, k);
+        m_originX += Offset;
+        m_originY += Offset;
+        m_generation += uint64_t(1) << k;
+
+        Compact();
+
+        if (m_spCache->GetSize() > m_maxNodes)
+        {
+            m_spCache->Collect(m_pRoot);
+        }
+
+        return true;
+    }
+
+    size_t Hashlife::GetTileCount() const
+    {
+        return CountTiles(m_pRoot);
+    }
+
+    void Hashlife::ForEachTile(const std::function<void(const Tile&)>& visitor) const
+    {
+        VisitTiles(m_pRoot, m_originX, m_originY, visitor);
+    }
+
+    uint64_t Hashlife::GetPopulation() const
+    {
+        return m_pRoot->Population;
+    }
+
+    size_t Hashlife::GetNodeCount() const
+    {
+        return m_spCache->GetSize();
+    }
+
+    void Hashlife::Expand()
+    {
+        NodeCache& cache = *m_spCache;
+
+        const uint32_t Level = m_pRoot->Level;
+        Node* pEmpty = cache.GetEmpty(Level - 1);
+        Node* const* ppChildren = m_pRoot->pChildren;
+
+        m_pRoot = cache.Find(
+            cache.Find(pEmpty, pEmpty, pEmpty, ppChildren[NW]),
+            cache.Find(pEmpty, pEmpty, ppChildren[NE], pEmpty),
+            cache.Find(pEmpty, ppChildren[SW], pEmpty, pEmpty),
+            cache.Find(ppChildren[SE], pEmpty, pEmpty, pEmpty)
+            );
+
+        const int64_t Offset = int64_t(1) << (Level - 1);
+        m_originX -= Offset;
+        m_originY -= Offset;
+    }
+
+    void Hashlife::Compact()
+    {
+        while (m_pRoot->Level < TILE_LEVEL)
+        {
+            Expand();
+        }
+
+        while (m_pRoot->Level > TILE_LEVEL)
+        {
+            Node* pCenter = m_spCache->GetCenter(m_pRoot);
+            if (pCenter->Population != m_pRoot->Population)
+            {
+                break;
+            }
+
+            const int64_t Offset = int64_t(1) << (m_pRoot->Level - 2);
+            m_pRoot = pCenter;
+            m_originX += Offset;
+            m_originY += Offset;
+        }
+    }
+
+    bool Hashlife::IsCentered() const
+    {
+        Node* const* ppChildren = m_pRoot->pChildren;
+        const uint64_t CenterPopulation =
+            ppChildren[NW]->pChildren[SE]->pChildren[SE]->Population +
+            ppChildren[NE]->pChildren[SW]->pChildren[SW]->Population +
+            ppChildren[SW]->pChildren[NE]->pChildren[NE]->Population +
+            ppChildren[SE]->pChildren[NW]->pChildren[NW]->Population;
+
+        return CenterPopulation == m_pRoot->Population;
+    }
+
+    Hashlife::Node* Hashlife::Step(Node* pNode, uint32_t k)
+    {
+        assert(pNode->Level >= 2);
+
+        NodeCache& cache = *m_spCache;
+        if (!pNode->Population)
+        {
+            return cache.GetEmpty(pNode->Level - 1);
+        }
+
+        const uint32_t StepLog2 = std::min(k, pNode->Level - 2);
+        if (pNode->pResult && pNode->ResultStep == StepLog2)
+        {
+            return pNode->pResult;
+        }
+
+        Node* pResult;
+        if (pNode->Level == 2)
+        {
+            //
+            // 4x4 cells; look the center 2x2 up in the same table the
+            // bit-packed SubGrid kernel uses.
+            //
+            uint32_t index = 0;
+            for (int quadrant = 0; quadrant < 4; quadrant++)
+            {
+                for (int cell = 0; cell < 4; cell++)
+                {
+                    if (pNode->pChildren[quadrant]->pChildren[cell]->Population)
+                    {
+                        const int x = (quadrant & 1) * 2 + (cell & 1);
+                        const int y = (quadrant >> 1) * 2 + (cell >> 1);
+                        index |= 1 << (4 * y + x);
+                    }
+                }
+            }
+
+            const uint8_t Next = m_pLookupTable[index];
+            pResult = cache.Find(
+                cache.GetLeaf(!!(Next & 1)), cache.GetLeaf(!!(Next & 2)),
+                cache.GetLeaf(!!(Next & 4)), cache.GetLeaf(!!(Next & 8))
+                );
+        }
+        else
+        {
+            //
+            // Split the node into nine overlapping subnodes half its size,
+            // reduce each to its center (stepping it if we're going at full
+            // speed), then step the four overlapping quadrants of those.
+            //
+            Node* const* ppChildren = pNode->pChildren;
+            Node* const* pNW = ppChildren[NW]->pChildren;
+            Node* const* pNE = ppChildren[NE]->pChildren;
+            Node* const* pSW = ppChildren[SW]->pChildren;
+            Node* const* pSE = ppChildren[SE]->pChildren;
+
+            Node* subnodes[3][3] =
+            {
+                {
+                    ppChildren[NW],
+                    cache.Find(pNW[NE], pNE[NW], pNW[SE], pNE[SW]),
+                    ppChildren[NE]
+                },
+                {
+                    cache.Find(pNW[SW], pNW[SE], pSW[NW], pSW[NE]),
+                    cache.Find(pNW[SE], pNE[SW], pSW[NE], pSE[NW]),
+                    cache.Find(pNE[SW], pNE[SE], pSE[NW], pSE[NE])
+                },
+                {
+                    ppChildren[SW],
+                    cache.Find(pSW[NE], pSE[NW], pSW[SE], pSE[SW]),
+                    ppChildren[SE]
+                }
+            };
+
+            const bool IsFullStep = StepLog2 == pNode->Level - 2;
+            for (auto& row : subnodes)
+            {
+                for (Node*& pSubnode : row)
+                {
+                    pSubnode = IsFullStep ? Step(pSubnode, k) : cache.GetCenter(pSubnode);
+                }
+            }
+
+            pResult = cache.Find(
+                Step(cache.Find(subnodes[0][0], subnodes[0][1], subnodes[1][0], subnodes[1][1]), k),
+                Step(cache.Find(subnodes[0][1], subnodes[0][2], subnodes[1][1], subnodes[1][2]), k),
+                Step(cache.Find(subnodes[1][0], subnodes[1][1], subnodes[2][0], subnodes[2][1]), k),
+                Step(cache.Find(subnodes[1][1], subnodes[1][2], subnodes[2][1], subnodes[2][2]), k)
+                );
+        }
+
+        pNode->pResult = pResult;
+        pNode->ResultStep = StepLog2;
+        return pResult;
+    }
+
+    Hashlife::Node* Hashlife::RaiseCell(Node* pNode, int64_t x, int64_t y)
+    {
+        if (!pNode->Level)
+        {
+            return m_spCache->GetLeaf(true);
+        }
+
+        const int64_t Half = int64_t(1) << (pNode->Level - 1);
+        const int Index = (y >= Half ? SW : NW) + (x >= Half ? 1 : 0);
+
+        Node* children[4];
+        std::copy(pNode->pChildren, pNode->pChildren + 4, children);
+        children[Index] = RaiseCell(
+            children[Index],
+            x >= Half ? x - Half : x,
+            y >= Half ? y - Half : y
+            );
+
+        return m_spCache->Find(children[NW], children[NE], children[SW], children[SE]);
+    }
+
+    size_t Hashlife::CountTiles(Node const* pNode) const
+    {
+        if (!pNode->Population)
+        {
+            return 0;
+        }
+
+        if (pNode->Level == TILE_LEVEL)
+        {
+            return 1;
+        }
+
+        size_t count = 0;
+        for (Node const* pChild : pNode->pChildren)
+        {
+            count += CountTiles(pChild);
+        }
+
+        return count;
+    }
+
+    void Hashlife::VisitTiles(
+        Node const* pNode, int64_t x, int64_t y,
+        const std::function<void(const Tile&)>& visitor
+        ) const
+    {
+        if (!pNode->Population)
+        {
+            return;
+        }
+
+        if (pNode->Level == TILE_LEVEL)
+        {
+            uint64_t rows[TILE_SIZE] = {};
+            RasterizeTile(pNode, 0, 0, rows);
+            visitor(BitmapTile(x, y, rows));
+            return;
+        }
+
+        const int64_t Half = int64_t(1) << (pNode->Level - 1);
+        VisitTiles(pNode->pChildren[NW], x,        y,        visitor);
+        VisitTiles(pNode->pChildren[NE], x + Half, y,        visitor);
+        VisitTiles(pNode->pChildren[SW], x,        y + Half, visitor);
+        VisitTiles(pNode->pChildren[SE], x + Half, y + Half, visitor);
+    }
+
+    void Hashlife::RasterizeTile(Node const* pNode, int64_t x, int64_t y, uint64_t* pRows)
+    {
+        if (!pNode->Population)
+        {
+            return;
+        }
+
+        if (!pNode->Level)
+        {
+            pRows[y] |= uint64_t(1) << x;
+            return;
+        }
+
+        const int64_t Half = int64_t(1) << (pNode->Level - 1);
+        RasterizeTile(pNode->pChildren[NW], x,        y,        pRows);
+        RasterizeTile(pNode->pChildren[NE], x + Half, y,        pRows);
+        RasterizeTile(pNode->pChildren[SW], x,        y + Half, pRows);
+        RasterizeTile(pNode->pChildren[SE], x + Half, y + Half, pRows);
+    }
+
+    std::unique_ptr<Engine> CreateHashlife(
+        const std::vector<Cell>& initialState,
+        const Rule& rule,
+        size_t maxNodes
+    )
+    {
+        return std::unique_ptr<Engine>(new Hashlife(initialState, rule, maxNodes));
+    }
+}
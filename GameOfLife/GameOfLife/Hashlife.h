@@ -0,0 +1,152 @@
+#pragma once
+
+//
+// Hashlife engine. The state is a quadtree whose nodes are hash-consed, so
+// identical regions anywhere in space or time share a single node, and the
+// future of every node is memoized on the node itself. Repetitive patterns
+// can then be advanced 2^k generations for roughly the cost of one.
+//
+// Unlike SparseGrid, the universe is an unbounded plane rather than a
+// torus. The world bounds only describe the initial pattern, for the
+// renderers' benefit; cells leaving them are still simulated.
+//
+
+#include "Engine.h"
+#include "Cell.h"
+#include "Rule.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace GameOfLife
+{
+    class Hashlife : public Engine
+    {
+    public:
+        //
+        // Upper bound on the number of nodes kept in the canonical node
+        // cache before garbage collecting. Nodes are 64-ish bytes, so this is
+        // a few hundred megabytes.
+        //
+        static const size_t DEFAULT_MAX_NODES = 1 << 22;
+
+        //
+        // ForEachTile() visits square tiles 2^TILE_LEVEL cells on a side.
+        //
+        static const uint32_t TILE_LEVEL = 6;
+        static const int64_t TILE_SIZE = 1 << TILE_LEVEL;
+
+        Hashlife(
+            const std::vector<Cell>& initialState,
+            const Rule& rule = Rule(),
+            size_t maxNodes = DEFAULT_MAX_NODES
+            );
+        ~Hashlife();
+
+        bool AdvanceGeneration() override;
+
+        //
+        // Advances 2^k generations in a single step.
+        //
+        bool StepPow2(uint32_t k) override;
+
+        uint32_t GetGeneration() const override { return static_cast<uint32_t>(m_generation); }
+
+        size_t GetTileCount() const override;
+
+        void ForEachTile(const std::function<void(const Tile&)>& visitor) const override;
+
+        uint64_t GetPopulation() const;
+
+        //
+        // Number of nodes currently held in the canonical node cache.
+        //
+        size_t GetNodeCount() const;
+
+    private:
+        Hashlife() = delete;
+        Hashlife(const Hashlife& other) = delete;
+        Hashlife& operator=(const Hashlife& other) = delete;
+
+        struct Node;
+
+        //
+        // Owns every node and hands out the canonical node for a given set
+        // of children. Lives in Hashlife.cpp.
+        //
+        class NodeCache;
+
+        //
+        // Grows the root by one level, keeping the current root centered.
+        //
+        void Expand();
+
+        //
+        // Shrinks the root while all living cells fit in its center, but
+        // never below TILE_LEVEL.
+        //
+        void Compact();
+
+        //
+        // True if all living cells lie within the center quarter of the root,
+        // i.e. the middle 2^(level - 2) cells on each axis.
+        //
+        bool IsCentered() const;
+
+        //
+        // Returns the center level - 1 node of pNode advanced
+        // 2^min(k, level - 2) generations. pNode must be level 2 or above.
+        //
+        Node* Step(Node* pNode, uint32_t k);
+
+        //
+        // Returns a copy of pNode, which is 2^level cells on a side, with
+        // the cell at (x, y) relative to its upper-left corner raised.
+        //
+        Node* RaiseCell(Node* pNode, int64_t x, int64_t y);
+
+        size_t CountTiles(Node const* pNode) const;
+        void VisitTiles(
+            Node const* pNode, int64_t x, int64_t y,
+            const std::function<void(const Tile&)>& visitor
+            ) const;
+
+        //
+        // Sets a bit in pRows for every living cell of pNode, whose
+        // upper-left corner is at (x, y) within a TILE_SIZE square tile.
+        //
+        static void RasterizeTile(Node const* pNode, int64_t x, int64_t y, uint64_t* pRows);
+
+        std::unique_ptr<NodeCache> m_spCache;
+
+        Node* m_pRoot;
+
+        //
+        // World space coordinates of the root's upper-left corner.
+        //
+        int64_t m_originX;
+        int64_t m_originY;
+
+        uint64_t m_generation;
+
+        //
+        // Node count past which the cache is garbage collected.
+        //
+        size_t m_maxNodes;
+
+        //
+        // The rule's 4x4 lookup table, which steps level 2 nodes.
+        //
+        const uint8_t* m_pLookupTable;
+    };
+
+    //
+    // Creates a Hashlife engine, for choosing between engines at runtime.
+    //
+    std::unique_ptr<Engine> CreateHashlife(
+        const std::vector<Cell>& initialState,
+        const Rule& rule = Rule(),
+        size_t maxNodes = Hashlife::DEFAULT_MAX_NODES
+        );
+}
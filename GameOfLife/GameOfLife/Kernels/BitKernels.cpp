@@ -0,0 +1,78 @@
+#include "BitKernels.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace
+{
+    const uint32_t LOOKUP_TABLE_SIZE = 1 << 16;
+
+    bool GetBlockCell(uint32_t block, int x, int y)
+    {
+        return !!((block >> (4 * y + x)) & 1);
+    }
+
+    void BuildLifeLookupTable(const GameOfLife::Rule& rule, uint8_t* pTable)
+    {
+        for (uint32_t block = 0; block < LOOKUP_TABLE_SIZE; block++)
+        {
+            uint8_t next = 0;
+            for (int y = 1; y <= 2; y++)
+            {
+                for (int x = 1; x <= 2; x++)
+                {
+                    uint32_t numNeighbors = 0;
+                    for (int dy = -1; dy <= 1; dy++)
+                    {
+                        for (int dx = -1; dx <= 1; dx++)
+                        {
+                            if ((dx || dy) && GetBlockCell(block, x + dx, y + dy))
+                            {
+                                ++numNeighbors;
+                            }
+                        }
+                    }
+
+                    const bool IsAlive =
+                        rule.IsAliveNext(GetBlockCell(block, x, y), numNeighbors);
+
+                    if (IsAlive)
+                    {
+                        next |= 1 << (2 * (y - 1) + (x - 1));
+                    }
+                }
+            }
+
+            pTable[block] = next;
+        }
+    }
+}
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        const uint8_t* GetLifeLookupTable(const Rule& rule)
+        {
+            //
+            // Callers hang on to the table, so this is only hit when a
+            // subgrid or engine is created.
+            //
+            static std::mutex s_lock;
+            static std::map<std::pair<uint32_t, uint32_t>, std::unique_ptr<uint8_t[]>> s_tables;
+
+            std::lock_guard<std::mutex> lock(s_lock);
+
+            std::unique_ptr<uint8_t[]>& spTable = s_tables[std::make_pair(rule.Birth, rule.Survival)];
+            if (!spTable)
+            {
+                spTable.reset(new uint8_t[LOOKUP_TABLE_SIZE]);
+                BuildLifeLookupTable(rule, spTable.get());
+            }
+
+            return spTable.get();
+        }
+    }
+}
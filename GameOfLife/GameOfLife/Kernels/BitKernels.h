@@ -0,0 +1,321 @@
+#pragma once
+
+//
+// Step kernels for subgrids using the bit-packed layout. Each kernel
+// advances the interior rows of a padded cell grid by one generation.
+//
+// Rows are stored one per RowType word with bit x holding padded column x,
+// so the kernels are templated on the row word; every subgrid width gets
+// its own instantiation.
+//
+
+#include <GameOfLife/Rule.h>
+
+#include <Utility/Bits.h>
+
+#include <cassert>
+#include <cstdint>
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        enum class BitKernelType
+        {
+            Adder,
+            LookupTable
+        };
+
+        //
+        // Computes the next generation for every cell in a bit-packed row at
+        // once, given the rows immediately above and below it.
+        //
+        // Bit x of each row is the cell in column x, so shifting a row left by
+        // one lines up every cell with its left neighbor and shifting right lines
+        // up every cell with its right neighbor. The eight neighbor rows are then
+        // summed bitwise with a network of half and full adders, yielding the
+        // neighbor count for each cell as separate ones/twos/fours bit planes.
+        //
+        // Bits shifted in from beyond the row are garbage for the outermost
+        // columns; callers mask those off.
+        //
+        template <typename T>
+        T NextGenerationRow(T above, T row, T below)
+        {
+            //
+            // Full adders over the three cells above and the three below.
+            //
+            const T AboveLeft  = above << 1;
+            const T AboveRight = above >> 1;
+            const T AboveOnes  = AboveLeft ^ above ^ AboveRight;
+            const T AboveTwos  = (AboveLeft & above) | (AboveRight & (AboveLeft ^ above));
+
+            const T BelowLeft  = below << 1;
+            const T BelowRight = below >> 1;
+            const T BelowOnes  = BelowLeft ^ below ^ BelowRight;
+            const T BelowTwos  = (BelowLeft & below) | (BelowRight & (BelowLeft ^ below));
+
+            //
+            // Half adder over the left and right neighbors in this row.
+            //
+            const T RowLeft  = row << 1;
+            const T RowRight = row >> 1;
+            const T RowOnes  = RowLeft ^ RowRight;
+            const T RowTwos  = RowLeft & RowRight;
+
+            //
+            // Sum the ones, then the twos plus the carry out of the ones. Anything
+            // carried out of the twos means four or more neighbors.
+            //
+            const T Ones      = AboveOnes ^ RowOnes ^ BelowOnes;
+            const T OnesCarry = (AboveOnes & RowOnes) | (BelowOnes & (AboveOnes ^ RowOnes));
+
+            const T TwosSum   = AboveTwos ^ RowTwos ^ BelowTwos;
+            const T TwosCarry = (AboveTwos & RowTwos) | (BelowTwos & (AboveTwos ^ RowTwos));
+            const T Twos      = TwosSum ^ OnesCarry;
+            const T Fours     = TwosCarry | (TwosSum & OnesCarry);
+
+            //
+            // B3/S23: alive with exactly three neighbors, or alive with two
+            // neighbors if the cell is already living.
+            //
+            return Twos & ~Fours & (Ones | row);
+        }
+
+        //
+        // Full neighbor count of every cell in a row, as four bit planes of
+        // weight one, two, four and eight.
+        //
+        template <typename T>
+        struct NeighborCounts
+        {
+            T Ones;
+            T Twos;
+            T Fours;
+            T Eights;
+
+            //
+            // Mask of the cells with exactly n neighbors.
+            //
+            T Equal(uint32_t n) const
+            {
+                return
+                    ((n & 1) ? Ones   : ~Ones)  &
+                    ((n & 2) ? Twos   : ~Twos)  &
+                    ((n & 4) ? Fours  : ~Fours) &
+                    ((n & 8) ? Eights : ~Eights);
+            }
+        };
+
+        //
+        // The adder network of NextGenerationRow(), carried on to the full
+        // neighbor count.
+        //
+        template <typename T>
+        NeighborCounts<T> CountNeighbors(T above, T row, T below)
+        {
+            const T AboveLeft  = above << 1;
+            const T AboveRight = above >> 1;
+            const T AboveOnes  = AboveLeft ^ above ^ AboveRight;
+            const T AboveTwos  = (AboveLeft & above) | (AboveRight & (AboveLeft ^ above));
+
+            const T BelowLeft  = below << 1;
+            const T BelowRight = below >> 1;
+            const T BelowOnes  = BelowLeft ^ below ^ BelowRight;
+            const T BelowTwos  = (BelowLeft & below) | (BelowRight & (BelowLeft ^ below));
+
+            const T RowLeft  = row << 1;
+            const T RowRight = row >> 1;
+            const T RowOnes  = RowLeft ^ RowRight;
+            const T RowTwos  = RowLeft & RowRight;
+
+            const T OnesCarry = (AboveOnes & RowOnes) | (BelowOnes & (AboveOnes ^ RowOnes));
+
+            //
+            // Up to four bits of weight two: the three pairs plus the carry.
+            //
+            const T TwosSum   = AboveTwos ^ RowTwos ^ BelowTwos;
+            const T TwosCarry = (AboveTwos & RowTwos) | (BelowTwos & (AboveTwos ^ RowTwos));
+            const T Carry     = TwosSum & OnesCarry;
+
+            NeighborCounts<T> counts;
+            counts.Ones   = AboveOnes ^ RowOnes ^ BelowOnes;
+            counts.Twos   = TwosSum ^ OnesCarry;
+            counts.Fours  = TwosCarry ^ Carry;
+            counts.Eights = TwosCarry & Carry;
+            return counts;
+        }
+
+        //
+        // NextGenerationRow() for any Life-like rule: the full neighbor
+        // count is matched against each count the rule lists. The rule is a
+        // compile time constant, so the loop below unrolls to just the
+        // comparisons it needs.
+        //
+        template <typename RuleT, typename T>
+        T NextGenerationRowForRule(T above, T row, T below)
+        {
+            const NeighborCounts<T> Counts = CountNeighbors(above, row, below);
+
+            T next = 0;
+            for (uint32_t n = 0; n <= 8; n++)
+            {
+                const bool IsBirth    = !!((RuleT::Birth >> n) & 1);
+                const bool IsSurvival = !!((RuleT::Survival >> n) & 1);
+                if (!IsBirth && !IsSurvival)
+                {
+                    continue;
+                }
+
+                const T Count = Counts.Equal(n);
+                if (IsBirth && IsSurvival) { next |= Count;        }
+                else if (IsBirth)          { next |= Count & ~row; }
+                else                       { next |= Count & row;  }
+            }
+
+            return next;
+        }
+
+        //
+        // The same for a rule only known at runtime, for steppers which
+        // can't go through a lookup table.
+        //
+        template <typename T>
+        T NextGenerationRowForRule(const Rule& rule, T above, T row, T below)
+        {
+            const NeighborCounts<T> Counts = CountNeighbors(above, row, below);
+
+            T next = 0;
+            for (uint32_t counts = rule.Birth | rule.Survival; counts; counts &= counts - 1)
+            {
+                const uint32_t N = Utility::CountTrailingZeros(counts);
+                const T Count = Counts.Equal(N);
+                const T Cells =
+                    (((rule.Birth    >> N) & 1) ? ~row : T(0)) |
+                    (((rule.Survival >> N) & 1) ?  row : T(0));
+
+                next |= Count & Cells;
+            }
+
+            return next;
+        }
+
+        //
+        // Picks the row function for a rule; Conway's Life keeps its own
+        // shorter adder network.
+        //
+        template <typename RuleT>
+        struct RowStepper
+        {
+            template <typename T>
+            static T Next(T above, T row, T below)
+            {
+                return NextGenerationRowForRule<RuleT>(above, row, below);
+            }
+        };
+
+        template <>
+        struct RowStepper<ConwayRule>
+        {
+            template <typename T>
+            static T Next(T above, T row, T below)
+            {
+                return NextGenerationRow(above, row, below);
+            }
+        };
+
+        //
+        // Reads pSrc, a padded grid of (height + 2) rows, and writes the next
+        // generation of its interior cells to pDst. Only the bits selected by
+        // interiorMask are written; ghost cells in pDst are left untouched.
+        //
+        // The living cells of each interior row are also written to
+        // pLiveRows[row - 1].
+        //
+        // Only instantiated for StaticRules; runtime rules use
+        // StepBitsLookup() instead.
+        //
+        template <typename RuleT, typename RowType>
+        void StepBitsAdder(
+            RowType const* pSrc, RowType* pDst,
+            int64_t height, RowType interiorMask,
+            RowType* pLiveRows
+            )
+        {
+            for (int64_t row = 1; row <= height; row++)
+            {
+                const RowType Next =
+                    RowStepper<RuleT>::Next(pSrc[row - 1], pSrc[row], pSrc[row + 1]) & interiorMask;
+
+                pDst[row] = (pDst[row] & ~interiorMask) | Next;
+                pLiveRows[row - 1] = Next;
+            }
+        }
+
+        //
+        // 65536 entry table mapping a 4x4 block of cells to the next
+        // generation of its inner 2x2 block. Bit (4 * y + x) of the index is
+        // the cell at (x, y) in the 4x4 block; bit (2 * (y - 1) + (x - 1)) of
+        // the entry is the next state of the inner cell at (x, y).
+        //
+        // Each rule's table is built on first use and lives for the rest of
+        // the process.
+        //
+        const uint8_t* GetLifeLookupTable(const Rule& rule = Rule());
+
+        //
+        // Same contract as StepBitsAdder, but steps the grid a 2x2 block at a
+        // time with lookups into pTable, which comes from GetLifeLookupTable()
+        // and so can implement any rule. width and height must both be even.
+        //
+        template <typename RowType>
+        void StepBitsLookup(
+            RowType const* pSrc, RowType* pDst,
+            int64_t width, int64_t height, RowType interiorMask,
+            const uint8_t* pTable,
+            RowType* pLiveRows
+            )
+        {
+            assert(!(width % 2) && !(height % 2));
+
+            for (int64_t row = 1; row <= height; row += 2)
+            {
+                //
+                // Each 2x2 block of output rows row and row + 1 needs the four
+                // input rows surrounding it. Shift them down two columns at a
+                // time so the current 4x4 block always sits in the low nibbles.
+                //
+                RowType above = pSrc[row - 1];
+                RowType upper = pSrc[row];
+                RowType lower = pSrc[row + 1];
+                RowType below = pSrc[row + 2];
+
+                RowType nextUpper = 0;
+                RowType nextLower = 0;
+                for (int64_t x = 1; x <= width; x += 2)
+                {
+                    const uint32_t Index =
+                        ( Utility::LowWord(above) & 0xF)        |
+                        ((Utility::LowWord(upper) & 0xF) << 4)  |
+                        ((Utility::LowWord(lower) & 0xF) << 8)  |
+                        ((Utility::LowWord(below) & 0xF) << 12);
+
+                    const uint8_t Block = pTable[Index];
+                    nextUpper |= static_cast<RowType>(Block & 0x3) << static_cast<uint32_t>(x);
+                    nextLower |= static_cast<RowType>(Block >> 2) << static_cast<uint32_t>(x);
+
+                    above = above >> 2;
+                    upper = upper >> 2;
+                    lower = lower >> 2;
+                    below = below >> 2;
+                }
+
+                pDst[row]     = (pDst[row] & ~interiorMask) | nextUpper;
+                pDst[row + 1] = (pDst[row + 1] & ~interiorMask) | nextLower;
+
+                pLiveRows[row - 1] = nextUpper;
+                pLiveRows[row]     = nextLower;
+            }
+        }
+    }
+}
@@ -0,0 +1,246 @@
+#include "ByteKernels.h"
+
+#include <Utility/Cpu.h>
+
+#include <emmintrin.h>
+
+#include <cassert>
+
+namespace
+{
+    //
+    // Largest padded row we have to deal with, in 16 byte vectors.
+    //
+    const int64_t MAX_CHUNKS = 8;
+
+    //
+    // Applies a StaticRule to sixteen cells at once. sum counts the cell
+    // itself along with its neighbors, so a living cell with n neighbors has
+    // a sum of n + 1; for B3/S23 this comes out as a sum of three, or a sum
+    // of four if the cell is living.
+    //
+    template <typename RuleT>
+    __m128i ApplyRule(__m128i sum, __m128i isAlive)
+    {
+        __m128i next = _mm_setzero_si128();
+        for (uint32_t total = 0; total <= 9; total++)
+        {
+            const bool IsBirth    = total <= 8 && !!((RuleT::Birth >> total) & 1);
+            const bool IsSurvival = total >= 1 && !!((RuleT::Survival >> (total - 1)) & 1);
+            if (!IsBirth && !IsSurvival)
+            {
+                continue;
+            }
+
+            const __m128i Matches = _mm_cmpeq_epi8(sum, _mm_set1_epi8(static_cast<char>(total)));
+            if (IsBirth && IsSurvival)
+            {
+                next = _mm_or_si128(next, Matches);
+            }
+            else if (IsBirth)
+            {
+                next = _mm_or_si128(next, _mm_andnot_si128(isAlive, Matches));
+            }
+            else
+            {
+                next = _mm_or_si128(next, _mm_and_si128(Matches, isAlive));
+            }
+        }
+
+        return next;
+    }
+}
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        void StepBytesScalar(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule& rule,
+            uint32_t* pLiveRows
+            )
+        {
+            const int64_t WordsPerRow = bufferWidth / 32;
+            assert(!(bufferWidth % 32));
+
+            //
+            // Next state indexed by current state and neighbor count.
+            //
+            uint8_t nextStates[2][9];
+            for (uint32_t n = 0; n <= 8; n++)
+            {
+                nextStates[0][n] = rule.IsAliveNext(false, n);
+                nextStates[1][n] = rule.IsAliveNext(true, n);
+            }
+
+            for (int64_t row = 1; row <= height; row++)
+            {
+                uint8_t const* pAbove = pSrc + (row - 1) * bufferWidth;
+                uint8_t const* pRow   = pSrc + row * bufferWidth;
+                uint8_t const* pBelow = pSrc + (row + 1) * bufferWidth;
+                uint8_t* pOut = pDst + row * bufferWidth;
+
+                uint32_t* pLiveWords = pLiveRows + (row - 1) * WordsPerRow;
+                for (int64_t i = 0; i < WordsPerRow; i++)
+                {
+                    pLiveWords[i] = 0;
+                }
+
+                for (int64_t x = 1; x < bufferWidth - 1; x++)
+                {
+                    const uint8_t NumNeighbors =
+                        pAbove[x - 1] + pAbove[x] + pAbove[x + 1] +
+                        pRow[x - 1]               + pRow[x + 1]   +
+                        pBelow[x - 1] + pBelow[x] + pBelow[x + 1];
+
+                    const uint8_t IsAlive = nextStates[pRow[x]][NumNeighbors];
+
+                    pOut[x] = IsAlive;
+                    pLiveWords[x / 32] |= static_cast<uint32_t>(IsAlive) << (x % 32);
+                }
+            }
+        }
+
+        template <typename RuleT>
+        void StepBytesSSE2(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule&,
+            uint32_t* pLiveRows
+            )
+        {
+            const int64_t NumChunks = bufferWidth / 16;
+            assert(!(bufferWidth % 32));
+            assert(NumChunks <= MAX_CHUNKS);
+
+            const __m128i One = _mm_set1_epi8(1);
+
+            //
+            // Byte masks selecting the interior columns of each chunk; the
+            // first and last bytes of the row are ghost cells.
+            //
+            __m128i interior[MAX_CHUNKS];
+            for (int64_t i = 0; i < NumChunks; i++)
+            {
+                interior[i] = _mm_set1_epi8(-1);
+            }
+            interior[0] = _mm_slli_si128(_mm_srli_si128(interior[0], 1), 1);
+            interior[NumChunks - 1] = _mm_srli_si128(_mm_slli_si128(interior[NumChunks - 1], 1), 1);
+
+            for (int64_t row = 1; row <= height; row++)
+            {
+                uint8_t const* pAbove = pSrc + (row - 1) * bufferWidth;
+                uint8_t const* pRow   = pSrc + row * bufferWidth;
+                uint8_t const* pBelow = pSrc + (row + 1) * bufferWidth;
+                uint8_t* pOut = pDst + row * bufferWidth;
+
+                //
+                // Vertical sums of each column first; the horizontal pass then
+                // just adds each column sum to its left and right neighbors.
+                //
+                __m128i self[MAX_CHUNKS];
+                __m128i columnSums[MAX_CHUNKS];
+                for (int64_t i = 0; i < NumChunks; i++)
+                {
+                    self[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pRow + 16 * i));
+                    columnSums[i] =
+                        _mm_add_epi8(
+                            _mm_add_epi8(
+                                _mm_loadu_si128(reinterpret_cast<const __m128i*>(pAbove + 16 * i)),
+                                self[i]
+                                ),
+                            _mm_loadu_si128(reinterpret_cast<const __m128i*>(pBelow + 16 * i))
+                            );
+                }
+
+                uint32_t* pLiveWords = pLiveRows + (row - 1) * (NumChunks / 2);
+                for (int64_t i = 0; i < NumChunks; i++)
+                {
+                    __m128i left = _mm_slli_si128(columnSums[i], 1);
+                    if (i > 0)
+                    {
+                        left = _mm_or_si128(left, _mm_srli_si128(columnSums[i - 1], 15));
+                    }
+
+                    __m128i right = _mm_srli_si128(columnSums[i], 1);
+                    if (i < NumChunks - 1)
+                    {
+                        right = _mm_or_si128(right, _mm_slli_si128(columnSums[i + 1], 15));
+                    }
+
+                    const __m128i Sum = _mm_add_epi8(_mm_add_epi8(left, columnSums[i]), right);
+                    const __m128i IsAlive = _mm_cmpeq_epi8(self[i], One);
+                    const __m128i Next = _mm_and_si128(ApplyRule<RuleT>(Sum, IsAlive), interior[i]);
+
+                    //
+                    // Blend: interior cells from the kernel, ghost cells from
+                    // whatever the destination already held.
+                    //
+                    __m128i* pOutChunk = reinterpret_cast<__m128i*>(pOut + 16 * i);
+                    const __m128i Blended =
+                        _mm_or_si128(
+                            _mm_and_si128(Next, One),
+                            _mm_andnot_si128(interior[i], _mm_loadu_si128(pOutChunk))
+                            );
+                    _mm_storeu_si128(pOutChunk, Blended);
+
+                    const uint32_t LiveMask = static_cast<uint32_t>(_mm_movemask_epi8(Next));
+                    if (i % 2)
+                    {
+                        pLiveWords[i / 2] |= LiveMask << 16;
+                    }
+                    else
+                    {
+                        pLiveWords[i / 2] = LiveMask;
+                    }
+                }
+            }
+        }
+
+        ByteKernelType GetBestByteKernel()
+        {
+            static const ByteKernelType Best =
+                Utility::CpuHasAVX2() ? ByteKernelType::AVX2 :
+                Utility::CpuHasSSE2() ? ByteKernelType::SSE2 :
+                                        ByteKernelType::Scalar;
+            return Best;
+        }
+
+        template void StepBytesSSE2<ConwayRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+        template void StepBytesSSE2<HighLifeRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+        template void StepBytesSSE2<DayAndNightRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+
+        template <typename RuleT>
+        ByteStepFunction GetByteStepFunction(ByteKernelType type)
+        {
+            switch (type)
+            {
+            case ByteKernelType::AVX2:
+                return &StepBytesAVX2<RuleT>;
+            case ByteKernelType::SSE2:
+                return &StepBytesSSE2<RuleT>;
+            case ByteKernelType::Scalar:
+            default:
+                return &StepBytesScalar;
+            }
+        }
+
+        ByteStepFunction GetByteStepFunction(ByteKernelType type, const Rule& rule)
+        {
+            switch (GetStaticRuleType(rule))
+            {
+            case StaticRuleType::Conway:
+                return GetByteStepFunction<ConwayRule>(type);
+            case StaticRuleType::HighLife:
+                return GetByteStepFunction<HighLifeRule>(type);
+            case StaticRuleType::DayAndNight:
+                return GetByteStepFunction<DayAndNightRule>(type);
+            case StaticRuleType::None:
+            default:
+                return &StepBytesScalar;
+            }
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+//
+// Step kernels for subgrids using the byte-per-cell layout. Each kernel
+// advances the interior rows of a padded cell grid by one generation.
+//
+// All kernels produce identical output; the vectorized ones just compute a
+// whole row of the padded buffer at a time.
+//
+
+#include <GameOfLife/Rule.h>
+
+#include <cstdint>
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        enum class ByteKernelType
+        {
+            Scalar,
+            SSE2,
+            AVX2
+        };
+
+        //
+        // Reads pSrc, a padded grid of (height + 2) rows of bufferWidth bytes,
+        // and writes the next generation of its interior cells to pDst. Ghost
+        // cells in pDst are left untouched.
+        //
+        // For every interior row, a mask of the living cells it produced is
+        // written as bufferWidth / 32 words starting at
+        // pLiveRows[(row - 1) * bufferWidth / 32], with bit x % 32 of word
+        // x / 32 set for padded column x.
+        //
+        // All kernels require bufferWidth to be a multiple of 32, and the
+        // vectorized ones support rows of up to 128 bytes.
+        //
+        // The vectorized kernels are templated on a StaticRule and ignore the
+        // rule argument; ByteKernels.cpp and ByteKernels_AVX2.cpp instantiate
+        // them for each one. The scalar kernel looks the rule up in a table,
+        // so it takes any rule.
+        //
+        typedef void (*ByteStepFunction)(
+            uint8_t const* pSrc,
+            uint8_t* pDst,
+            int64_t bufferWidth,
+            int64_t height,
+            const Rule& rule,
+            uint32_t* pLiveRows
+            );
+
+        void StepBytesScalar(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule& rule,
+            uint32_t* pLiveRows
+            );
+
+        template <typename RuleT>
+        void StepBytesSSE2(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule& rule,
+            uint32_t* pLiveRows
+            );
+
+        template <typename RuleT>
+        void StepBytesAVX2(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule& rule,
+            uint32_t* pLiveRows
+            );
+
+        //
+        // Picks the widest kernel the CPU supports. The CPUID query is only
+        // made once.
+        //
+        ByteKernelType GetBestByteKernel();
+
+        //
+        // The kernel of the given type for rule. Rules without a StaticRule
+        // always get the scalar kernel.
+        //
+        ByteStepFunction GetByteStepFunction(ByteKernelType type, const Rule& rule);
+    }
+}
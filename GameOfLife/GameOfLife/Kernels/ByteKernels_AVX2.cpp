@@ -0,0 +1,162 @@
+//
+// Kept in its own translation unit so that only this file is compiled with
+// AVX2 code generation enabled; callers must check GetBestByteKernel()
+// before running it.
+//
+
+#if defined(__GNUC__)
+#pragma GCC target("avx2")
+#endif
+
+#include "ByteKernels.h"
+
+#include <immintrin.h>
+
+#include <cassert>
+
+namespace
+{
+    //
+    // Largest padded row we have to deal with, in 32 byte vectors.
+    //
+    const int64_t MAX_CHUNKS = 4;
+
+    //
+    // Whole-register byte shifts by one, carrying the byte shifted in from
+    // the neighboring register. _mm256_alignr_epi8 only works within 128-bit
+    // lanes, so the lanes are first stitched together with a permute.
+    //
+    inline __m256i ShiftInFromPrevious(__m256i value, __m256i previous)
+    {
+        const __m256i Stitched = _mm256_permute2x128_si256(value, previous, 0x03);
+        return _mm256_alignr_epi8(value, Stitched, 15);
+    }
+
+    inline __m256i ShiftInFromNext(__m256i value, __m256i next)
+    {
+        const __m256i Stitched = _mm256_permute2x128_si256(value, next, 0x21);
+        return _mm256_alignr_epi8(Stitched, value, 1);
+    }
+
+    //
+    // See ApplyRule() in ByteKernels.cpp; the same, thirty-two cells at a
+    // time.
+    //
+    template <typename RuleT>
+    __m256i ApplyRule(__m256i sum, __m256i isAlive)
+    {
+        __m256i next = _mm256_setzero_si256();
+        for (uint32_t total = 0; total <= 9; total++)
+        {
+            const bool IsBirth    = total <= 8 && !!((RuleT::Birth >> total) & 1);
+            const bool IsSurvival = total >= 1 && !!((RuleT::Survival >> (total - 1)) & 1);
+            if (!IsBirth && !IsSurvival)
+            {
+                continue;
+            }
+
+            const __m256i Matches = _mm256_cmpeq_epi8(sum, _mm256_set1_epi8(static_cast<char>(total)));
+            if (IsBirth && IsSurvival)
+            {
+                next = _mm256_or_si256(next, Matches);
+            }
+            else if (IsBirth)
+            {
+                next = _mm256_or_si256(next, _mm256_andnot_si256(isAlive, Matches));
+            }
+            else
+            {
+                next = _mm256_or_si256(next, _mm256_and_si256(Matches, isAlive));
+            }
+        }
+
+        return next;
+    }
+}
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        template <typename RuleT>
+        void StepBytesAVX2(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t bufferWidth, int64_t height,
+            const Rule&,
+            uint32_t* pLiveRows
+            )
+        {
+            const int64_t NumChunks = bufferWidth / 32;
+            assert(!(bufferWidth % 32));
+            assert(NumChunks <= MAX_CHUNKS);
+
+            const __m256i Zero  = _mm256_setzero_si256();
+            const __m256i One   = _mm256_set1_epi8(1);
+
+            //
+            // Byte masks selecting the interior columns of each chunk; the
+            // first and last bytes of the row are ghost cells.
+            //
+            __m256i interior[MAX_CHUNKS];
+            const __m256i AllSet = _mm256_set1_epi8(-1);
+            for (int64_t i = 0; i < NumChunks; i++)
+            {
+                interior[i] = AllSet;
+            }
+            interior[0] = ShiftInFromPrevious(ShiftInFromNext(interior[0], Zero), Zero);
+            interior[NumChunks - 1] = ShiftInFromNext(ShiftInFromPrevious(interior[NumChunks - 1], Zero), Zero);
+
+            for (int64_t row = 1; row <= height; row++)
+            {
+                uint8_t const* pAbove = pSrc + (row - 1) * bufferWidth;
+                uint8_t const* pRow   = pSrc + row * bufferWidth;
+                uint8_t const* pBelow = pSrc + (row + 1) * bufferWidth;
+                uint8_t* pOut = pDst + row * bufferWidth;
+
+                __m256i self[MAX_CHUNKS];
+                __m256i columnSums[MAX_CHUNKS];
+                for (int64_t i = 0; i < NumChunks; i++)
+                {
+                    self[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pRow + 32 * i));
+                    columnSums[i] =
+                        _mm256_add_epi8(
+                            _mm256_add_epi8(
+                                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pAbove + 32 * i)),
+                                self[i]
+                                ),
+                            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pBelow + 32 * i))
+                            );
+                }
+
+                uint32_t* pLiveWords = pLiveRows + (row - 1) * NumChunks;
+                for (int64_t i = 0; i < NumChunks; i++)
+                {
+                    const __m256i Left  = ShiftInFromPrevious(columnSums[i], i > 0 ? columnSums[i - 1] : Zero);
+                    const __m256i Right = ShiftInFromNext(columnSums[i], i < NumChunks - 1 ? columnSums[i + 1] : Zero);
+
+                    //
+                    // See ApplyRule(): the sum includes the cell itself.
+                    //
+                    const __m256i Sum = _mm256_add_epi8(_mm256_add_epi8(Left, columnSums[i]), Right);
+                    const __m256i IsAlive = _mm256_cmpeq_epi8(self[i], One);
+                    const __m256i Next = _mm256_and_si256(ApplyRule<RuleT>(Sum, IsAlive), interior[i]);
+
+                    __m256i* pOutChunk = reinterpret_cast<__m256i*>(pOut + 32 * i);
+                    const __m256i Blended =
+                        _mm256_blendv_epi8(
+                            _mm256_loadu_si256(pOutChunk),
+                            _mm256_and_si256(Next, One),
+                            interior[i]
+                            );
+                    _mm256_storeu_si256(pOutChunk, Blended);
+
+                    pLiveWords[i] = static_cast<uint32_t>(_mm256_movemask_epi8(Next));
+                }
+            }
+        }
+
+        template void StepBytesAVX2<ConwayRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+        template void StepBytesAVX2<HighLifeRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+        template void StepBytesAVX2<DayAndNightRule>(uint8_t const*, uint8_t*, int64_t, int64_t, const Rule&, uint32_t*);
+    }
+}
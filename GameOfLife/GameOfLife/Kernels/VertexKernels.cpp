@@ -0,0 +1,55 @@
+#include "VertexKernels.h"
+
+#include <emmintrin.h>
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        static_assert(
+            sizeof(VertexType) == 2 * sizeof(float),
+            "Vertices are written as interleaved pairs of floats."
+            );
+
+        uint32_t ExtractBits(uint64_t bits, float x, float y, VertexType* pVertices)
+        {
+            const uint32_t Count = Utility::PopCount(bits);
+
+            //
+            // Four set bits at a time: find each one's column, convert all
+            // four at once and store them interleaved with y, without
+            // checking whether there were really four left. Rows average
+            // only a few living cells, so this saves a mispredicted branch
+            // per cell over stopping exactly.
+            //
+            // The top bit keeps the bit scans defined once the row runs out;
+            // vertices from those scans land past Count, so never count.
+            //
+            const uint64_t Sentinel = uint64_t(1) << 63;
+            const __m128 X = _mm_set1_ps(x);
+            const __m128 Y = _mm_set1_ps(y);
+            float* pDst = reinterpret_cast<float*>(pVertices);
+            while (bits)
+            {
+                const int Column0 = static_cast<int>(Utility::CountTrailingZeros(bits | Sentinel));
+                bits = Utility::ClearLowestSetBit(bits);
+                const int Column1 = static_cast<int>(Utility::CountTrailingZeros(bits | Sentinel));
+                bits = Utility::ClearLowestSetBit(bits);
+                const int Column2 = static_cast<int>(Utility::CountTrailingZeros(bits | Sentinel));
+                bits = Utility::ClearLowestSetBit(bits);
+                const int Column3 = static_cast<int>(Utility::CountTrailingZeros(bits | Sentinel));
+                bits = Utility::ClearLowestSetBit(bits);
+
+                const __m128 Xs = _mm_add_ps(
+                    _mm_cvtepi32_ps(_mm_set_epi32(Column3, Column2, Column1, Column0)),
+                    X
+                    );
+                _mm_storeu_ps(pDst,     _mm_unpacklo_ps(Xs, Y));
+                _mm_storeu_ps(pDst + 4, _mm_unpackhi_ps(Xs, Y));
+                pDst += 8;
+            }
+
+            return Count;
+        }
+    }
+}
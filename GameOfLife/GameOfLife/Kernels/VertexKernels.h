@@ -0,0 +1,44 @@
+#pragma once
+
+//
+// Kernels for turning bit-packed rows of living cells into vertices for
+// the renderers. Extraction happens on demand, so it only costs anything
+// for tiles and generations that are actually drawn or written out.
+//
+
+#include <GameOfLife/Tile.h>
+
+#include <Utility/Bits.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace GameOfLife
+{
+    namespace Kernels
+    {
+        //
+        // The kernels write vertices four at a time, so up to three past the
+        // last one extracted may be overwritten. Leave at least this much
+        // room at the end of the output.
+        //
+        const size_t VERTEX_EXTRACT_SLACK = 4;
+
+        //
+        // Writes the vertex (x + i, y) for every set bit i of bits to
+        // pVertices, lowest bit first, and returns how many were written.
+        //
+        uint32_t ExtractBits(uint64_t bits, float x, float y, VertexType* pVertices);
+
+        inline uint32_t ExtractBits(uint32_t bits, float x, float y, VertexType* pVertices)
+        {
+            return ExtractBits(static_cast<uint64_t>(bits), x, y, pVertices);
+        }
+
+        inline uint32_t ExtractBits(const Utility::UInt128& bits, float x, float y, VertexType* pVertices)
+        {
+            const uint32_t Count = ExtractBits(bits.Low, x, y, pVertices);
+            return Count + ExtractBits(bits.High, x + 64.0f, y, pVertices + Count);
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <GameOfLife/Engine.h>
 #include <GameOfLife/SparseGrid.h>
+#include <GameOfLife/SubGrid.h>
 #include <GameOfLife/Cell.h>
 
 #include <GameOfLife/Renderers/FileStateRenderer.h>
@@ -47,10 +49,24 @@ namespace GameOfLife
             // so ensure  that it is declared beforehand (destructor removes 
             // objects in reverse order of declaration).
             //
-            Utility::AlignedMemoryPool<64> m_memoryPool;
+            std::unique_ptr<Utility::AlignedMemoryPool<64>> m_spMemoryPool;
             GameState m_gameState;
 
-            void InitializeState(const std::vector<Cell>& cells);
+            //
+            // tileSize, cellFormat, numThreads, haloDepth, useHugePages and
+            // memoryBudget only apply to the sparse engine, apart from the
+            // cell format's rule. Zero threads uses every hardware thread.
+            //
+            void InitializeState(
+                const std::vector<Cell>& cells,
+                EngineType engineType,
+                int64_t tileSize,
+                const CellFormat& cellFormat,
+                size_t numThreads,
+                uint32_t haloDepth,
+                bool useHugePages,
+                const MemoryBudget& memoryBudget
+                );
             void UpdateState();
 
             cinder::CameraOrtho             m_camera;
@@ -61,13 +77,24 @@ namespace GameOfLife
             std::vector<size_t>             m_meshVertexCounts;
             size_t                          m_meshesToDraw;
 
-            std::unique_ptr<SparseGrid> m_spState;
+            //
+            // Scratch space for extracting a tile's vertices before they're
+            // copied into its mesh.
+            //
+            std::vector<VertexType>         m_vertices;
+
+            std::unique_ptr<Engine> m_spState;
             bool m_isInitialized;
             bool m_takeSingleStep;
 
             std::unique_ptr<FileStateRenderer> m_spFileStateRenderer;
             bool m_countingGenerations;
-            int32_t m_generationsRemaining;
+            int64_t m_generationsRemaining;
+
+            //
+            // Each frame advances 2^m_stepLog2 generations.
+            //
+            uint32_t m_stepLog2;
         };
     }
 }
\ No newline at end of file
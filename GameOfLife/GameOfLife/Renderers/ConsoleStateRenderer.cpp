@@ -45,7 +45,7 @@ namespace GameOfLife { namespace Renderers {
     //
     ConsoleStateRenderer::~ConsoleStateRenderer() = default;
 
-    void ConsoleStateRenderer::Draw(const SparseGrid& state)
+    void ConsoleStateRenderer::Draw(const Engine& state)
     {
         //
         // Make a first pass and clear out the whole grid, then set cells
@@ -71,17 +71,16 @@ namespace GameOfLife { namespace Renderers {
         static const WORD ColorBuffer[] = { BACKGROUND_BLUE, BACKGROUND_GREEN, BACKGROUND_RED, BACKGROUND_RED };
         int colorIndex = 0;
 
-        for (auto it = state.begin(); it != state.end(); ++it)
+        state.ForEachTile([this, &state, &colorIndex](const Tile& tile)
         {
-            const auto& spSubgrid = it->second;
-            const int64_t xMin = spSubgrid->XMin();
-            const int64_t yMin = spSubgrid->YMin();
+            const int64_t xMin = tile.XMin();
+            const int64_t yMin = tile.YMin();
 
-            for (int64_t y = yMin; y < yMin + spSubgrid->Height(); ++y)
+            for (int64_t y = yMin; y < yMin + tile.Height(); ++y)
             {
-                for (int64_t x = xMin; x < xMin + spSubgrid->Width(); ++x)
+                for (int64_t x = xMin; x < xMin + tile.Width(); ++x)
                 {
-                    if (spSubgrid->GetCellState(x, y))
+                    if (tile.GetCellState(x, y))
                     {
                         int cursorX = static_cast<int>(x - state.XMin());
                         int cursorY = static_cast<int>(y - state.YMin());
@@ -92,7 +91,7 @@ namespace GameOfLife { namespace Renderers {
             }
 
             colorIndex = (colorIndex + 1) % ARRAYSIZE(ColorBuffer);
-        }
+        });
 
         m_spPimpl->SetCursorPosition(
             static_cast<int>(state.Width()),
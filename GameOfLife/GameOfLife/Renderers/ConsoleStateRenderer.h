@@ -5,7 +5,7 @@
 // just for preliminary validation.
 // 
 
-#include <GameOfLife/SparseGrid.h>
+#include <GameOfLife/Engine.h>
 
 #include <memory>
 
@@ -19,7 +19,7 @@ namespace GameOfLife
             ConsoleStateRenderer();
             ~ConsoleStateRenderer();
 
-            void Draw(const SparseGrid& state);
+            void Draw(const Engine& state);
 
         private:
             ConsoleStateRenderer(const ConsoleStateRenderer& other) = delete;
@@ -6,9 +6,9 @@ namespace GameOfLife { namespace Renderers {
         : m_fileOut(filename)
     {}
 
-    std::ostream& FileStateRenderer::operator<<(const SparseGrid& sparseGrid)
+    std::ostream& FileStateRenderer::operator<<(const Engine& engine)
     {
-        m_fileOut << sparseGrid;
+        m_fileOut << engine;
         return m_fileOut;
     }
 } }
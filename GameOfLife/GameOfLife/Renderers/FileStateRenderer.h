@@ -4,7 +4,7 @@
 // This class renders to a file, primarily for validation purposes.
 //
 
-#include "GameOfLife\SparseGrid.h"
+#include "GameOfLife\Engine.h"
 
 #include <string>
 #include <fstream>
@@ -18,7 +18,7 @@ namespace GameOfLife
         public:
             FileStateRenderer(const std::string& filename);
 
-            std::ostream& operator<<(const SparseGrid& sparseGrid);
+            std::ostream& operator<<(const Engine& engine);
 
         private:
             std::ofstream m_fileOut;
@@ -0,0 +1,157 @@
+#pragma once
+
+//
+// Life-like rules in B/S notation. "B36/S23" (HighLife) means a dead cell
+// with three or six living neighbors is born, and a living cell with two or
+// three living neighbors survives; every other cell is dead next generation.
+//
+// Like SnapCoordinateToSubgridCorner(), the implementation is inlined here
+// so that the reference implementation can share it.
+//
+
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <string>
+
+namespace GameOfLife
+{
+    struct Rule
+    {
+        //
+        // Bit n is set if a cell with n living neighbors is born or
+        // survives, respectively. Defaults to Conway's B3/S23.
+        //
+        Rule(
+            uint32_t birth = 1 << 3,
+            uint32_t survival = (1 << 2) | (1 << 3)
+            ) : Birth(birth), Survival(survival)
+        {}
+
+        bool operator==(const Rule& other) const
+        {
+            return Birth == other.Birth && Survival == other.Survival;
+        }
+
+        bool operator!=(const Rule& other) const { return !(*this == other); }
+
+        //
+        // State of a cell next generation given its current state and its
+        // number of living neighbors.
+        //
+        bool IsAliveNext(bool isAlive, uint32_t numNeighbors) const
+        {
+            return !!(((isAlive ? Survival : Birth) >> numNeighbors) & 1);
+        }
+
+        //
+        // Parses B/S notation, e.g. "B3/S23". Case and the slash are
+        // optional. Throws if the string isn't a valid rule.
+        //
+        // B0 rules are rejected: empty space would come alive, which neither
+        // engine can represent sparsely.
+        //
+        static Rule Parse(const std::string& string)
+        {
+            uint32_t masks[2] = { 0, 0 };
+            bool seen[2] = { false, false };
+            int current = -1;
+
+            for (char c : string)
+            {
+                const char Upper = static_cast<char>(toupper(static_cast<unsigned char>(c)));
+                if (Upper == 'B' || Upper == 'S')
+                {
+                    current = Upper == 'B' ? 0 : 1;
+                    if (seen[current])
+                    {
+                        throw std::exception("Invalid rule: B and S may only appear once.");
+                    }
+                    seen[current] = true;
+                }
+                else if (Upper == '/' && current != -1)
+                {
+                    continue;
+                }
+                else if (Upper >= '0' && Upper <= '8' && current != -1)
+                {
+                    masks[current] |= 1 << (Upper - '0');
+                }
+                else
+                {
+                    throw std::exception("Invalid rule: expected B/S notation, e.g. B3/S23.");
+                }
+            }
+
+            if (!seen[0] || !seen[1])
+            {
+                throw std::exception("Invalid rule: expected B/S notation, e.g. B3/S23.");
+            }
+
+            if (masks[0] & 1)
+            {
+                throw std::exception("Invalid rule: B0 rules are not supported.");
+            }
+
+            return Rule(masks[0], masks[1]);
+        }
+
+        std::string ToString() const
+        {
+            std::string string("B");
+            for (uint32_t n = 0; n <= 8; n++)
+            {
+                if ((Birth >> n) & 1) { string += static_cast<char>('0' + n); }
+            }
+
+            string += "/S";
+            for (uint32_t n = 0; n <= 8; n++)
+            {
+                if ((Survival >> n) & 1) { string += static_cast<char>('0' + n); }
+            }
+
+            return string;
+        }
+
+        uint32_t Birth;
+        uint32_t Survival;
+    };
+
+    //
+    // A rule fixed at compile time, so kernels templated on it fold the rule
+    // into straight-line bitwise operations.
+    //
+    template <uint32_t BirthMask, uint32_t SurvivalMask>
+    struct StaticRule
+    {
+        static const uint32_t Birth = BirthMask;
+        static const uint32_t Survival = SurvivalMask;
+
+        static Rule Get() { return Rule(Birth, Survival); }
+    };
+
+    typedef StaticRule<0x008, 0x00C> ConwayRule;      // B3/S23
+    typedef StaticRule<0x048, 0x00C> HighLifeRule;    // B36/S23
+    typedef StaticRule<0x1C8, 0x1D8> DayAndNightRule; // B3678/S34678
+
+    //
+    // Which of the StaticRules above, if any, a rule matches. Kernels
+    // dispatch on this, falling back to tables for everything else.
+    //
+    enum class StaticRuleType
+    {
+        None,
+        Conway,
+        HighLife,
+        DayAndNight
+    };
+
+    inline StaticRuleType GetStaticRuleType(const Rule& rule)
+    {
+        if (rule == ConwayRule::Get())      { return StaticRuleType::Conway; }
+        if (rule == HighLifeRule::Get())    { return StaticRuleType::HighLife; }
+        if (rule == DayAndNightRule::Get()) { return StaticRuleType::DayAndNight; }
+
+        return StaticRuleType::None;
+    }
+}
@@ -1,6 +1,7 @@
 #include "SparseGrid.h"
 
 #include <Utility/AlignedMemoryPool.h>
+#include <Utility/Bits.h>
 
 #include <limits>
 #include <cassert>
@@ -8,11 +9,12 @@
 
 namespace
 {
-    GameOfLife::SubGrid::CoordinateType
+    template <int64_t TileWidth, int64_t TileHeight>
+    GameOfLife::CoordinateType
     GetNeighborCoordinates(
-        const GameOfLife::SubGrid& subgrid,
+        const GameOfLife::SubGrid<TileWidth, TileHeight>& subgrid,
         const GameOfLife::RectangularGrid& stateDimensions,
-        const GameOfLife::SubGrid::CoordinateType neighborDelta
+        const GameOfLife::CoordinateType neighborDelta
         )
     {
         const int64_t XMax = stateDimensions.XMin() + stateDimensions.Width();
@@ -27,20 +29,20 @@ namespace
         // 
         // SparseGrid is toroidal, so account for wrapping.
         //
-        int64_t neighborX = SubgridMinX + dx * GameOfLife::SubGrid::SUBGRID_WIDTH;
+        int64_t neighborX = SubgridMinX + dx * TileWidth;
         if (neighborX < stateDimensions.XMin())
         {
-            neighborX = XMax - GameOfLife::SubGrid::SUBGRID_WIDTH;
+            neighborX = XMax - TileWidth;
         }
         else if (neighborX == XMax)
         {
             neighborX = stateDimensions.XMin();
         }
 
-        int64_t neighborY = SubgridMinY + dy * GameOfLife::SubGrid::SUBGRID_HEIGHT;
+        int64_t neighborY = SubgridMinY + dy * TileHeight;
         if (neighborY < stateDimensions.YMin())
         {
-            neighborY = YMax - GameOfLife::SubGrid::SUBGRID_HEIGHT;
+            neighborY = YMax - TileHeight;
         }
         else if (neighborY == YMax)
         {
@@ -51,99 +53,53 @@ namespace
     }
 
     //
-    // Given a subgrid, the full state dimensions and the offset vector of 
-    // a neighbor (neighborDelta), return the starting coordinates and dimensions
-    // of the neighbor which would exist at subgridposition.xy + neighbordelta.xy.
+    // Returns a mask with bit i set if the subgrid's next generation needs a
+    // neighbor at AdjacencyIndex i which doesn't exist yet.
     //
-    // This accounts for wrapping in the full state; note that subgrids may self-wrap
-    // if they have no neighbors along a particular axis.
-    //
-    void 
-    MaybeCreateNewNeighbors(
-        Utility::AlignedMemoryPool<64>& memoryPool,
-        const GameOfLife::SubGridPtr& spSubgrid,
-        const GameOfLife::SparseGrid& sparseGrid,
-        GameOfLife::SubGridGraph& gridGraph,
-        std::vector<GameOfLife::SubGridPtr>& subgridPtrsOut
-        )
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint32_t GetNewNeighborMask(const GameOfLife::SubGrid<TileWidth, TileHeight>& subgrid)
     {
-        using namespace GameOfLife;
+        uint32_t mask = 0;
         for (int i = 0; i < GameOfLife::AdjacencyIndex::MAX; ++i)
         {
-            const auto Adjacency = static_cast<AdjacencyIndex>(i);
-            const auto NeighborOffset = SubGridGraph::GetNeighborPositionFromIndex(Adjacency);
-            if (spSubgrid->IsNextGenerationNeighbor(Adjacency))
+            if (subgrid.IsNextGenerationNeighbor(static_cast<GameOfLife::AdjacencyIndex>(i)))
             {
-                const SubGrid::CoordinateType NeighborCoords = GetNeighborCoordinates(*spSubgrid, sparseGrid, NeighborOffset);
-                
-                SubGridPtr spNeighbor;
-                if (gridGraph.QuerySubgrid(NeighborCoords, spNeighbor))
-                {
-                    //
-                    // In this instance, subgrid neighbors a preexisting subgrid so there's no need to
-                    // create a new one. Worth noting that a subgrid may neighbor itself.
-                    //
-                }
-                else
-                {
-                    //
-                    // It's possible that more than one subgrid will demand the same new neighbor.
-                    // In that case, we may have already created the neighbor and it lives in subgridPtrsOut.
-                    // Check for that here prior to deciding to create a new subgrid.
-                    //
-                    auto it =
-                        std::find_if(subgridPtrsOut.begin(), subgridPtrsOut.end(), [&NeighborCoords](const SubGridPtr& spSubgrid)
-                        {
-                            return spSubgrid->GetCoordinates() == NeighborCoords;
-                        }); 
-
-                    if (it == subgridPtrsOut.end())
-                    {
-                        subgridPtrsOut.emplace_back(
-                            std::make_shared<SubGrid>(
-                                memoryPool, sparseGrid, gridGraph,
-                                NeighborCoords.first, NeighborCoords.second,
-                                spSubgrid->GetGeneration()
-                            ));
-                        spNeighbor = subgridPtrsOut.back();
-                    }
-                    else
-                    {
-                        spNeighbor = *it;
-                    }
-                }
-
-                spNeighbor->CopyBorder(*spSubgrid, GetReflectedAdjacencyIndex(Adjacency));
+                mask |= 1 << i;
             }
         }
-    }
 
-    //
-    // If a subgrid is worth retiring (has no more live cells or border cells),
-    // tack it onto the end of subgridPtrsOut for later processing.
-    //
-    void MaybeRetireSubgrid(
-        uint32_t numCells,
-        GameOfLife::SubGridPtr spSubgrid,
-        std::vector<GameOfLife::SubGridPtr>& subgridPtrsOut
-        )
-    {
-        if (!numCells && !spSubgrid->HasBorderCells())
-        {
-            subgridPtrsOut.push_back(spSubgrid);
-        }
+        return mask;
     }
+
 }
 
 namespace GameOfLife
 {
-    SparseGrid::SparseGrid(
+    template <int64_t TileWidth, int64_t TileHeight>
+    SparseGrid<TileWidth, TileHeight>::SparseGrid(
         const std::vector<Cell>& initialCells,
-        Utility::AlignedMemoryPool<64>& memoryPool
-    ) : m_alignedPool(memoryPool), m_generationCount(0)
+        Utility::AlignedMemoryPool<64>& memoryPool,
+        const CellFormat& cellFormat,
+        size_t numThreads,
+        uint32_t haloDepth,
+        const MemoryBudget& memoryBudget,
+        ScheduleOrder scheduleOrder
+    ) : m_memoryBudget(memoryBudget),
+        m_alignedPool(memoryPool),
+        m_generationCount(0),
+        m_haloDepth(haloDepth < 1 ? 1 : haloDepth > MAX_HALO_DEPTH ? MAX_HALO_DEPTH : haloDepth),
+        m_scheduleOrder(scheduleOrder),
+        m_threadPool(numThreads),
+        m_waitingCapacity(0),
+        m_cellGridBufferSize(SubGridType::GetCellGridBufferSize(cellFormat.Layout)),
+        m_numDormant(0),
+        m_dormantRowBytes(0)
     {
         assert(!initialCells.empty());
 
+        m_threadNotes.resize(m_threadPool.GetThreadCount());
+        m_threadNewSubgrids.resize(m_threadPool.GetThreadCount());
+
         int64_t xMin = std::numeric_limits<int64_t>::max();
         int64_t xMax = std::numeric_limits<int64_t>::min();
         int64_t yMin = std::numeric_limits<int64_t>::max();
@@ -165,58 +121,70 @@ namespace GameOfLife
         //
         // Snap state to subgrid boundaries.
         //
-        xMin = SubGrid::SnapCoordinateToSubgridCorner(xMin, SubGrid::SUBGRID_WIDTH);
-        yMin = SubGrid::SnapCoordinateToSubgridCorner(yMin, SubGrid::SUBGRID_HEIGHT);
+        xMin = SnapCoordinateToSubgridCorner<TileWidth>(xMin);
+        yMin = SnapCoordinateToSubgridCorner<TileHeight>(yMin);
 
         //
         // Do the same for max values -- though max values are on the lower-right corner.
         //
-        xMax = SubGrid::SnapCoordinateToSubgridCorner(xMax, SubGrid::SUBGRID_WIDTH);
-        xMax += SubGrid::SUBGRID_WIDTH;
-        yMax = SubGrid::SnapCoordinateToSubgridCorner(yMax, SubGrid::SUBGRID_HEIGHT);
-        yMax += SubGrid::SUBGRID_HEIGHT;
+        xMax = SnapCoordinateToSubgridCorner<TileWidth>(xMax);
+        xMax += TileWidth;
+        yMax = SnapCoordinateToSubgridCorner<TileHeight>(yMax);
+        yMax += TileHeight;
 
         m_xMin  = xMin;
-        m_width = std::max(xMax - xMin, SubGrid::SUBGRID_WIDTH);
-        assert(!(m_width % SubGrid::SUBGRID_WIDTH));
+        m_width = std::max(xMax - xMin, TileWidth);
+        assert(!(m_width % TileWidth));
 
         m_yMin   = yMin;
-        m_height = std::max(yMax - yMin, SubGrid::SUBGRID_HEIGHT);
-        assert(!(m_height % SubGrid::SUBGRID_HEIGHT));
+        m_height = std::max(yMax - yMin, TileHeight);
+        assert(!(m_height % TileHeight));
 
-        for (const Cell& cell : initialCells)
+        //
+        // Create the subgrids in the order they'll be stepped in (see
+        // ScheduleChunks()), so neighbors tend to be next to each other in
+        // memory as well.
+        //
+        std::vector<std::pair<uint64_t, size_t>> cellOrder;
+        cellOrder.reserve(initialCells.size());
+        for (size_t i = 0; i < initialCells.size(); i++)
         {
             //
             // Snap upper-left coordinates of subgrids to boundaries on SUBGRID_WIDTH
             // and SUBGRID_HEIGHT for x,y respectively.
             //
-            int64_t subgridMinX = SubGrid::SnapCoordinateToSubgridCorner(cell.X, SubGrid::SUBGRID_WIDTH);
-            int64_t subgridMinY = SubGrid::SnapCoordinateToSubgridCorner(cell.Y, SubGrid::SUBGRID_HEIGHT);
+            const int64_t SubgridMinX = SnapCoordinateToSubgridCorner<TileWidth>(initialCells[i].X);
+            const int64_t SubgridMinY = SnapCoordinateToSubgridCorner<TileHeight>(initialCells[i].Y);
+            cellOrder.emplace_back(GetScheduleKey(SubgridMinX, SubgridMinY), i);
+        }
+
+        std::sort(cellOrder.begin(), cellOrder.end());
+
+        for (const std::pair<uint64_t, size_t>& entry : cellOrder)
+        {
+            const Cell& cell = initialCells[entry.second];
+            const int64_t SubgridMinX = SnapCoordinateToSubgridCorner<TileWidth>(cell.X);
+            const int64_t SubgridMinY = SnapCoordinateToSubgridCorner<TileHeight>(cell.Y);
 
-            SubGridPtr spSubgrid;
-            if (!m_gridGraph.QuerySubgrid(std::make_pair(subgridMinX, subgridMinY), /* out */spSubgrid))
+            SubGridType* pSubgrid;
+            if (!m_gridGraph.QuerySubgrid(std::make_pair(SubgridMinX, SubgridMinY), /* out */pSubgrid))
             {
-                auto spSubgrid = std::make_shared<SubGrid>(
-                        m_alignedPool, *this, m_gridGraph,
-                        subgridMinX, subgridMinY
+                m_subgridStorage.Reserve(1);
+                pSubgrid = m_subgridStorage.Create(
+                        m_alignedPool,
+                        cellFormat,
+                        SubgridMinX, SubgridMinY
                     );
-                spSubgrid->RaiseCell(cell.X, cell.Y);
-                if (!m_subgridStorage.Add(spSubgrid))
-                {
-                    assert(false);
-                    throw std::exception("Unrecoverable: Could not add new subgrid to storage!");
-                }
+                m_subgridStorage.Add(pSubgrid);
 
-                if (!m_gridGraph.AddSubgrid(spSubgrid))
+                if (!m_gridGraph.AddSubgrid(pSubgrid))
                 {
                     assert(false);
                     throw std::exception("Unrecoverable: Could not add new subgrid to graph!");
                 }
             }
-            else
-            {
-                spSubgrid->RaiseCell(cell.X, cell.Y);
-            }
+
+            pSubgrid->RaiseCell(cell.X, cell.Y);
         }
 
         if (m_subgridStorage.GetSize() == 0)
@@ -231,145 +199,945 @@ namespace GameOfLife
 
         //
         // Initialize subgrid neighbor relationships in the graph and create new
-        // neighbors if necessary.
+        // neighbors if necessary. Everything starts out awake, with its
+        // borders up to date.
         //
+        std::vector<GrowingSubgrid> growing;
+        for (SubGridType* pSubgrid : m_subgridStorage)
+        {
+            LinkNeighbors(pSubgrid);
+        }
 
-        std::vector<SubGridPtr> subgridsToAdd;
-        for (auto it = m_subgridStorage.begin(); it != m_subgridStorage.end(); ++it)
+        for (SubGridType* pSubgrid : m_subgridStorage)
         {
-            SubGridPtr spSubGrid = it->second;
-            MaybeCreateNewNeighbors(m_alignedPool, spSubGrid, *this, m_gridGraph, subgridsToAdd);
+            pSubgrid->CopyBorders();
+            m_awakeSubgrids.push_back(pSubgrid);
+
+            const uint32_t NewNeighbors = GetNewNeighborMask(*pSubgrid);
+            if (NewNeighbors)
+            {
+                growing.emplace_back(pSubgrid, NewNeighbors);
+            }
         }
 
-        const size_t NumAdded = subgridsToAdd.size();
-        if (NumAdded)
+        std::vector<SubGridType*> subgridsToAdd;
+        CreateNewNeighbors(growing, subgridsToAdd);
+        AddSubgrids(subgridsToAdd);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SparseGrid<TileWidth, TileHeight>::AdvanceGeneration()
+    {
+        //
+        // Only awake subgrids are stepped.
+        //
+        std::vector<SubGridType*> awakeSubgrids;
+        awakeSubgrids.swap(m_awakeSubgrids);
+
+        ScheduleChunks(awakeSubgrids);
+        CatchUp(awakeSubgrids);
+
+        //
+        // Phase 2: step.
+        //
+        m_numCells.resize(awakeSubgrids.size());
+        m_threadPool.ParallelFor(m_chunkEnds, [this, &awakeSubgrids](size_t i, size_t)
         {
-            //
-            // We've got a nasty bug somewhere if there are any duplicates, so fail
-            // hard if that's the case.
-            //
-            if (!m_subgridStorage.Add(subgridsToAdd))
+            m_numCells[i] = awakeSubgrids[i]->AdvanceGeneration();
+        });
+
+        FinishGeneration(awakeSubgrids);
+        return true;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SparseGrid<TileWidth, TileHeight>::StepPow2(uint32_t k)
+    {
+        const uint32_t MaxGenerations = m_haloDepth > 1 ? m_haloDepth : MAX_WINDOW_GENERATIONS;
+
+        for (uint64_t remaining = uint64_t(1) << k; remaining; )
+        {
+            const uint32_t NumGenerations =
+                static_cast<uint32_t>(std::min<uint64_t>(remaining, MaxGenerations));
+
+            if (NumGenerations == 1)
+            {
+                AdvanceGeneration();
+            }
+            else if (m_haloDepth > 1)
+            {
+                AdvanceBlock(NumGenerations);
+            }
+            else
+            {
+                AdvanceWindow(NumGenerations);
+            }
+
+            remaining -= NumGenerations;
+        }
+
+        return true;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::CatchUp(const std::vector<SubGridType*>& subgrids)
+    {
+        const uint32_t Generation = m_generationCount;
+
+        //
+        // Phase 1: subgrids stepped last generation copied their borders
+        // once all of their neighbors had been stepped, and nothing has
+        // changed since. Subgrids which slept through it catch up here.
+        //
+        m_threadPool.ParallelFor(m_chunkEnds, [&subgrids, Generation](size_t i, size_t)
+        {
+            SubGridType* pSubgrid = subgrids[i];
+            assert(pSubgrid->IsAwake(Generation));
+
+            if (pSubgrid->GetGeneration() != Generation)
+            {
+                pSubgrid->SkipToGeneration(Generation);
+                pSubgrid->CopyBorders();
+            }
+        });
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::PrepareWindow(
+        uint32_t numGenerations,
+        std::vector<SubGridType*>& subgridsOut
+        )
+    {
+        assert(numGenerations <= MAX_WINDOW_GENERATIONS);
+
+        const uint32_t Generation = m_generationCount;
+
+        std::vector<SubGridType*> awakeSubgrids;
+        awakeSubgrids.swap(m_awakeSubgrids);
+
+        ScheduleChunks(awakeSubgrids);
+        CatchUp(awakeSubgrids);
+
+        //
+        // Only cells within a generation's worth of a changing cell can change
+        // in the next generation, and only awake subgrids have changing
+        // cells. Over a window of less than a subgrid, changes therefore stay
+        // within the awake subgrids and their neighbors, so those are all
+        // that need stepping, and everything else stays as it is.
+        //
+        // Neighbors which don't exist yet but might get living cells within
+        // the window are created up front, since the graph can't change
+        // while subgrids are being stepped.
+        //
+        std::vector<SubGridType*>& subgrids = subgridsOut;
+        subgrids.assign(awakeSubgrids.begin(), awakeSubgrids.end());
+
+        std::vector<GrowingSubgrid> growing;
+        for (SubGridType* pSubgrid : awakeSubgrids)
+        {
+            SubGridType* const* ppNeighbors = pSubgrid->GetNeighbors();
+
+            uint32_t newNeighbors = pSubgrid->GetNeighborsInReach(numGenerations);
+            for (int i = 0; i < AdjacencyIndex::MAX; i++)
+            {
+                if (ppNeighbors[i])
+                {
+                    subgrids.push_back(ppNeighbors[i]);
+                    newNeighbors &= ~(1 << i);
+                }
+            }
+
+            if (newNeighbors)
+            {
+                growing.emplace_back(pSubgrid, newNeighbors);
+            }
+        }
+
+        std::vector<SubGridType*> subgridsToAdd;
+        CreateNewNeighbors(growing, subgridsToAdd);
+        AddSubgrids(subgridsToAdd);
+
+        subgrids.insert(subgrids.end(), m_awakeSubgrids.begin(), m_awakeSubgrids.end());
+        m_awakeSubgrids.clear();
+
+        //
+        // Neighbors may be shared.
+        //
+        std::sort(subgrids.begin(), subgrids.end());
+        subgrids.erase(std::unique(subgrids.begin(), subgrids.end()), subgrids.end());
+        ScheduleChunks(subgrids);
+
+        for (SubGridType* pSubgrid : subgrids)
+        {
+            if (pSubgrid->IsDormant())
+            {
+                ForgetDormant(pSubgrid);
+            }
+
+            pSubgrid->SkipToGeneration(Generation);
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::AdvanceWindow(uint32_t numGenerations)
+    {
+        const uint32_t Generation = m_generationCount;
+        const uint32_t LastGeneration = Generation + numGenerations;
+
+        std::vector<SubGridType*> subgrids;
+        PrepareWindow(numGenerations, subgrids);
+
+        const size_t NumSubgrids = subgrids.size();
+        BuildDependents(subgrids);
+
+        //
+        // A subgrid can step from generation g once every neighbor being
+        // stepped has reached g, which is when its count of arrivals at g
+        // hits zero. A subgrid counts itself as one of the arrivals, so
+        // whichever arrival comes last queues up the step.
+        //
+        // Counts are kept by the parity of g; the one for g + 2 is reset
+        // when stepping from g, before any neighbor can get that far.
+        //
+        if (m_waitingCapacity < NumSubgrids)
+        {
+            m_spWaiting.reset(new std::atomic<uint32_t>[NumSubgrids * 2]);
+            m_waitingCapacity = NumSubgrids;
+        }
+
+        std::vector<size_t> firstSteps(NumSubgrids);
+        for (size_t i = 0; i < NumSubgrids; i++)
+        {
+            const uint32_t NumDependencies = static_cast<uint32_t>(m_dependentEnds[i + 1] - m_dependentEnds[i] + 1);
+            m_spWaiting[i * 2 + ((Generation + 1) & 1)] = NumDependencies;
+            firstSteps[i] = i;
+        }
+
+        m_numCells.resize(NumSubgrids);
+        m_threadPool.RunTasks(firstSteps, [this, &subgrids, LastGeneration](size_t i, size_t thread)
+        {
+            SubGridType* pSubgrid = subgrids[i];
+            const uint32_t StepGeneration = pSubgrid->GetGeneration();
+            const size_t FirstDependent = m_dependentEnds[i];
+            const size_t EndDependent = m_dependentEnds[i + 1];
+
+            m_spWaiting[i * 2 + (StepGeneration & 1)] = static_cast<uint32_t>(EndDependent - FirstDependent + 1);
+
+            pSubgrid->CopyBorders();
+            m_numCells[i] = pSubgrid->AdvanceGeneration();
+
+            if (StepGeneration + 1 == LastGeneration)
             {
-                assert(false);
-                throw std::exception("Uncrecoverable: Could not add new subgrids to storage!");
+                return;
             }
 
-            if (!m_gridGraph.AddSubgrids(subgridsToAdd))
+            const size_t Parity = (StepGeneration + 1) & 1;
+            if (--m_spWaiting[i * 2 + Parity] == 0)
             {
-                assert(false);
-                throw std::exception("Uncrecoverable: Could not add new subgrids to graph!");
+                m_threadPool.Spawn(i, thread);
+            }
+
+            for (size_t j = FirstDependent; j < EndDependent; j++)
+            {
+                const size_t Dependent = m_dependents[j];
+                if (--m_spWaiting[Dependent * 2 + Parity] == 0)
+                {
+                    m_threadPool.Spawn(Dependent, thread);
+                }
             }
+        });
+
+        //
+        // Everything stepped is now at the last generation, so finish it
+        // off like any other.
+        //
+        m_generationCount = LastGeneration - 1;
+        FinishGeneration(subgrids);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::AdvanceBlock(uint32_t numGenerations)
+    {
+        assert(numGenerations >= 2 && numGenerations <= MAX_HALO_DEPTH);
+
+        std::vector<SubGridType*> subgrids;
+        PrepareWindow(numGenerations, subgrids);
+
+        //
+        // Every subgrid gathers its halo before any of them steps, since
+        // stepping overwrites the live rows its neighbors gather from.
+        //
+        const size_t HaloSize = SubGridType::GetHaloSize(numGenerations);
+        m_halos.resize(subgrids.size() * HaloSize);
+        m_threadPool.ParallelFor(m_chunkEnds, [this, &subgrids, numGenerations, HaloSize](size_t i, size_t)
+        {
+            subgrids[i]->GatherHalo(numGenerations, &m_halos[i * HaloSize]);
+        });
+
+        m_numCells.resize(subgrids.size());
+        m_threadPool.ParallelFor(m_chunkEnds, [this, &subgrids, numGenerations, HaloSize](size_t i, size_t)
+        {
+            m_numCells[i] = subgrids[i]->AdvanceGenerations(numGenerations, &m_halos[i * HaloSize]);
+        });
+
+        m_generationCount += numGenerations - 1;
+        FinishGeneration(subgrids);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::BuildDependents(const std::vector<SubGridType*>& subgrids)
+    {
+        const size_t NumSubgrids = subgrids.size();
+
+        //
+        // Index of each subgrid by handle, or NumSubgrids for the ones which
+        // aren't being stepped.
+        //
+        std::vector<size_t> indices(m_subgridStorage.GetHandleCapacity(), NumSubgrids);
+        for (size_t i = 0; i < NumSubgrids; i++)
+        {
+            indices[subgrids[i]->GetHandle()] = i;
         }
 
-        PopulateAdjacencyInfo(m_subgridStorage.begin(), m_subgridStorage.end());
+        m_dependents.clear();
+        m_dependentEnds.assign(1, 0);
+        for (size_t i = 0; i < NumSubgrids; i++)
+        {
+            SubGridType* const* ppNeighbors = subgrids[i]->GetNeighbors();
+
+            //
+            // Small worlds wrap around, so a subgrid may neighbor itself or
+            // the same neighbor on more than one side.
+            //
+            const size_t FirstDependent = m_dependents.size();
+            for (int j = 0; j < AdjacencyIndex::MAX; j++)
+            {
+                const size_t Index = ppNeighbors[j] ? indices[ppNeighbors[j]->GetHandle()] : NumSubgrids;
+                if (Index == NumSubgrids || Index == i)
+                {
+                    continue;
+                }
+
+                if (std::find(m_dependents.begin() + FirstDependent, m_dependents.end(), Index) == m_dependents.end())
+                {
+                    m_dependents.push_back(Index);
+                }
+            }
+
+            m_dependentEnds.push_back(m_dependents.size());
+        }
     }
 
-    bool SparseGrid::AdvanceGeneration()
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::FinishGeneration(const std::vector<SubGridType*>& subgrids)
     {
-        std::vector<SubGridPtr> subgridsToAdd;
-        std::vector<SubGridPtr> subgridsToRemove;
-        for (auto it = m_subgridStorage.begin(); it != m_subgridStorage.end(); ++it)
+        //
+        // Phase 3: with every neighbor stepped, copy borders again so new
+        // neighbors and retirement are decided on up to date ghost cells,
+        // and note what needs doing about each subgrid.
+        //
+        m_threadPool.ParallelFor(m_chunkEnds, [this, &subgrids](size_t i, size_t thread)
+        {
+            SubGridType* pSubgrid = subgrids[i];
+            pSubgrid->CopyBorders();
+
+            StepNote note;
+            note.Index = i;
+            note.NewNeighbors = GetNewNeighborMask(*pSubgrid);
+            note.Retire = !m_numCells[i] && !pSubgrid->HasBorderCells();
+
+            if (pSubgrid->HasChanged() || note.NewNeighbors || note.Retire)
+            {
+                m_threadNotes[thread].push_back(note);
+            }
+        });
+
+        std::vector<StepNote> notes;
+        for (std::vector<StepNote>& threadNotes : m_threadNotes)
+        {
+            notes.insert(notes.end(), threadNotes.begin(), threadNotes.end());
+            threadNotes.clear();
+        }
+
+        std::sort(notes.begin(), notes.end());
+
+        std::vector<GrowingSubgrid> growing;
+        std::vector<SubGridType*> subgridsToRemove;
+        for (const StepNote& note : notes)
         {
-            auto spSubgrid = it->second;
-            const uint32_t NumCells = spSubgrid->AdvanceGeneration();
+            SubGridType* pSubgrid = subgrids[note.Index];
+
+            WakeChanged(pSubgrid);
+            if (note.NewNeighbors)
+            {
+                growing.emplace_back(pSubgrid, note.NewNeighbors);
+            }
 
-            MaybeCreateNewNeighbors(m_alignedPool, spSubgrid, *this, m_gridGraph, subgridsToAdd);
-            MaybeRetireSubgrid(NumCells, spSubgrid, subgridsToRemove);
+            if (note.Retire)
+            {
+                subgridsToRemove.push_back(pSubgrid);
+            }
         }
 
+        std::vector<SubGridType*> subgridsToAdd;
+        CreateNewNeighbors(growing, subgridsToAdd);
+
+        //
+        // Losing a neighbor can change whether a subgrid needs a new one or
+        // can be retired itself, so wake the neighbors of retired subgrids.
+        // Then make sure none of the retired subgrids are left awake.
+        //
         const size_t NumRemoved = subgridsToRemove.size();
         for (size_t i = 0; i < NumRemoved; i++)
         {
-            SubGridPtr spSubgrid = subgridsToRemove[i];
-            m_gridGraph.RemoveSubgrid(spSubgrid);
-            m_subgridStorage.Remove(spSubgrid);
+            SubGridType* const* ppNeighbors = subgridsToRemove[i]->GetNeighbors();
+
+            for (int j = 0; j < AdjacencyIndex::MAX; j++)
+            {
+                if (ppNeighbors[j])
+                {
+                    Wake(ppNeighbors[j], m_generationCount + 1);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < NumRemoved; i++)
+        {
+            subgridsToRemove[i]->Retire();
         }
 
-        const size_t NumAdded = subgridsToAdd.size();
-        if (NumAdded)
+        if (NumRemoved)
         {
-            if (!m_subgridStorage.Add(subgridsToAdd))
+            m_awakeSubgrids.erase(
+                std::remove_if(
+                    m_awakeSubgrids.begin(), m_awakeSubgrids.end(),
+                    [](SubGridType const* pSubgrid) { return pSubgrid->IsRetired(); }
+                    ),
+                m_awakeSubgrids.end()
+                );
+        }
+
+        for (size_t i = 0; i < NumRemoved; i++)
+        {
+            SubGridType* pSubgrid = subgridsToRemove[i];
+            m_gridGraph.RemoveSubgrid(pSubgrid);
+            m_subgridStorage.Remove(pSubgrid);
+        }
+
+        AddSubgrids(subgridsToAdd);
+
+        m_generationCount++;
+        UpdateSleepers(subgrids);
+        EnforceMemoryBudget();
+        PrefetchSpilled();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::ScheduleChunks(std::vector<SubGridType*>& subgrids)
+    {
+        //
+        // Along a Hilbert curve, consecutive subgrids are mostly neighbors
+        // and each chunk is a compact block of them rather than a long strip,
+        // so the borders a subgrid reads mostly belong to subgrids its thread
+        // just stepped. Row by row, a chunk is a strip, but is read in the
+        // order it's laid out in memory.
+        //
+        std::vector<std::pair<uint64_t, SubGridType*>> ordered;
+        ordered.reserve(subgrids.size());
+        for (SubGridType* pSubgrid : subgrids)
+        {
+            ordered.emplace_back(GetScheduleKey(pSubgrid->XMin(), pSubgrid->YMin()), pSubgrid);
+        }
+
+        std::sort(ordered.begin(), ordered.end());
+        for (size_t i = 0; i < ordered.size(); i++)
+        {
+            subgrids[i] = ordered[i].second;
+        }
+
+        //
+        // Stepping a subgrid costs a little for every living cell on top of
+        // a fixed amount per row, taken to be a few cells' worth. Aim for
+        // several chunks per thread so there's something left to steal, but
+        // make them worth waking a thread for, i.e. a few dozen small
+        // subgrids; small worlds run entirely on the calling thread.
+        //
+        static const uint64_t SubgridCost = TileHeight * 4;
+        static const uint64_t MinChunkCost = 4096;
+
+        uint64_t totalCost = 0;
+        for (SubGridType const* pSubgrid : subgrids)
+        {
+            totalCost += SubgridCost + pSubgrid->GetLiveCellCount();
+        }
+
+        const uint64_t ChunkCost = std::max(totalCost / (m_threadPool.GetThreadCount() * 8), MinChunkCost);
+
+        m_chunkEnds.clear();
+        uint64_t chunkCost = 0;
+        for (size_t i = 0; i < subgrids.size(); i++)
+        {
+            chunkCost += SubgridCost + subgrids[i]->GetLiveCellCount();
+            if (chunkCost >= ChunkCost)
             {
-                assert(false);
-                throw std::exception("Unrecoverable: Could not add new subgrid to storage!");
+                m_chunkEnds.push_back(i + 1);
+                chunkCost = 0;
             }
+        }
+
+        if (chunkCost)
+        {
+            m_chunkEnds.push_back(subgrids.size());
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint64_t SparseGrid<TileWidth, TileHeight>::GetScheduleKey(int64_t subgridMinX, int64_t subgridMinY) const
+    {
+        const uint32_t X = static_cast<uint32_t>((subgridMinX - XMin()) / TileWidth);
+        const uint32_t Y = static_cast<uint32_t>((subgridMinY - YMin()) / TileHeight);
+        if (m_scheduleOrder == ScheduleOrder::RowMajor)
+        {
+            return (static_cast<uint64_t>(Y) << 32) | X;
+        }
+
+        return Utility::GetHilbertIndex(X, Y);
+    }
 
-            if (!m_gridGraph.AddSubgrids(subgridsToAdd))
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::UpdateSleepers(const std::vector<SubGridType*>& subgrids)
+    {
+        const uint32_t Generation = m_generationCount;
+
+        //
+        // Every subgrid is stepped in the generation before it falls asleep,
+        // so this catches all of them.
+        //
+        for (SubGridType const* pSubgrid : subgrids)
+        {
+            if (!pSubgrid->IsAwake(Generation))
             {
-                assert(false);
-                throw std::exception("Unrecoverable: Could not add new subgrid to graph!");
+                m_sleepers.emplace_back(Generation, pSubgrid->GetHandle());
             }
+        }
+
+        //
+        // A subgrid which has slept ever since is still at the generation it
+        // fell asleep at. Once woken it only moves on, and a subgrid created
+        // in a removed one's slot starts out later still.
+        //
+        while (!m_sleepers.empty() && Generation - m_sleepers.front().first >= DORMANT_AFTER_GENERATIONS)
+        {
+            MakeOldestSleeperDormant();
+        }
+    }
 
-            PopulateAdjacencyInfo(m_subgridStorage.begin(), m_subgridStorage.end());
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SparseGrid<TileWidth, TileHeight>::MakeOldestSleeperDormant()
+    {
+        if (m_sleepers.empty())
+        {
+            return false;
         }
-         
-        m_generationCount++;
+
+        const uint32_t SleptAt = m_sleepers.front().first;
+        SubGridType* pSubgrid = m_subgridStorage.FindSubgrid(m_sleepers.front().second);
+        m_sleepers.pop_front();
+
+        if (pSubgrid &&
+            pSubgrid->GetGeneration() == SleptAt &&
+            !pSubgrid->IsAwake(m_generationCount) &&
+            !pSubgrid->IsDormant())
+        {
+            pSubgrid->MakeDormant();
+            m_numDormant++;
+            m_dormantRowBytes += pSubgrid->GetDormantRowBytes();
+
+            if (m_memoryBudget.Bytes)
+            {
+                m_dormantSubgrids.emplace_back(SleptAt, pSubgrid->GetHandle());
+            }
+        }
+
         return true;
     }
 
-    void SparseGrid::PopulateAdjacencyInfo(
-        SubgridStorage::const_iterator begin,
-        SubgridStorage::const_iterator end
-        )
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SparseGrid<TileWidth, TileHeight>::SpillOldestDormant()
     {
-        const int64_t xMax = m_xMin + m_width;
-        const int64_t yMax = m_yMin + m_height;
+        if (m_dormantSubgrids.empty())
+        {
+            return false;
+        }
+
+        //
+        // Dormant subgrids stay at the generation they fell asleep at, so
+        // the same checks as for sleepers tell whether one has woken since.
+        // Woken ones may not have been rehydrated yet.
+        //
+        const uint32_t SleptAt = m_dormantSubgrids.front().first;
+        SubGridType* pSubgrid = m_subgridStorage.FindSubgrid(m_dormantSubgrids.front().second);
+        m_dormantSubgrids.pop_front();
 
-        for (auto it = begin; it != end; ++it)
+        if (pSubgrid &&
+            pSubgrid->GetGeneration() == SleptAt &&
+            !pSubgrid->IsAwake(m_generationCount) &&
+            pSubgrid->IsDormant() &&
+            !pSubgrid->IsSpilled())
         {
-            const SubGridPtr spSubgrid = it->second;
-            const auto SubgridCoordinates = std::make_pair(spSubgrid->XMin(), spSubgrid->YMin());
-            for (int i = 0; i < AdjacencyIndex::MAX; i++)
+            const size_t RowBytes = pSubgrid->GetDormantRowBytes();
+            if (RowBytes)
+            {
+                if (!m_spSpillFile)
+                {
+                    m_spSpillFile.reset(new Utility::SpillFile(
+                        m_memoryBudget.SpillDirectory,
+                        SubGridType::GetSpillRecordSize()
+                        ));
+                }
+
+                pSubgrid->Spill(*m_spSpillFile);
+                m_dormantRowBytes -= RowBytes;
+            }
+        }
+
+        return true;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::EnforceMemoryBudget()
+    {
+        if (!m_memoryBudget.Bytes)
+        {
+            return;
+        }
+
+        //
+        // Dormant subgrids all fell asleep before any of the sleepers, so
+        // they're the coldest, and spilling them doesn't cost anything until
+        // they're read again.
+        //
+        const size_t NumSpilled = CountSpilledTiles();
+        while (GetMemoryUsage() > m_memoryBudget.Bytes)
+        {
+            if (!SpillOldestDormant() && !MakeOldestSleeperDormant())
+            {
+                break;
+            }
+        }
+
+        //
+        // Whatever was just written only needs to stay in the file cache.
+        //
+        if (CountSpilledTiles() > NumSpilled)
+        {
+            m_spSpillFile->Evict();
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::PrefetchSpilled()
+    {
+        if (!CountSpilledTiles())
+        {
+            return;
+        }
+
+        for (SubGridType const* pSubgrid : m_awakeSubgrids)
+        {
+            if (pSubgrid->IsSpilled())
             {
-                const AdjacencyIndex Adjacency = static_cast<AdjacencyIndex>(i);
-                const auto Delta = SubGridGraph::GetNeighborPositionFromIndex(Adjacency);
-                const auto NeighborCoordinates = GetNeighborCoordinates(*spSubgrid, *this, Delta);
+                pSubgrid->PrefetchSpilled();
+            }
 
-                SubGridPtr spNeighbor;
-                if (m_gridGraph.QuerySubgrid(NeighborCoordinates, spNeighbor))
+            SubGridType* const* ppNeighbors = pSubgrid->GetNeighbors();
+            for (int i = 0; i < AdjacencyIndex::MAX; i++)
+            {
+                if (ppNeighbors[i] && ppNeighbors[i]->IsSpilled())
                 {
-                    m_gridGraph.AddEdge(spSubgrid, spNeighbor, Adjacency);
+                    ppNeighbors[i]->PrefetchSpilled();
                 }
             }
         }
     }
 
-    std::ostream& operator<<(std::ostream& out, const SparseGrid& grid)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::ForgetDormant(SubGridType const* pSubgrid)
     {
-        out << "(" << grid.XMin() << "," << grid.YMin() << "," << grid.Width() << "," << grid.Height() << ")\n"
-            << grid.m_generationCount << "\n"
-            << grid.m_subgridStorage.GetSize() << "\n";
+        assert(pSubgrid->IsDormant() && m_numDormant);
+
+        m_numDormant--;
+        m_dormantRowBytes -= pSubgrid->GetDormantRowBytes();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SparseGrid<TileWidth, TileHeight>::GetMemoryUsage() const
+    {
+        const size_t NumTiles = m_subgridStorage.GetSize();
+        return NumTiles * sizeof(SubGridType) +
+               (NumTiles - m_numDormant) * 2 * m_cellGridBufferSize +
+               m_dormantRowBytes;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::Wake(SubGridType* pSubgrid, uint32_t generation)
+    {
+        //
+        // A dormant subgrid is rehydrated when it catches up, the first time
+        // it's woken.
+        //
+        const bool Rehydrates = pSubgrid->IsDormant() && !pSubgrid->IsAwake(m_generationCount);
 
-        for (auto it = grid.begin(); it != grid.end(); ++it)
+        if (pSubgrid->Wake(generation))
         {
-            const SubGridPtr& spSubgrid = it->second;
-            out << "(" << spSubgrid->XMin() << "," << spSubgrid->YMin() << "," << spSubgrid->Width() << "," << spSubgrid->Height() << ")\n";
+            if (Rehydrates)
+            {
+                ForgetDormant(pSubgrid);
+            }
+
+            m_awakeSubgrids.push_back(pSubgrid);
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::WakeChanged(SubGridType* pSubgrid)
+    {
+        if (!pSubgrid->HasChanged())
+        {
+            return;
+        }
+
+        const uint32_t Generation = pSubgrid->GetGeneration();
+        Wake(pSubgrid, Generation);
+
+        SubGridType* const* ppNeighbors = pSubgrid->GetNeighbors();
+
+        const uint32_t ChangedBorders = pSubgrid->GetChangedBorders();
+        for (int i = 0; i < AdjacencyIndex::MAX; i++)
+        {
+            if (ppNeighbors[i] && (ChangedBorders & (1 << i)))
+            {
+                Wake(ppNeighbors[i], Generation);
+            }
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::CreateNewNeighbors(
+        const std::vector<GrowingSubgrid>& growing,
+        std::vector<SubGridType*>& subgridsOut
+        )
+    {
+        size_t numNeighbors = 0;
+        for (const GrowingSubgrid& subgrid : growing)
+        {
+            numNeighbors += Utility::PopCount(subgrid.second);
+        }
+
+        if (!numNeighbors)
+        {
+            return;
+        }
+
+        //
+        // It's possible that more than one subgrid will demand the same new
+        // neighbor, possibly on different threads. The map hands all of them
+        // the same one, and only the thread which created it keeps it.
+        //
+        m_newSubgrids.Reset(numNeighbors);
+        m_subgridStorage.Reserve(numNeighbors);
+        m_threadPool.ParallelFor(growing.size(), 16, [this, &growing](size_t i, size_t thread)
+        {
+            SubGridType* pSubgrid = growing[i].first;
+            const uint32_t NewNeighbors = growing[i].second;
 
-            const int64_t YMax = spSubgrid->YMin() + spSubgrid->Height();
-            const int64_t XMax = spSubgrid->XMin() + spSubgrid->Width();
-            for (int64_t y = spSubgrid->YMin(); y < YMax; y++)
+            for (int j = 0; j < AdjacencyIndex::MAX; j++)
             {
-                for (int64_t x = spSubgrid->XMin(); x < XMax; x++)
+                if (!(NewNeighbors & (1 << j)))
                 {
-                    if (spSubgrid->GetCellState(x, y))
-                    {
-                        out << "1";
-                    }
-                    else
-                    {
-                        out << "0";
-                    }
+                    continue;
+                }
+
+                const auto Delta = GraphType::GetNeighborPositionFromIndex(static_cast<AdjacencyIndex>(j));
+                const CoordinateType Coordinates = GetNeighborCoordinates(*pSubgrid, *this, Delta);
 
-                    if (x < XMax - 1)
+                //
+                // Subgrids with an edge to the new neighbor would have said
+                // so, but a subgrid may wrap around to neighbor itself.
+                //
+                if (m_gridGraph.QuerySubgrid(Coordinates))
+                {
+                    continue;
+                }
+
+                bool inserted;
+                SubGridType* pNeighbor = m_newSubgrids.InsertIfAbsent(
+                    Coordinates,
+                    [this, pSubgrid, &Coordinates]()
                     {
-                        out << ",";
-                    }
+                        return m_subgridStorage.Create(
+                            m_alignedPool,
+                            pSubgrid->GetCellFormat(),
+                            Coordinates.first, Coordinates.second,
+                            pSubgrid->GetGeneration()
+                            );
+                    },
+                    inserted);
+
+                if (inserted)
+                {
+                    m_threadNewSubgrids[thread].emplace_back(pNeighbor);
                 }
-                out << "\n";
             }
+        });
+
+        for (std::vector<SubGridType*>& newSubgrids : m_threadNewSubgrids)
+        {
+            subgridsOut.insert(subgridsOut.end(), newSubgrids.begin(), newSubgrids.end());
+            newSubgrids.clear();
         }
-        out.flush();
 
-        return out;
+        //
+        // Which thread got to create which subgrid varies from run to run, so
+        // put them back in a fixed order.
+        //
+        std::sort(subgridsOut.begin(), subgridsOut.end(), [](SubGridType const* pLeft, SubGridType const* pRight)
+        {
+            return pLeft->GetCoordinates() < pRight->GetCoordinates();
+        });
     }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::AddSubgrids(const std::vector<SubGridType*>& subgrids)
+    {
+        if (subgrids.empty())
+        {
+            return;
+        }
+
+        //
+        // We've got a nasty bug somewhere if there are any duplicates, so fail
+        // hard if that's the case.
+        //
+        if (!m_gridGraph.AddSubgrids(subgrids))
+        {
+            assert(false);
+            throw std::exception("Unrecoverable: Could not add new subgrid to graph!");
+        }
+
+        m_subgridStorage.Add(subgrids);
+
+        for (SubGridType* pSubgrid : subgrids)
+        {
+            LinkNeighbors(pSubgrid);
+        }
+
+        //
+        // New subgrids are created awake and already at the next
+        // generation, so phase 1 won't copy their borders.
+        //
+        for (SubGridType* pSubgrid : subgrids)
+        {
+            pSubgrid->CopyBorders();
+            m_awakeSubgrids.push_back(pSubgrid);
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::LinkNeighbors(SubGridType* pSubgrid)
+    {
+        for (int i = 0; i < AdjacencyIndex::MAX; i++)
+        {
+            const AdjacencyIndex Adjacency = static_cast<AdjacencyIndex>(i);
+            const auto Delta = GraphType::GetNeighborPositionFromIndex(Adjacency);
+            const auto NeighborCoordinates = GetNeighborCoordinates(*pSubgrid, *this, Delta);
+
+            SubGridType* pNeighbor;
+            if (m_gridGraph.QuerySubgrid(NeighborCoordinates, pNeighbor))
+            {
+                m_gridGraph.AddEdge(pSubgrid, pNeighbor, Adjacency);
+            }
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SparseGrid<TileWidth, TileHeight>::ForEachTile(const std::function<void(const Tile&)>& visitor) const
+    {
+        for (SubGridType const* pSubgrid : m_subgridStorage)
+        {
+            visitor(*pSubgrid);
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SparseGrid<TileWidth, TileHeight>::CountTiles(TileActivity activity) const
+    {
+        size_t count = 0;
+        for (SubGridType const* pSubgrid : m_subgridStorage)
+        {
+            if (pSubgrid->GetActivity() == activity)
+            {
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SparseGrid<TileWidth, TileHeight>::CountDormantTiles() const
+    {
+        size_t count = 0;
+        for (SubGridType const* pSubgrid : m_subgridStorage)
+        {
+            if (pSubgrid->IsDormant())
+            {
+                count++;
+            }
+        }
+
+        return count;
+    }
+
+    size_t GetCellGridBufferSize(int64_t tileSize, CellLayout cellLayout)
+    {
+        switch (tileSize)
+        {
+        case 30:
+            return SubGrid<30, 30>::GetCellGridBufferSize(cellLayout);
+        case 62:
+            return SubGrid<62, 62>::GetCellGridBufferSize(cellLayout);
+        case 126:
+            return SubGrid<126, 126>::GetCellGridBufferSize(cellLayout);
+        default:
+            throw std::exception("Unsupported subgrid size.");
+        }
+    }
+
+    std::unique_ptr<Engine> CreateSparseGrid(
+        int64_t tileSize,
+        const std::vector<Cell>& initialState,
+        Utility::AlignedMemoryPool<64>& memoryPool,
+        const CellFormat& cellFormat,
+        size_t numThreads,
+        uint32_t haloDepth,
+        const MemoryBudget& memoryBudget
+    )
+    {
+        switch (tileSize)
+        {
+        case 30:
+            return std::unique_ptr<Engine>(new SparseGrid<30, 30>(initialState, memoryPool, cellFormat, numThreads, haloDepth, memoryBudget));
+        case 62:
+            return std::unique_ptr<Engine>(new SparseGrid<62, 62>(initialState, memoryPool, cellFormat, numThreads, haloDepth, memoryBudget));
+        case 126:
+            return std::unique_ptr<Engine>(new SparseGrid<126, 126>(initialState, memoryPool, cellFormat, numThreads, haloDepth, memoryBudget));
+        default:
+            throw std::exception("Unsupported subgrid size.");
+        }
+    }
+
+    template class SparseGrid<30, 30>;
+    template class SparseGrid<62, 62>;
+    template class SparseGrid<126, 126>;
 }
@@ -1,17 +1,25 @@
 #pragma once
 
-// 
+//
 // The full game state. Just a 2D array for now.
 //
 
+#include "Engine.h"
 #include "SubGrid.h"
 #include "SubgridStorage.h"
 #include "Cell.h"
 #include "RectangularGrid.h"
 #include "SubgridGraph.h"
+#include "ConcurrentTileMap.h"
 
 #include <Utility/AlignedMemoryPool.h>
+#include <Utility/SpillFile.h>
+#include <Utility/ThreadPool.h>
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <string>
 #include <vector>
 #include <ostream>
 
@@ -26,44 +34,427 @@ namespace Utility
 
 namespace GameOfLife
 {
-    class SparseGrid : public RectangularGrid
+    //
+    // How much memory a SparseGrid's subgrids may take up before the coldest
+    // ones are pushed out to a spill file in SpillDirectory, or the system's
+    // temporary directory if that's empty. Zero bytes means no limit.
+    //
+    struct MemoryBudget
+    {
+        MemoryBudget(size_t bytes = 0, const std::string& spillDirectory = std::string())
+            : Bytes(bytes), SpillDirectory(spillDirectory)
+        {}
+
+        size_t      Bytes;
+        std::string SpillDirectory;
+    };
+
+    //
+    // Order a SparseGrid steps its subgrids in, which is also the order the
+    // initial ones are laid out in memory. Hilbert keeps each chunk of
+    // subgrids a compact block of neighbors; RowMajor steps them row by row,
+    // which prefetches better while a row of tiles still fits in cache.
+    //
+    enum class ScheduleOrder
+    {
+        Hilbert,
+        RowMajor
+    };
+
+    //
+    // Subgrid dimensions are fixed at compile time; SparseGrid.cpp
+    // instantiates 30x30, 62x62 and 126x126, i.e. padded rows of 32, 64 and
+    // 128 cells. CreateSparseGrid() picks between them at runtime.
+    //
+    // Each generation runs in phases separated by barriers, spreading the
+    // subgrids of every phase over a thread pool in spatially contiguous
+    // chunks of about the same cost:
+    //
+    // 1. Subgrids woken this generation copy their neighbors' borders.
+    // 2. Every awake subgrid is stepped.
+    // 3. Stepped subgrids copy their neighbors' new borders, then note
+    //    whether they changed, need new neighbors or can be retired.
+    //
+    // Within a phase, subgrids only write to themselves and read data their
+    // neighbors don't write in that phase. The notes from phase 3 are then
+    // merged on the calling thread in a fixed order, so the results don't
+    // depend on the number of threads.
+    //
+    // StepPow2() drops the barriers between phases 1 through 3 for windows
+    // of several generations. Every subgrid which could change within the
+    // window is stepped as soon as its neighbors have reached its
+    // generation, so a slow subgrid only holds up its own neighborhood.
+    // A neighbor then reads the generation it needs from whichever of our
+    // two cell grids holds it, so subgrids never keep more history than
+    // they already do. The window ends with phase 3 and the merge as usual.
+    //
+    // With a halo depth k above one, StepPow2() instead advances blocks of k
+    // generations with just two barriers each: every subgrid which could
+    // change gathers the cells within k of it from its neighbors, then
+    // steps k generations on its own. Borders are exchanged once per block
+    // rather than twice per generation.
+    //
+    // Subgrids which sleep long enough go dormant, keeping only their packed
+    // living rows. Past the memory budget, dormant subgrids are spilled to a
+    // file, oldest first, and sleeping ones go dormant early, the ones which
+    // changed least recently first. Only awake subgrids are never pushed
+    // out, so a budget smaller than they need isn't met. Spilled subgrids
+    // bordering awake ones are prefetched a generation ahead, since those
+    // are the ones which get read or woken next.
+    //
+    template <int64_t TileWidth, int64_t TileHeight>
+    class SparseGrid : public Engine
     {
     public:
+        typedef SubGrid<TileWidth, TileHeight> SubGridType;
+        typedef SubgridStorage<TileWidth, TileHeight> StorageType;
+        typedef SubGridGraph<TileWidth, TileHeight> GraphType;
+
+        //
+        // The memory pool's sublocks must be sized for the requested cell
+        // layout; see SubGrid::GetCellGridBufferSize(). numThreads includes
+        // the calling thread; zero uses every hardware thread. haloDepth is
+        // the number of generations StepPow2() advances per border exchange,
+        // clamped to MAX_HALO_DEPTH; one steps in windows instead.
+        //
         SparseGrid(
             const std::vector<Cell>& initialState,
-            Utility::AlignedMemoryPool<64>& memoryPool
+            Utility::AlignedMemoryPool<64>& memoryPool,
+            const CellFormat& cellFormat = CellFormat(),
+            size_t numThreads = 0,
+            uint32_t haloDepth = 1,
+            const MemoryBudget& memoryBudget = MemoryBudget(),
+            ScheduleOrder scheduleOrder = DEFAULT_SCHEDULE_ORDER
         );
 
-        bool AdvanceGeneration();
+        bool AdvanceGeneration() override;
+
+        //
+        // Advances 2^k generations in windows of up to
+        // MAX_WINDOW_GENERATIONS, with the subgrids in each window running
+        // ahead of each other as far as their neighbors allow, or in blocks
+        // of the halo depth.
+        //
+        bool StepPow2(uint32_t k) override;
+
+        //
+        // Changes spread a cell per generation, so within this many they
+        // can't cross more than one subgrid.
+        //
+        static const uint32_t MAX_WINDOW_GENERATIONS =
+            (TileWidth < TileHeight ? TileWidth : TileHeight) / 2;
+
+        //
+        // Blocks are bounded by windows for the same reason, and by how far
+        // a subgrid can look into its neighbors.
+        //
+        static const uint32_t MAX_HALO_DEPTH =
+            MAX_WINDOW_GENERATIONS < SubGridType::MAX_HALO_DEPTH ?
+            MAX_WINDOW_GENERATIONS : SubGridType::MAX_HALO_DEPTH;
+
+        uint32_t GetHaloDepth() const { return m_haloDepth; }
+
+        //
+        // Row by row measured as fast or faster for 30 and 62 cell wide
+        // subgrids, and within noise of Hilbert order for 126 cell wide ones,
+        // on one thread. Hilbert order stays opt in until it's shown to help
+        // with several threads; see the order benchmark in Test/Benchmarks.
+        //
+        static const ScheduleOrder DEFAULT_SCHEDULE_ORDER = ScheduleOrder::RowMajor;
+
+        uint32_t GetGeneration() const override { return m_generationCount; }
+
+        size_t GetTileCount() const override { return m_subgridStorage.GetSize(); }
+
+        //
+        // Number of subgrids which will be stepped next generation.
+        //
+        size_t GetAwakeTileCount() const { return m_awakeSubgrids.size(); }
+
+        //
+        // Number of subgrids whose last step matches the given activity.
+        //
+        size_t CountTiles(TileActivity activity) const;
+
+        //
+        // Number of subgrids which have slept long enough to go dormant;
+        // see SubGrid::MakeDormant().
+        //
+        size_t CountDormantTiles() const;
+
+        //
+        // Subgrids which have slept through this many generations go
+        // dormant, so ones which are only briefly still, like those next to
+        // a passing glider, don't keep giving up their cell grids and taking
+        // them back.
+        //
+        static const uint32_t DORMANT_AFTER_GENERATIONS = 16;
 
-        uint32_t GetGeneration() const { return m_generationCount; }
+        //
+        // Number of dormant subgrids whose rows are in the spill file.
+        //
+        size_t CountSpilledTiles() const { return m_spSpillFile ? m_spSpillFile->GetRecordCount() : 0; }
+
+        //
+        // Bytes the subgrids take up, as counted against the memory budget:
+        // the subgrids themselves, the cell grids of those which aren't
+        // dormant and the packed rows of those which are, unless spilled.
+        //
+        size_t GetMemoryUsage() const;
 
-        SubgridStorage::iterator begin() { return m_subgridStorage.begin(); }
-        SubgridStorage::iterator end()   { return m_subgridStorage.end(); }
-        SubgridStorage::const_iterator begin() const { return m_subgridStorage.begin(); }
-        SubgridStorage::const_iterator end()   const { return m_subgridStorage.end(); }
+        void ForEachTile(const std::function<void(const Tile&)>& visitor) const override;
 
-        friend std::ostream& operator<<(std::ostream& out, const SparseGrid& grid);
+        typename StorageType::iterator begin() { return m_subgridStorage.begin(); }
+        typename StorageType::iterator end()   { return m_subgridStorage.end(); }
+        typename StorageType::const_iterator begin() const { return m_subgridStorage.begin(); }
+        typename StorageType::const_iterator end()   const { return m_subgridStorage.end(); }
 
     private:
         SparseGrid() = delete;
         SparseGrid(const SparseGrid& other) = delete;
         SparseGrid& operator=(const SparseGrid& other) = delete;
 
-        void 
-        PopulateAdjacencyInfo(
-            SubgridStorage::const_iterator begin,
-            SubgridStorage::const_iterator end
+        //
+        // A subgrid and the mask of new neighbors it needs; see
+        // GetNewNeighborMask() in SparseGrid.cpp.
+        //
+        typedef std::pair<SubGridType*, uint32_t> GrowingSubgrid;
+
+        //
+        // Creates every neighbor the growing subgrids need, on the thread
+        // pool, and appends each one once to subgridsOut. Doesn't add them
+        // to storage or the graph.
+        //
+        void CreateNewNeighbors(
+            const std::vector<GrowingSubgrid>& growing,
+            std::vector<SubGridType*>& subgridsOut
             );
 
-        SubgridStorage m_subgridStorage;
+        //
+        // Adds new subgrids to storage and the graph, links them to their
+        // neighbors, copies their borders and wakes them.
+        //
+        void AddSubgrids(const std::vector<SubGridType*>& subgrids);
+
+        //
+        // Adds graph edges between a subgrid and each of its neighbors.
+        //
+        void LinkNeighbors(SubGridType* pSubgrid);
+
+        //
+        // Phase 1 for the subgrids scheduled in m_chunkEnds.
+        //
+        void CatchUp(const std::vector<SubGridType*>& subgrids);
+
+        //
+        // Phase 3 and the merge for the subgrids scheduled in m_chunkEnds,
+        // once they've been stepped to the next generation with their
+        // number of living cells in m_numCells.
+        //
+        void FinishGeneration(const std::vector<SubGridType*>& subgrids);
+
+        //
+        // Catches up the awake subgrids and gathers every subgrid which could
+        // change within the next numGenerations generations into subgridsOut,
+        // creating the neighbors it takes first. They're all brought to the
+        // current generation and scheduled in m_chunkEnds.
+        //
+        void PrepareWindow(uint32_t numGenerations, std::vector<SubGridType*>& subgridsOut);
+
+        //
+        // Advances numGenerations generations, up to MAX_WINDOW_GENERATIONS,
+        // without a barrier between them.
+        //
+        void AdvanceWindow(uint32_t numGenerations);
+
+        //
+        // Advances numGenerations generations, from two up to
+        // MAX_HALO_DEPTH, in a single block.
+        //
+        void AdvanceBlock(uint32_t numGenerations);
+
+        //
+        // Fills m_dependents and m_dependentEnds with the distinct
+        // neighbors of each subgrid which are among subgrids themselves.
+        //
+        void BuildDependents(const std::vector<SubGridType*>& subgrids);
+
+        //
+        // Wakes pSubgrid through the given generation, queuing it up to be
+        // stepped if it was asleep.
+        //
+        void Wake(SubGridType* pSubgrid, uint32_t generation);
+
+        //
+        // After pSubgrid has been stepped, keeps it awake if any of its cells
+        // changed and wakes the neighbors which can see the change.
+        //
+        void WakeChanged(SubGridType* pSubgrid);
+
+        //
+        // Sorts the subgrids into the schedule order and splits them into
+        // chunks for the thread pool, in m_chunkEnds.
+        //
+        void ScheduleChunks(std::vector<SubGridType*>& subgrids);
+
+        //
+        // Position in the schedule order of the subgrid whose upper-left
+        // corner is at the given world coordinates.
+        //
+        uint64_t GetScheduleKey(int64_t subgridMinX, int64_t subgridMinY) const;
+
+        //
+        // Notes which of the subgrids just stepped have fallen asleep, and
+        // makes dormant the ones noted DORMANT_AFTER_GENERATIONS ago which
+        // haven't woken since.
+        //
+        void UpdateSleepers(const std::vector<SubGridType*>& subgrids);
+
+        //
+        // Makes the subgrid which fell asleep longest ago dormant if it's
+        // still asleep, and stops tracking it either way. Returns false if
+        // there were no sleepers left.
+        //
+        bool MakeOldestSleeperDormant();
+
+        //
+        // The same for spilling the subgrid which went dormant longest ago.
+        //
+        bool SpillOldestDormant();
+
+        //
+        // Spills dormant subgrids and makes sleeping ones dormant early
+        // until the subgrids fit in the memory budget, or only awake ones
+        // are left.
+        //
+        void EnforceMemoryBudget();
+
+        //
+        // Asks for the rows of spilled subgrids which are awake, or border
+        // awake ones, to be read back in ahead of the next generation.
+        //
+        void PrefetchSpilled();
+
+        //
+        // Counts a subgrid which is about to be rehydrated as no longer
+        // dormant, against the memory budget.
+        //
+        void ForgetDormant(SubGridType const* pSubgrid);
+
+        //
+        // What phase 3 found out about an awake subgrid, by its index into
+        // the generation's awake subgrids. Only subgrids with something to
+        // report are noted.
+        //
+        struct StepNote
+        {
+            size_t   Index;
+            uint32_t NewNeighbors;
+            bool     Retire;
+
+            bool operator<(const StepNote& other) const { return Index < other.Index; }
+        };
+
+        //
+        // Created the first time the memory budget is exceeded. Declared
+        // ahead of the storage so spilled subgrids can free their records
+        // when they're destroyed.
+        //
+        MemoryBudget m_memoryBudget;
+        std::unique_ptr<Utility::SpillFile> m_spSpillFile;
+
+        StorageType m_subgridStorage;
 
         //
         // Subgrid adjacency info
         //
-        SubGridGraph m_gridGraph;
+        GraphType m_gridGraph;
+
+        //
+        // Subgrids to step next generation. Everything else is asleep.
+        //
+        std::vector<SubGridType*> m_awakeSubgrids;
 
         Utility::AlignedMemoryPool<64>& m_alignedPool;
         uint32_t m_generationCount;
+        uint32_t m_haloDepth;
+        ScheduleOrder m_scheduleOrder;
+
+        Utility::ThreadPool m_threadPool;
+
+        //
+        // Scratch space for AdvanceGeneration(), kept around to save
+        // reallocating it every generation: where each chunk of awake
+        // subgrids ends, the number of living cells of each awake subgrid
+        // after stepping it, and one list of notes per thread.
+        //
+        std::vector<size_t> m_chunkEnds;
+        std::vector<uint32_t> m_numCells;
+        std::vector<std::vector<StepNote>> m_threadNotes;
+
+        //
+        // Scratch space for AdvanceWindow(): the neighbors of subgrid i are
+        // at m_dependents[m_dependentEnds[i]] up to m_dependentEnds[i + 1],
+        // and m_spWaiting holds two arrival counts per subgrid.
+        //
+        std::vector<size_t> m_dependents;
+        std::vector<size_t> m_dependentEnds;
+        std::unique_ptr<std::atomic<uint32_t>[]> m_spWaiting;
+        size_t m_waitingCapacity;
+
+        //
+        // Scratch space for AdvanceBlock(): the halo of each subgrid.
+        //
+        std::vector<uint64_t> m_halos;
+
+        //
+        // Subgrids by the generation they fell asleep at, oldest first. They
+        // may have woken or been removed since, so they're held by handle
+        // and checked again before going dormant.
+        //
+        std::deque<std::pair<uint32_t, SubgridHandle>> m_sleepers;
+
+        //
+        // With a memory budget, subgrids by the generation they fell asleep
+        // at once they've gone dormant, oldest first, checked again before
+        // being spilled in the same way.
+        //
+        std::deque<std::pair<uint32_t, SubgridHandle>> m_dormantSubgrids;
+
+        //
+        // For GetMemoryUsage(): the bytes of each cell grid buffer, the
+        // number of dormant subgrids and the packed rows they keep in memory.
+        // Subgrids woken but not yet rehydrated already count as awake.
+        //
+        size_t m_cellGridBufferSize;
+        size_t m_numDormant;
+        size_t m_dormantRowBytes;
+
+        //
+        // Subgrids born this generation, and the ones each thread created.
+        //
+        ConcurrentTileMap<SubGridType> m_newSubgrids;
+        std::vector<std::vector<SubGridType*>> m_threadNewSubgrids;
     };
+
+    //
+    // Size of a single cell grid buffer for subgrids tileSize cells on a side,
+    // for sizing the memory pool passed to CreateSparseGrid().
+    //
+    size_t GetCellGridBufferSize(int64_t tileSize, CellLayout cellLayout);
+
+    //
+    // Creates a SparseGrid with square subgrids tileSize cells on a side,
+    // stepped on numThreads threads with the given halo depth and memory
+    // budget. Throws if there is no instantiation for tileSize.
+    //
+    std::unique_ptr<Engine> CreateSparseGrid(
+        int64_t tileSize,
+        const std::vector<Cell>& initialState,
+        Utility::AlignedMemoryPool<64>& memoryPool,
+        const CellFormat& cellFormat = CellFormat(),
+        size_t numThreads = 0,
+        uint32_t haloDepth = 1,
+        const MemoryBudget& memoryBudget = MemoryBudget()
+    );
 }
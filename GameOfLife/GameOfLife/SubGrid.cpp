@@ -2,6 +2,12 @@
 #include "SubgridGraph.h"
 
 #include "DebugGridDumper.h"
+#include "Kernels/BitKernels.h"
+#include "Kernels/ByteKernels.h"
+#include "Kernels/VertexKernels.h"
+
+#include <Utility/Bits.h>
+#include <Utility/SpillFile.h>
 
 #include <limits>
 #include <algorithm>
@@ -19,291 +25,679 @@ namespace
         return pPointer == pOption1 ? pOption2 : pOption1;
     }
 
-    uint8_t CountNeighbors(
-        const GameOfLife::SubGrid& subGrid, 
-        int64_t x,
-        int64_t y
-        )
+    //
+    // ORs bits into a run of 64-bit words, with bit b of bits landing on bit
+    // b + position of the run. Bits landing before the start of the run or
+    // at limit and beyond are dropped. The run must have a word to spare
+    // past bit limit.
+    //
+    template <typename RowType>
+    void OrBitsAt(uint64_t* pWords, const RowType& bits, int64_t position, int64_t limit)
     {
-        using namespace GameOfLife;
-        uint8_t neighbors = 0;
-
-        for (int i = 0; i < GameOfLife::AdjacencyIndex::MAX; ++i)
+        static const uint32_t NumChunks = sizeof(RowType) * 8 / 32;
+        for (uint32_t i = 0; i < NumChunks; i++)
         {
-            const auto Adjacency = static_cast<AdjacencyIndex>(i);
-            SubGrid::CoordinateType offset = SubGridGraph::GetNeighborPositionFromIndex(Adjacency);
-            if (subGrid.GetCellState(x + offset.first, y + offset.second))
+            uint64_t chunk = Utility::LowWord(bits >> (32 * i));
+            int64_t first = position + 32 * i;
+            if (first < 0)
+            {
+                if (first <= -32)
+                {
+                    continue;
+                }
+
+                chunk >>= -first;
+                first = 0;
+            }
+
+            if (!chunk || first >= limit)
+            {
+                continue;
+            }
+
+            if (limit - first < 32)
+            {
+                chunk &= (uint64_t(1) << (limit - first)) - 1;
+            }
+
+            const int64_t Word = first / 64;
+            const uint32_t Shift = static_cast<uint32_t>(first % 64);
+            pWords[Word] |= chunk << Shift;
+            if (Shift > 32)
             {
-                neighbors++;
+                pWords[Word + 1] |= chunk >> (64 - Shift);
             }
         }
+    }
+
+    //
+    // Writes count byte-per-cell cells from the bits of a row, starting at
+    // bit first, eight at a time: multiplying copies the bits into every
+    // byte, byte k keeps just bit k, and adding 0x7F carries any bit kept
+    // up to bit 7 without spilling into the next byte.
+    //
+    template <typename RowType>
+    void ExpandBits(const RowType& bits, uint32_t first, int64_t count, uint8_t* pDst)
+    {
+        for (int64_t x = 0; x < count; x += 8)
+        {
+            const uint64_t Bits = Utility::LowWord(bits >> (first + static_cast<uint32_t>(x))) & 0xFF;
+            const uint64_t Spread = (Bits * 0x0101010101010101ull) & 0x8040201008040201ull;
+            const uint64_t Cells = ((Spread + 0x7F7F7F7F7F7F7F7Full) & 0x8080808080808080ull) >> 7;
+            memcpy(pDst + x, &Cells, static_cast<size_t>(std::min<int64_t>(8, count - x)));
+        }
+    }
 
-        return neighbors;
+    //
+    // Shifts a 64-bit strip of cells into place within a row, left for a
+    // positive shift and right for a negative one.
+    //
+    template <typename RowType>
+    RowType PlaceStrip(uint64_t bits, int64_t shift)
+    {
+        return shift >= 0 ?
+            static_cast<RowType>(bits) << static_cast<uint32_t>(shift) :
+            static_cast<RowType>(bits >> static_cast<uint32_t>(-shift));
     }
+
+    //
+    // Row steppers for SubGrid::StepHalo().
+    //
+    template <typename RuleT>
+    struct StaticRuleStepper
+    {
+        uint64_t operator()(uint64_t above, uint64_t row, uint64_t below) const
+        {
+            return GameOfLife::Kernels::RowStepper<RuleT>::Next(above, row, below);
+        }
+    };
+
+    struct RuntimeRuleStepper
+    {
+        explicit RuntimeRuleStepper(const GameOfLife::Rule& lifeRule) : LifeRule(lifeRule) {}
+
+        uint64_t operator()(uint64_t above, uint64_t row, uint64_t below) const
+        {
+            return GameOfLife::Kernels::NextGenerationRowForRule(LifeRule, above, row, below);
+        }
+
+        GameOfLife::Rule LifeRule;
+    };
 }
 
 namespace GameOfLife
 {
-    SubGrid::SubGrid(
+    template <int64_t TileWidth, int64_t TileHeight>
+    SubGrid<TileWidth, TileHeight>::SubGrid(
         Utility::AlignedMemoryPool<64>& memoryPool,
-        const RectangularGrid& worldBounds,
-        SubGridGraph& graph, 
+        const CellFormat& format,
         int64_t xmin, int64_t ymin,
         uint32_t generation
         )
-        : RectangularGrid(xmin, SubGrid::SUBGRID_WIDTH, ymin, SubGrid::SUBGRID_HEIGHT),
-          m_generation(generation),
-          m_pGridGraph(&graph),
+        : Tile(xmin, TileWidth, ymin, TileHeight),
           m_memoryPool(memoryPool),
-          m_worldBounds(worldBounds)
+          m_format(format),
+          m_staticRule(GetStaticRuleType(format.LifeRule)),
+          m_pLookupTable(nullptr),
+          m_generation(generation),
+          m_gridParity(generation & 1),
+          m_pSpillFile(nullptr),
+          m_spillRecord(0),
+          m_wakeGeneration(generation),
+          m_hasChanged(false),
+          m_changedBorders(0),
+          m_repeatsEveryOther(false),
+          m_isRetired(false)
     {
-        m_vertexData.reserve(SUBGRID_WIDTH * SUBGRID_HEIGHT);
-
         //
-        // +2 to make room for ghost buffers.
+        // Only the adder kernel is specialized for each StaticRule; anything
+        // else steps through the rule's lookup table.
         //
-        m_bufferWidth  = m_width + 2;
-        m_bufferHeight = m_height + 2;
+        if (m_format.Layout == CellLayout::BitPacked &&
+            (m_format.BitKernel == Kernels::BitKernelType::LookupTable ||
+             m_staticRule == StaticRuleType::None))
+        {
+            m_pLookupTable = Kernels::GetLifeLookupTable(m_format.LifeRule);
+        }
 
         m_pCellGrids[0] = m_memoryPool.Allocate();
         m_pCellGrids[1] = m_memoryPool.Allocate();
         m_pCurrentCellGrid = m_pCellGrids[0];
 
+        for (size_t i = 0; i < 2; i++)
+        {
+            m_liveRows[i] = reinterpret_cast<RowType*>(m_pCellGrids[i] + GetCellGridSize(m_format.Layout));
+            std::fill(m_liveRows[i], m_liveRows[i] + SUBGRID_HEIGHT, RowType(0));
+            m_liveRowMasks[i] = 0;
+            m_liveColumns[i] = 0;
+            m_liveCellCounts[i] = 0;
+            m_edges[i].Top = m_edges[i].Bottom = m_edges[i].Left = m_edges[i].Right = 0;
+            m_ghostRingGenerations[i] = std::numeric_limits<uint32_t>::max();
+        }
+
+        std::fill(m_pNeighbors, m_pNeighbors + AdjacencyIndex::MAX, nullptr);
+        m_handle = 0;
+
         m_coordinates = std::make_pair(m_xMin, m_yMin);
     }
 
-    SubGrid::~SubGrid()
+    template <int64_t TileWidth, int64_t TileHeight>
+    SubGrid<TileWidth, TileHeight>::~SubGrid()
     {
-        m_memoryPool.Free(m_pCellGrids[0]);
-        m_pCellGrids[0] = nullptr;
-        m_memoryPool.Free(m_pCellGrids[1]);
-        m_pCellGrids[1] = nullptr;
+        if (!IsDormant())
+        {
+            m_memoryPool.Free(m_pCellGrids[0]);
+            m_pCellGrids[0] = nullptr;
+            m_memoryPool.Free(m_pCellGrids[1]);
+            m_pCellGrids[1] = nullptr;
+        }
+
+        if (IsSpilled())
+        {
+            m_pSpillFile->Free(m_spillRecord);
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetCellGridBufferSize(CellLayout layout)
+    {
+        //
+        // Rounded up to the memory pool's alignment, which every sublock
+        // must be a multiple of.
+        //
+        const size_t Size = GetCellGridSize(layout) + sizeof(RowType) * SUBGRID_HEIGHT;
+        return (Size + 63) & ~static_cast<size_t>(63);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetCellGridSize(CellLayout layout)
+    {
+        //
+        // Padded rows are a multiple of 32 cells, so byte grids stay a whole
+        // number of vectors wide for the vectorized kernels.
+        //
+        switch (layout)
+        {
+        case CellLayout::BytePerCell:
+            return BUFFER_WIDTH * BUFFER_HEIGHT;
+        case CellLayout::BitPacked:
+        default:
+            return sizeof(RowType) * BUFFER_HEIGHT;
+        }
     }
 
-    size_t SubGrid::GetOffset(int64_t x, int64_t y) const
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetOffset(int64_t x, int64_t y) const
     {
         x = x - m_xMin + 1;
         y = y - m_yMin + 1;
 
         assert(x >= 0 && y >= 0);
-        assert(x < m_bufferWidth && y < m_bufferHeight);
+        assert(x < BUFFER_WIDTH && y < BUFFER_HEIGHT);
 
-        return static_cast<size_t>(x + m_bufferWidth * y);
+        return static_cast<size_t>(x + BUFFER_WIDTH * y);
     }
 
-    void SubGrid::RaiseCell(uint8_t* pGrid, int64_t x, int64_t y)
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetRowIndex(int64_t y) const
     {
-        pGrid[GetOffset(x, y)] = true;
+        y = y - m_yMin + 1;
 
-        //
-        // This should only be called when updating state; so we know to add a vertex
-        // here. It's assumed that this buffer is cleared out when advancing generations.
-        //
-        m_vertexData.emplace_back(x - m_worldBounds.XMin(), y - m_worldBounds.YMin());
-    }
+        assert(y >= 0 && y < BUFFER_HEIGHT);
 
-    void SubGrid::RaiseCell(int64_t x, int64_t y)
-    {
-        RaiseCell(m_pCurrentCellGrid, x, y);
+        return static_cast<size_t>(y);
     }
 
-    void SubGrid::KillCell(uint8_t* pGrid, int64_t x, int64_t y)
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::RowType SubGrid<TileWidth, TileHeight>::GetColumnBit(int64_t x) const
     {
-        pGrid[GetOffset(x, y)] = false;
+        x = x - m_xMin + 1;
+
+        assert(x >= 0 && x < BUFFER_WIDTH);
+
+        return static_cast<RowType>(1) << static_cast<uint32_t>(x);
     }
 
-    void SubGrid::KillCell(int64_t x, int64_t y)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::SetCellState(uint8_t* pGrid, int64_t x, int64_t y, bool alive)
     {
-        KillCell(m_pCurrentCellGrid, x, y);
+        if (m_format.Layout == CellLayout::BytePerCell)
+        {
+            pGrid[GetOffset(x, y)] = alive;
+        }
+        else if (alive)
+        {
+            AsRows(pGrid)[GetRowIndex(y)] |= GetColumnBit(x);
+        }
+        else
+        {
+            AsRows(pGrid)[GetRowIndex(y)] &= ~GetColumnBit(x);
+        }
     }
 
-    bool SubGrid::GetCellState(uint8_t const* pGrid, int64_t x, int64_t y) const
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::RaiseCell(uint8_t* pGrid, int64_t x, int64_t y)
     {
-        return !!pGrid[GetOffset(x, y)];
+        SetCellState(pGrid, x, y, true);
     }
 
-    bool SubGrid::GetCellState(int64_t x, int64_t y) const
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::RaiseCell(int64_t x, int64_t y)
     {
-        return GetCellState(m_pCurrentCellGrid, x, y);
+        assert(!IsDormant());
+        RaiseCell(m_pCurrentCellGrid, x, y);
+
+        const size_t Current = GetGridIndex(m_pCurrentCellGrid);
+        if (!(m_liveRows[Current][y - m_yMin] & GetColumnBit(x)))
+        {
+            ++m_liveCellCounts[Current];
+        }
+
+        m_liveRows[Current][y - m_yMin] |= GetColumnBit(x);
+        m_liveRowMasks[Current] |= RowType(1) << static_cast<uint32_t>(y - m_yMin);
+        m_liveColumns[Current] |= GetColumnBit(x);
+
+        EdgeRecord& edges = m_edges[Current];
+        const RowType RowBit = RowType(1) << static_cast<uint32_t>(y - m_yMin);
+        if (y == m_yMin)                      { edges.Top    |= GetColumnBit(x); }
+        if (y == m_yMin + SUBGRID_HEIGHT - 1) { edges.Bottom |= GetColumnBit(x); }
+        if (x == m_xMin)                      { edges.Left   |= RowBit;          }
+        if (x == m_xMin + SUBGRID_WIDTH - 1)  { edges.Right  |= RowBit;          }
+        m_repeatsEveryOther = false;
+        Wake(m_generation);
     }
 
-    const SubGrid::CoordinateType& SubGrid::GetCoordinates() const
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::KillCell(uint8_t* pGrid, int64_t x, int64_t y)
     {
-        return m_coordinates;
+        SetCellState(pGrid, x, y, false);
     }
 
-    const std::vector<SubGrid::VertexType>& SubGrid::GetVertexData() const
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::KillCell(int64_t x, int64_t y)
     {
-        return m_vertexData;
+        assert(!IsDormant());
+        KillCell(m_pCurrentCellGrid, x, y);
+
+        const size_t Current = GetGridIndex(m_pCurrentCellGrid);
+        m_liveRows[Current][y - m_yMin] &= ~GetColumnBit(x);
+        UpdateLiveMasks(Current);
+        m_repeatsEveryOther = false;
+        Wake(m_generation);
     }
 
-    void 
-    SubGrid::CopyRowFrom(
-        const SubGrid& src, uint8_t const* pSrcGrid,
-        const SubGrid& dst, uint8_t* pDstGrid,
-        int64_t ySrc,
-        int64_t yDst
-        )
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::GetCellState(uint8_t const* pGrid, int64_t x, int64_t y) const
     {
-        assert(dst.m_width == src.m_width);
-        const uint8_t* const pSrc = &pSrcGrid[src.GetOffset(src.m_xMin, ySrc)];
-              uint8_t* const pDst = &pDstGrid[dst.GetOffset(dst.m_xMin, yDst)];
+        if (m_format.Layout == CellLayout::BytePerCell)
+        {
+            return !!pGrid[GetOffset(x, y)];
+        }
 
-        memcpy(pDst, pSrc, dst.m_width);
+        return !!(AsRows(pGrid)[GetRowIndex(y)] & GetColumnBit(x));
     }
 
-    void SubGrid::ClearRow(uint8_t* pBuffer, int64_t row)
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::RowType SubGrid<TileWidth, TileHeight>::GetRowBits(uint8_t const* pGrid, int64_t y) const
     {
-        uint8_t* const pDst = &pBuffer[GetOffset(m_xMin, row)];
-        memset(pDst, 0, m_width);
+        if (m_format.Layout == CellLayout::BitPacked)
+        {
+            return AsRows(pGrid)[GetRowIndex(y)];
+        }
+
+        uint8_t const* pRow = &pGrid[GetOffset(m_xMin - 1, y)];
+
+        RowType bits = 0;
+        for (int64_t i = 0; i < BUFFER_WIDTH; i++)
+        {
+            bits |= static_cast<RowType>(!!pRow[i]) << static_cast<uint32_t>(i);
+        }
+
+        return bits;
     }
 
-    void SubGrid::CopyColumnFrom(
-        const SubGrid& src, uint8_t const* pSrcGrid,
-        const SubGrid& dst, uint8_t* pDstGrid,
-        int64_t xSrc,
-        int64_t xDst
-        )
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::RowType SubGrid<TileWidth, TileHeight>::GetColumnBits(uint8_t const* pGrid, int64_t x) const
     {
-        assert(dst.m_height == src.m_height);
-        const uint8_t* pSrc = &pSrcGrid[src.GetOffset(xSrc, src.m_yMin)];
-              uint8_t* pDst = &pDstGrid[dst.GetOffset(xDst, dst.m_yMin)];
+        RowType bits = 0;
+        if (m_format.Layout == CellLayout::BitPacked)
+        {
+            const uint32_t Column = static_cast<uint32_t>(x - m_xMin + 1);
+            RowType const* pRows = AsRows(pGrid);
+            for (int64_t row = 0; row < BUFFER_HEIGHT; row++)
+            {
+                bits |= ((pRows[row] >> Column) & RowType(1)) << static_cast<uint32_t>(row);
+            }
+
+            return bits;
+        }
 
-        for (int64_t i = 0; i < dst.m_height; i++)
+        uint8_t const* pCell = &pGrid[GetOffset(x, m_yMin - 1)];
+        for (int64_t row = 0; row < BUFFER_HEIGHT; row++)
         {
-            *pDst = *pSrc;
-            pDst += dst.m_bufferWidth;
-            pSrc += src.m_bufferWidth;
+            bits |= static_cast<RowType>(!!*pCell) << static_cast<uint32_t>(row);
+            pCell += BUFFER_WIDTH;
         }
+
+        return bits;
     }
 
-    void SubGrid::ClearColumn(
-        uint8_t* pBuffer, int64_t col
-        )
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::GetCellState(int64_t x, int64_t y) const
     {
-        uint8_t* pDst = &pBuffer[GetOffset(col, m_yMin)];
-
-        for (int64_t i = 0; i < m_height; i++)
+        if (IsDormant())
         {
-            *pDst = 0;
-            pDst += m_bufferWidth;
+            //
+            // Only the interior is left; ghost cells belong to our neighbors
+            // anyway.
+            //
+            assert(y >= m_yMin && y < m_yMin + SUBGRID_HEIGHT);
+            assert(x >= m_xMin && x < m_xMin + SUBGRID_WIDTH);
+
+            const uint32_t Row = static_cast<uint32_t>(y - m_yMin);
+            const RowType RowMask = m_liveRowMasks[GetGridIndexForGeneration(m_generation)];
+            if (!Utility::TestBit(RowMask, Row))
+            {
+                return false;
+            }
+
+            const uint32_t Packed = Utility::PopCount(RowMask & ~(~RowType(0) << Row));
+            return !!(GetDormantRows()[Packed] & GetColumnBit(x));
         }
+
+        return GetCellState(m_pCurrentCellGrid, x, y);
     }
 
-    bool SubGrid::HasBorderCells() const
+    template <int64_t TileWidth, int64_t TileHeight>
+    const typename SubGrid<TileWidth, TileHeight>::CoordinateType& SubGrid<TileWidth, TileHeight>::GetCoordinates() const
     {
+        return m_coordinates;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::ExtractVertices(const CoordinateType& origin, std::vector<VertexType>& vertices) const
+    {
+        const size_t Current = GetGridIndexForGeneration(m_generation);
+        const uint32_t Count = m_liveCellCounts[Current];
+        if (!Count)
+        {
+            return;
+        }
+
+        const size_t First = vertices.size();
+        vertices.resize(First + Count + Kernels::VERTEX_EXTRACT_SLACK, VertexType(0, 0));
+
         //
-        // We use this type to process as many cells as possible per
-        // loop iteration, casting the byte type to an int64_t and 
-        // checking against 0.
-        //
-        // That optimization is only available for rows, not columns,
-        // whose elements aren't contiguous in memory.
+        // Dormant rows are packed, so walking the row mask in order visits
+        // them one after another.
         //
-
-        typedef int64_t SkipPtrType;
+        const bool IsPacked = IsDormant();
+        RowType const* pRows = IsPacked ? GetDormantRows() : m_liveRows[Current];
 
         //
-        // Check top row first
+        // Bit 0 of a live row is the left ghost column.
         //
-        uint8_t* pTemp = &m_pCurrentCellGrid[GetOffset(m_xMin - 1, m_yMin - 1)];
-        uint64_t i = 0;
-        for (i = 0; i < m_bufferWidth / sizeof(SkipPtrType); i++)
+        const float X = static_cast<float>(m_xMin - 1 - origin.first);
+        VertexType* pVertices = &vertices[First];
+        uint32_t packed = 0;
+        for (RowType rowMask = m_liveRowMasks[Current]; rowMask; rowMask = Utility::ClearLowestSetBit(rowMask))
         {
-            auto pSkipTemp = reinterpret_cast<SkipPtrType*>(pTemp);
-            if (*pSkipTemp) return true;
-            pTemp += sizeof(SkipPtrType);
+            const uint32_t Row = Utility::CountTrailingZeros(rowMask);
+            const float Y = static_cast<float>(m_yMin + Row - origin.second);
+            pVertices += Kernels::ExtractBits(pRows[IsPacked ? packed++ : Row], X, Y, pVertices);
         }
 
-        if (i * sizeof(SkipPtrType) < m_bufferWidth)
+        assert(pVertices == &vertices[First] + Count);
+        vertices.resize(First + Count, VertexType(0, 0));
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::ClearRow(uint8_t* pBuffer, int64_t row)
+    {
+        if (m_format.Layout == CellLayout::BytePerCell)
         {
-            const uint64_t Remaining = m_bufferWidth % sizeof(SkipPtrType);
-            for (i = 0; i < Remaining; i++)
+            uint8_t* const pDst = &pBuffer[GetOffset(m_xMin, row)];
+            memset(pDst, 0, SUBGRID_WIDTH);
+            return;
+        }
+
+        AsRows(pBuffer)[GetRowIndex(row)] &= ~InteriorMask();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::SetGhostRow(uint8_t* pGrid, int64_t y, RowType bits)
+    {
+        if (m_format.Layout == CellLayout::BytePerCell)
+        {
+            uint8_t* const pDst = &pGrid[GetOffset(m_xMin, y)];
+            if (bits & InteriorMask())
             {
-                if (*(++pTemp))
-                {
-                    return true;
-                }
+                ExpandBits(bits, 1, SUBGRID_WIDTH, pDst);
+            }
+            else
+            {
+                memset(pDst, 0, SUBGRID_WIDTH);
             }
+            return;
         }
 
-        //
-        // Then the bottom
-        //
-        pTemp = &m_pCurrentCellGrid[GetOffset(m_xMin - 1, m_yMin + m_height)];
-        for (int64_t i = 0; i < m_bufferWidth / sizeof(SkipPtrType); i++)
+        RowType& row = AsRows(pGrid)[GetRowIndex(y)];
+        row = (row & ~InteriorMask()) | (bits & InteriorMask());
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::SetGhostColumn(uint8_t* pGrid, int64_t x, RowType bits)
+    {
+        if (m_format.Layout == CellLayout::BytePerCell)
         {
-            auto pSkipTemp = reinterpret_cast<SkipPtrType*>(pTemp);
-            if (*pSkipTemp) return true;
-            pTemp += sizeof(SkipPtrType);
+            uint8_t* pDst = &pGrid[GetOffset(x, m_yMin)];
+            for (int64_t i = 0; i < SUBGRID_HEIGHT; i++)
+            {
+                *pDst = static_cast<uint8_t>(Utility::TestBit(bits, static_cast<uint32_t>(i)));
+                pDst += BUFFER_WIDTH;
+            }
+            return;
         }
 
-        if (i * sizeof(SkipPtrType) < m_bufferHeight)
+        const RowType Bit = GetColumnBit(x);
+        RowType* pDst = &AsRows(pGrid)[GetRowIndex(m_yMin)];
+        for (int64_t i = 0; i < SUBGRID_HEIGHT; i++)
         {
-            const uint64_t Remaining = m_bufferHeight % sizeof(SkipPtrType);
-            for (i = 0; i < Remaining; i++)
+            if (Utility::TestBit(bits, static_cast<uint32_t>(i)))
             {
-                if (*(++pTemp))
-                {
-                    return true;
-                }
+                pDst[i] |= Bit;
+            }
+            else
+            {
+                pDst[i] &= ~Bit;
             }
         }
+    }
 
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::HasBorderCells() const
+    {
         //
-        // Left
+        // The ghost ring only reads the two ghost columns of each row rather
+        // than whole rows.
         //
-        pTemp = &m_pCurrentCellGrid[GetOffset(m_xMin - 1, m_yMin - 1)];
-        for (int64_t i = 0; i < m_bufferHeight; i++)
-        {
-            if (*pTemp)
-            {
-                return true;
-            }
+        const GhostRing Ring = GetGhostRing(m_pCurrentCellGrid);
 
-            pTemp += m_bufferWidth;
-        }
+        return !!(Ring.Top | Ring.Bottom | Ring.Left | Ring.Right);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::StepCells(
+        uint8_t const* pSrc, uint8_t* pDst,
+        int64_t firstRow, int64_t numRows,
+        RowType* pLiveRows
+        ) const
+    {
+        assert(firstRow >= 0 && firstRow + numRows <= SUBGRID_HEIGHT);
 
         //
-        // Right
+        // The kernels only look at the rows either side of the ones they
+        // step, so a run of rows is just a shorter grid further along.
         //
-        pTemp = &m_pCurrentCellGrid[GetOffset(m_xMin + m_width, m_yMin - 1)];
-        for (int64_t i = 0; i < m_bufferHeight; i++)
+        // Both layouts step whole rows at a time and report the living cells
+        // of each row as a bitmask; ghost cells in the destination are
+        // preserved since they belong to our neighbors.
+        //
+        if (m_format.Layout == CellLayout::BytePerCell)
+        {
+            const Kernels::ByteStepFunction StepBytes =
+                Kernels::GetByteStepFunction(m_format.ByteKernel, m_format.LifeRule);
+
+            //
+            // The byte kernels report each row as 32-bit words; gather them
+            // back into whole rows.
+            //
+            static const int64_t WordsPerRow = BUFFER_WIDTH / 32;
+            uint32_t liveWords[SUBGRID_HEIGHT * WordsPerRow];
+
+            const int64_t Offset = firstRow * BUFFER_WIDTH;
+            StepBytes(pSrc + Offset, pDst + Offset, BUFFER_WIDTH, numRows, m_format.LifeRule, liveWords);
+
+            for (int64_t row = 0; row < numRows; row++)
+            {
+                RowType bits = 0;
+                for (int64_t i = 0; i < WordsPerRow; i++)
+                {
+                    bits |= static_cast<RowType>(liveWords[row * WordsPerRow + i]) << static_cast<uint32_t>(32 * i);
+                }
+
+                pLiveRows[firstRow + row] = bits;
+            }
+        }
+        else if (m_pLookupTable)
+        {
+            Kernels::StepBitsLookup(
+                AsRows(pSrc) + firstRow, AsRows(pDst) + firstRow,
+                SUBGRID_WIDTH, numRows, InteriorMask(),
+                m_pLookupTable,
+                pLiveRows + firstRow
+                );
+        }
+        else
         {
-            if (*pTemp)
+            switch (m_staticRule)
             {
-                return true;
+            case StaticRuleType::HighLife:
+                StepRowsAdder<HighLifeRule>(pSrc, pDst, firstRow, numRows, pLiveRows);
+                break;
+            case StaticRuleType::DayAndNight:
+                StepRowsAdder<DayAndNightRule>(pSrc, pDst, firstRow, numRows, pLiveRows);
+                break;
+            case StaticRuleType::Conway:
+            default:
+                StepRowsAdder<ConwayRule>(pSrc, pDst, firstRow, numRows, pLiveRows);
+                break;
             }
-
-            pTemp += m_bufferWidth;
         }
+    }
 
-        return false;
+    template <int64_t TileWidth, int64_t TileHeight>
+    template <typename RuleT>
+    void SubGrid<TileWidth, TileHeight>::StepRowsAdder(
+        uint8_t const* pSrc, uint8_t* pDst,
+        int64_t firstRow, int64_t numRows,
+        RowType* pLiveRows
+        ) const
+    {
+        Kernels::StepBitsAdder<RuleT>(
+            AsRows(pSrc) + firstRow, AsRows(pDst) + firstRow,
+            numRows, InteriorMask(),
+            pLiveRows + firstRow
+            );
     }
 
-    uint32_t SubGrid::AdvanceGeneration()
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::UpdateLiveMasks(size_t grid)
     {
-        //
-        // Copy neighbor border data if it exists.
-        //
-        SubGrid** ppNeighbors;
-        if (!m_pGridGraph->GetNeighborArray(this, ppNeighbors))
+        static const uint32_t LastColumn = static_cast<uint32_t>(SUBGRID_WIDTH);
+
+        RowType rowMask = 0;
+        RowType columns = 0;
+        uint32_t count = 0;
+        RowType left = 0;
+        RowType right = 0;
+        for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
         {
-            assert(false);
-            throw "Subgrid exists but isn't in the grid graph!";
+            const RowType Row = m_liveRows[grid][row];
+            if (Row)
+            {
+                const uint32_t Bit = static_cast<uint32_t>(row);
+                rowMask |= RowType(1) << Bit;
+                columns |= Row;
+                count   += Utility::PopCount(Row);
+                left    |= ((Row >> 1) & RowType(1)) << Bit;
+                right   |= ((Row >> LastColumn) & RowType(1)) << Bit;
+            }
         }
 
-        for (int i = 0; i < AdjacencyIndex::MAX; ++i)
+        m_liveRowMasks[grid] = rowMask;
+        m_liveColumns[grid] = columns;
+        m_liveCellCounts[grid] = count;
+
+        EdgeRecord& edges = m_edges[grid];
+        edges.Top    = m_liveRows[grid][0];
+        edges.Bottom = m_liveRows[grid][SUBGRID_HEIGHT - 1];
+        edges.Left   = left;
+        edges.Right  = right;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::GhostRing SubGrid<TileWidth, TileHeight>::GetGhostRing(uint8_t const* pGrid) const
+    {
+        GhostRing ring;
+        ring.Top    = GetRowBits(pGrid, m_yMin - 1);
+        ring.Bottom = GetRowBits(pGrid, m_yMin + SUBGRID_HEIGHT);
+        ring.Left   = 0;
+        ring.Right  = 0;
+
+        if (m_format.Layout == CellLayout::BytePerCell)
         {
-            SubGrid* pNeighbor = ppNeighbors[i];
-            if (!pNeighbor)
+            uint8_t const* pRow = &pGrid[GetOffset(m_xMin - 1, m_yMin)];
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
             {
-                continue;
+                const uint32_t Bit = static_cast<uint32_t>(row);
+                ring.Left  |= static_cast<RowType>(!!pRow[0]) << Bit;
+                ring.Right |= static_cast<RowType>(!!pRow[SUBGRID_WIDTH + 1]) << Bit;
+                pRow += BUFFER_WIDTH;
             }
 
-            CopyBorder(*pNeighbor, static_cast<AdjacencyIndex>(i));
+            return ring;
+        }
+
+        RowType const* pRows = AsRows(pGrid);
+        for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+        {
+            const uint32_t Bit = static_cast<uint32_t>(row);
+            const RowType Row = pRows[row + 1];
+
+            ring.Left  |= (Row & RowType(1)) << Bit;
+            ring.Right |= ((Row >> static_cast<uint32_t>(SUBGRID_WIDTH + 1)) & RowType(1)) << Bit;
         }
 
+        return ring;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    TileActivity SubGrid<TileWidth, TileHeight>::GetActivity() const
+    {
+        if (!m_hasChanged)
+        {
+            return TileActivity::Still;
+        }
+
+        return m_repeatsEveryOther ? TileActivity::Period2 : TileActivity::Active;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint32_t SubGrid<TileWidth, TileHeight>::AdvanceGeneration()
+    {
+        assert(!IsDormant());
+
         uint8_t* pOtherGrid =
             OtherPointer(
                 m_pCurrentCellGrid,
@@ -311,91 +705,594 @@ namespace GameOfLife
                 m_pCellGrids[1]
                 );
 
-        m_vertexData.clear();
+        const size_t Current = GetGridIndex(m_pCurrentCellGrid);
+        const size_t Other   = 1 - Current;
+
+        //
+        // If our cells match those of two generations ago and so do the ghost
+        // cells around them, the next generation matches the previous one,
+        // which is still sitting in the other cell grid. Oscillators like
+        // blinkers then just flip between grids, and so does anything next
+        // to them whose edge only sees the oscillation.
+        //
+        const GhostRing Ring = GetGhostRing(m_pCurrentCellGrid);
+        const uint32_t Parity = m_generation & 1;
+        const bool Flip =
+            m_repeatsEveryOther &&
+            m_generation >= 2 &&
+            m_ghostRingGenerations[Parity] == m_generation - 2 &&
+            m_ghostRings[Parity] == Ring;
+
+        m_ghostRings[Parity] = Ring;
+        m_ghostRingGenerations[Parity] = m_generation;
 
-        for (int64_t y = m_yMin; y < m_yMin + m_height; y++)
+        //
+        // When flipping, what changed is the same as in the last step, so
+        // m_hasChanged and m_changedBorders stay as they are.
+        //
+        if (!Flip)
         {
-            for (int64_t x = m_xMin; x < m_xMin + m_width; x++)
+            //
+            // An interior row can only have living cells next generation if
+            // one of the padded rows at or either side of it has some now,
+            // counting ghost cells. Only step runs of rows like that.
+            //
+            const RowType SourceRows =
+                ((m_liveRowMasks[Current] | Ring.Left | Ring.Right) << 1) |
+                (Ring.Top    ? RowType(1) : RowType(0)) |
+                (Ring.Bottom ? RowType(1) << static_cast<uint32_t>(SUBGRID_HEIGHT + 1) : RowType(0));
+
+            RowType rowsToStep = (SourceRows | (SourceRows >> 1) | (SourceRows >> 2)) & InteriorRowMask();
+            if (m_pLookupTable)
             {
-                const uint8_t NumNeighbors = CountNeighbors(*this, x, y);
-                if (GetCellState(m_pCurrentCellGrid, x, y))
+                //
+                // The lookup table steps pairs of rows starting on an even row.
+                //
+                static const RowType EvenRows = EvenRowMask();
+                rowsToStep |=
+                    ((rowsToStep >> 1) & EvenRows) |
+                    ((rowsToStep << 1) & ~EvenRows & InteriorRowMask());
+            }
+
+            RowType liveRows[SUBGRID_HEIGHT];
+            for (RowType remaining = rowsToStep; remaining; )
+            {
+                const uint32_t FirstRow = Utility::CountTrailingZeros(remaining);
+                const uint32_t NumRows  = Utility::CountTrailingZeros(~(remaining >> FirstRow));
+
+                StepCells(m_pCurrentCellGrid, pOtherGrid, FirstRow, NumRows, liveRows);
+
+                remaining = (remaining >> (FirstRow + NumRows)) << (FirstRow + NumRows);
+            }
+
+            //
+            // Rows we skipped are dead next generation; clear any cells the
+            // other grid still holds in them from two generations ago.
+            //
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                if (!Utility::TestBit(rowsToStep, static_cast<uint32_t>(row)))
                 {
-                    if (NumNeighbors < 2 || NumNeighbors > 3)
+                    if (m_liveRows[Other][row])
                     {
-                        KillCell(pOtherGrid, x, y);
-                    }
-                    else
-                    {
-                        RaiseCell(pOtherGrid, x, y);
+                        ClearRow(pOtherGrid, m_yMin + row);
                     }
+
+                    liveRows[row] = 0;
+                }
+            }
+
+            //
+            // Note what changed so SparseGrid knows who to keep awake, and
+            // whether we're back where we were two generations ago.
+            //
+            RowType changed = 0;
+            bool repeats = true;
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                changed |= liveRows[row] ^ m_liveRows[Current][row];
+                repeats = repeats && liveRows[row] == m_liveRows[Other][row];
+            }
+
+            m_hasChanged = !!changed;
+            m_changedBorders = m_hasChanged ?
+                GetChangedBorderMask(
+                    liveRows[0] ^ m_liveRows[Current][0],
+                    liveRows[SUBGRID_HEIGHT - 1] ^ m_liveRows[Current][SUBGRID_HEIGHT - 1],
+                    changed
+                    ) :
+                0;
+            m_repeatsEveryOther = repeats;
+
+            std::copy(liveRows, liveRows + SUBGRID_HEIGHT, m_liveRows[Other]);
+            UpdateLiveMasks(Other);
+        }
+
+        ++m_generation;
+        m_pCurrentCellGrid = pOtherGrid;
+
+        DebugGridDumper::OpenFile("grid_dump.txt");
+        if (m_format.Layout == CellLayout::BytePerCell)
+        {
+            DebugGridDumper::DumpGrid(
+                m_generation - 1,
+                GetCoordinates(),
+                *this,
+                OtherPointer(m_pCurrentCellGrid, m_pCellGrids[0], m_pCellGrids[1]),
+                m_pCurrentCellGrid
+            );
+        }
+        else
+        {
+            DebugGridDumper::DumpGrid(
+                m_generation - 1,
+                GetCoordinates(),
+                *this,
+                AsRows(OtherPointer(m_pCurrentCellGrid, m_pCellGrids[0], m_pCellGrids[1])),
+                AsRows(m_pCurrentCellGrid)
+            );
+        }
+
+        return GetLiveCellCount();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::Wake(uint32_t generation)
+    {
+        if (IsAwake(generation))
+        {
+            return false;
+        }
+
+        m_wakeGeneration = generation;
+        return true;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::SkipToGeneration(uint32_t generation)
+    {
+        assert(generation >= m_generation);
+
+        //
+        // Neither cell grid has been stepped from the skipped generations,
+        // so don't trust them to repeat.
+        //
+        if (generation != m_generation)
+        {
+            m_repeatsEveryOther = false;
+        }
+
+        if (IsDormant())
+        {
+            m_generation = generation;
+            Rehydrate();
+            return;
+        }
+
+        //
+        // Keep the cell grid for each generation's parity the same; see
+        // m_gridParity.
+        //
+        if ((generation - m_generation) & 1)
+        {
+            m_pCurrentCellGrid = OtherPointer(m_pCurrentCellGrid, m_pCellGrids[0], m_pCellGrids[1]);
+        }
+
+        m_generation = generation;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::MakeDormant()
+    {
+        assert(!IsDormant());
+
+        //
+        // Asleep, both cell grids hold the same cells, so both sets of live
+        // rows, masks, edges and vertex data do too. Keep the current vertex
+        // data, since there's nothing cheaper for renderers to read.
+        //
+        const size_t Current = GetGridIndexForGeneration(m_generation);
+        assert(std::equal(m_liveRows[0], m_liveRows[0] + SUBGRID_HEIGHT, m_liveRows[1]));
+
+        const uint32_t NumRows = Utility::PopCount(m_liveRowMasks[Current]);
+        if (NumRows)
+        {
+            m_spDormantRows.reset(new RowType[NumRows]);
+            std::copy_if(
+                m_liveRows[Current], m_liveRows[Current] + SUBGRID_HEIGHT,
+                m_spDormantRows.get(),
+                [](const RowType& row) { return !!row; }
+                );
+        }
+
+        m_memoryPool.Free(m_pCellGrids[0]);
+        m_pCellGrids[0] = nullptr;
+        m_memoryPool.Free(m_pCellGrids[1]);
+        m_pCellGrids[1] = nullptr;
+        m_pCurrentCellGrid = nullptr;
+        m_liveRows[0] = m_liveRows[1] = nullptr;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::Rehydrate()
+    {
+        assert(IsDormant());
+
+        //
+        // Sublocks come back zeroed, so only rows with living cells need
+        // writing.
+        //
+        for (size_t grid = 0; grid < 2; grid++)
+        {
+            uint8_t* pGrid = m_memoryPool.Allocate();
+            m_pCellGrids[grid] = pGrid;
+            m_liveRows[grid] = reinterpret_cast<RowType*>(pGrid + GetCellGridSize(m_format.Layout));
+
+            RowType const* pRows = UnpackDormantRows(m_liveRows[grid]);
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                if (!pRows[row])
+                {
+                    continue;
+                }
+
+                if (m_format.Layout == CellLayout::BytePerCell)
+                {
+                    ExpandBits(pRows[row], 1, SUBGRID_WIDTH, &pGrid[GetOffset(m_xMin, m_yMin + row)]);
                 }
                 else
                 {
-                    if (NumNeighbors == 3)
-                    {
-                        RaiseCell(pOtherGrid, x, y);
-                    }
-                    else
-                    {
-                        KillCell(pOtherGrid, x, y);
-                    }
+                    AsRows(pGrid)[row + 1] = pRows[row];
                 }
             }
         }
 
-        ++m_generation;
-        m_pCurrentCellGrid = pOtherGrid;
+        m_spDormantRows.reset();
+        if (IsSpilled())
+        {
+            m_pSpillFile->Free(m_spillRecord);
+            m_pSpillFile = nullptr;
+        }
+
+        m_pCurrentCellGrid = m_pCellGrids[GetGridIndexForGeneration(m_generation)];
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetDormantRowBytes() const
+    {
+        assert(IsDormant());
+        return IsSpilled() ? 0 : sizeof(RowType) * Utility::PopCount(m_liveRowMasks[0]);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::Spill(Utility::SpillFile& spillFile)
+    {
+        assert(IsDormant() && !IsSpilled());
+
+        const uint32_t Record = spillFile.Allocate();
+        std::copy(
+            m_spDormantRows.get(), m_spDormantRows.get() + Utility::PopCount(m_liveRowMasks[0]),
+            reinterpret_cast<RowType*>(spillFile.GetRecord(Record))
+            );
+
+        m_spDormantRows.reset();
+        m_pSpillFile = &spillFile;
+        m_spillRecord = Record;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::PrefetchSpilled() const
+    {
+        assert(IsSpilled());
+        m_pSpillFile->Prefetch(m_spillRecord);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::RowType const* SubGrid<TileWidth, TileHeight>::GetDormantRows() const
+    {
+        assert(IsDormant());
+        return IsSpilled() ?
+            reinterpret_cast<RowType const*>(m_pSpillFile->GetRecord(m_spillRecord)) :
+            m_spDormantRows.get();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubGrid<TileWidth, TileHeight>::RowType const* SubGrid<TileWidth, TileHeight>::UnpackDormantRows(RowType* pRows) const
+    {
+        assert(IsDormant());
+
+        const RowType RowMask = m_liveRowMasks[0];
+        RowType const* pPackedRows = GetDormantRows();
+        size_t packed = 0;
+        for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+        {
+            pRows[row] = Utility::TestBit(RowMask, static_cast<uint32_t>(row)) ? pPackedRows[packed++] : RowType(0);
+        }
+
+        return pRows;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    size_t SubGrid<TileWidth, TileHeight>::GetHaloSize(uint32_t depth)
+    {
+        return static_cast<size_t>((SUBGRID_HEIGHT + 2 * depth) * GetHaloRowWords(depth));
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::GatherHalo(uint32_t depth, uint64_t* pHalo) const
+    {
+        assert(depth >= 1 && depth <= MAX_HALO_DEPTH);
+        assert(depth <= SUBGRID_WIDTH && depth <= SUBGRID_HEIGHT);
+
+        const int64_t Depth = depth;
+        const int64_t HaloWidth = SUBGRID_WIDTH + 2 * Depth;
+        const int64_t HaloHeight = SUBGRID_HEIGHT + 2 * Depth;
+        const int64_t RowWords = GetHaloRowWords(depth);
+
+        std::fill(pHalo, pHalo + GetHaloSize(depth), uint64_t(0));
 
         //
-        // Need to copy border states to new generation grid here as well to correctly
-        // identify new neighbors after this generation has completed.
+        // Lays the live rows of the subgrid dx subgrids across and dy down
+        // from us over the halo. Padded column 1 of ours is halo column
+        // depth.
         //
+        const uint32_t Generation = m_generation;
+        auto gather = [=](const SubGrid& source, int64_t dx, int64_t dy)
+        {
+            RowType dormantRows[SUBGRID_HEIGHT];
+            RowType const* pRows = source.IsDormant() ?
+                source.UnpackDormantRows(dormantRows) :
+                source.GetLiveRows(Generation);
+
+            const int64_t RowOffset = Depth + dy * SUBGRID_HEIGHT;
+            const int64_t FirstRow = std::max<int64_t>(0, -RowOffset);
+            const int64_t EndRow = std::min<int64_t>(int64_t(SUBGRID_HEIGHT), HaloHeight - RowOffset);
+            const int64_t Position = Depth - 1 + dx * SUBGRID_WIDTH;
+
+            for (int64_t row = FirstRow; row < EndRow; row++)
+            {
+                if (pRows[row])
+                {
+                    OrBitsAt(pHalo + (row + RowOffset) * RowWords, pRows[row], Position, HaloWidth);
+                }
+            }
+        };
+
+        static const int64_t Offsets[AdjacencyIndex::MAX][2] =
+        {
+            { -1, -1 }, { 0, -1 }, { 1, -1 },
+            { -1,  0 },            { 1,  0 },
+            { -1,  1 }, { 0,  1 }, { 1,  1 }
+        };
+
+        gather(*this, 0, 0);
         for (int i = 0; i < AdjacencyIndex::MAX; ++i)
         {
-            SubGrid* pNeighbor = ppNeighbors[i];
-            if (!pNeighbor)
+            if (m_pNeighbors[i])
             {
-                continue;
+                gather(*m_pNeighbors[i], Offsets[i][0], Offsets[i][1]);
             }
+        }
+    }
 
-            CopyBorder(*pNeighbor, static_cast<AdjacencyIndex>(i));
+    template <int64_t TileWidth, int64_t TileHeight>
+    template <typename StepperT>
+    void SubGrid<TileWidth, TileHeight>::StepHalo(
+        uint32_t depth, uint64_t const* pHalo,
+        const StepperT& stepper,
+        RowType (*pGenerationsOut)[SUBGRID_HEIGHT]
+        ) const
+    {
+        const int64_t Depth = depth;
+        const int64_t HaloHeight = SUBGRID_HEIGHT + 2 * Depth;
+        const int64_t RowWords = GetHaloRowWords(depth);
+
+        //
+        // After depth generations, only the middle of a strip is still
+        // right, so strips overlap by depth columns either side.
+        //
+        const int64_t StripWidth = 64 - 2 * Depth;
+        const uint64_t StripMask = ((uint64_t(1) << StripWidth) - 1) << Depth;
+
+        for (int64_t i = 0; i < 3; i++)
+        {
+            std::fill(pGenerationsOut[i], pGenerationsOut[i] + SUBGRID_HEIGHT, RowType(0));
         }
 
-        DebugGridDumper::OpenFile("grid_dump.txt");
-        DebugGridDumper::DumpGrid(
-            m_generation - 1,
-            GetCoordinates(),
-            *this,
-            OtherPointer(m_pCurrentCellGrid, m_pCellGrids[0], m_pCellGrids[1]),
-            m_pCurrentCellGrid
-        );
+        uint64_t strips[2][SUBGRID_HEIGHT + 2 * MAX_HALO_DEPTH];
+        for (int64_t x = 0; x < SUBGRID_WIDTH; x += StripWidth)
+        {
+            //
+            // Strip columns start at halo column x, i.e. padded column
+            // x + 1 - depth of ours.
+            //
+            const int64_t Word = x / 64;
+            const uint32_t Shift = static_cast<uint32_t>(x % 64);
+            for (int64_t row = 0; row < HaloHeight; row++)
+            {
+                uint64_t const* pWords = pHalo + row * RowWords + Word;
+                strips[0][row] = Shift ? (pWords[0] >> Shift) | (pWords[1] << (64 - Shift)) : pWords[0];
+            }
 
-        return static_cast<uint32_t>(m_vertexData.size());
+            for (int64_t step = 0; step <= Depth; step++)
+            {
+                uint64_t* pStrip = strips[step & 1];
+                if (step)
+                {
+                    //
+                    // Each generation knows a row less at either end.
+                    //
+                    uint64_t const* pPrevious = strips[(step - 1) & 1];
+                    for (int64_t row = step; row < HaloHeight - step; row++)
+                    {
+                        pStrip[row] = stepper(pPrevious[row - 1], pPrevious[row], pPrevious[row + 1]);
+                    }
+                }
+
+                if (step + 2 < Depth)
+                {
+                    continue;
+                }
+
+                RowType* pRows = pGenerationsOut[step + 2 - Depth];
+                for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+                {
+                    pRows[row] |= PlaceStrip<RowType>(pStrip[row + Depth] & StripMask, x + 1 - Depth);
+                }
+            }
+        }
+
+        for (int64_t i = 0; i < 3; i++)
+        {
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                pGenerationsOut[i][row] &= InteriorMask();
+            }
+        }
     }
 
-    bool SubGrid::IsNextGenerationNeighbor(AdjacencyIndex adjacency) const
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::StoreGeneration(size_t grid, RowType const* pRows)
     {
-        SubGrid** ppNeighbors;
-        if (!m_pGridGraph->GetNeighborArray(this, ppNeighbors))
+        uint8_t* pGrid = m_pCellGrids[grid];
+        if (m_format.Layout == CellLayout::BytePerCell)
         {
-            assert(false);
-            throw "Subgrid exists but isn't in the grid graph!";
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                if (!pRows[row] && !m_liveRows[grid][row])
+                {
+                    continue;
+                }
+
+                ExpandBits(pRows[row], 1, SUBGRID_WIDTH, &pGrid[GetOffset(m_xMin, m_yMin + row)]);
+            }
         }
+        else
+        {
+            RowType* pGridRows = AsRows(pGrid);
+            for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+            {
+                pGridRows[row + 1] = (pGridRows[row + 1] & ~InteriorMask()) | pRows[row];
+            }
+        }
+
+        std::copy(pRows, pRows + SUBGRID_HEIGHT, m_liveRows[grid]);
+        UpdateLiveMasks(grid);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint32_t SubGrid<TileWidth, TileHeight>::AdvanceGenerations(uint32_t depth, uint64_t const* pHalo)
+    {
+        assert(depth >= 2 && depth <= MAX_HALO_DEPTH);
+        assert(!IsDormant());
 
-        if (ppNeighbors[adjacency])
+        //
+        // Whatever the layout or kernel, halos are stepped with the adder
+        // network; the rule decides which one.
+        //
+        RowType generations[3][SUBGRID_HEIGHT];
+        switch (m_staticRule)
+        {
+        case StaticRuleType::None:
+            StepHalo(depth, pHalo, RuntimeRuleStepper(m_format.LifeRule), generations);
+            break;
+        case StaticRuleType::HighLife:
+            StepHalo(depth, pHalo, StaticRuleStepper<HighLifeRule>(), generations);
+            break;
+        case StaticRuleType::DayAndNight:
+            StepHalo(depth, pHalo, StaticRuleStepper<DayAndNightRule>(), generations);
+            break;
+        case StaticRuleType::Conway:
+        default:
+            StepHalo(depth, pHalo, StaticRuleStepper<ConwayRule>(), generations);
+            break;
+        }
+
+        RowType const* pBefore   = generations[0];
+        RowType const* pPrevious = generations[1];
+        RowType const* pLast     = generations[2];
+
+        RowType changed = 0;
+        bool repeats = true;
+        for (int64_t row = 0; row < SUBGRID_HEIGHT; row++)
+        {
+            changed |= pLast[row] ^ pPrevious[row];
+            repeats = repeats && pLast[row] == pBefore[row];
+        }
+
+        m_hasChanged = !!changed;
+        m_changedBorders = m_hasChanged ?
+            GetChangedBorderMask(
+                pLast[0] ^ pPrevious[0],
+                pLast[SUBGRID_HEIGHT - 1] ^ pPrevious[SUBGRID_HEIGHT - 1],
+                changed
+                ) :
+            0;
+        m_repeatsEveryOther = repeats;
+
+        //
+        // Leave the last two generations in their cell grids, as if they'd
+        // been stepped one at a time. The ghost cells seen by earlier steps
+        // say nothing about the next one.
+        //
+        const uint32_t Generation = m_generation + depth;
+        const size_t Last = GetGridIndexForGeneration(Generation);
+
+        StoreGeneration(1 - Last, pPrevious);
+        StoreGeneration(Last, pLast);
+
+        m_ghostRingGenerations[0] = std::numeric_limits<uint32_t>::max();
+        m_ghostRingGenerations[1] = std::numeric_limits<uint32_t>::max();
+
+        m_generation = Generation;
+        m_pCurrentCellGrid = m_pCellGrids[Last];
+
+        return GetLiveCellCount();
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint32_t SubGrid<TileWidth, TileHeight>::GetChangedBorderMask(RowType top, RowType bottom, RowType any)
+    {
+        const RowType LeftColumn  = RowType(1);
+        const RowType RightColumn = RowType(1) << static_cast<uint32_t>(SUBGRID_WIDTH - 1);
+
+        //
+        // Rows are passed in padded, so the interior starts at bit 1.
+        //
+        top    = top    >> 1;
+        bottom = bottom >> 1;
+        any    = any    >> 1;
+
+        uint32_t mask = 0;
+        if (top)                   { mask |= 1 << AdjacencyIndex::TOP;          }
+        if (top & LeftColumn)      { mask |= 1 << AdjacencyIndex::TOP_LEFT;     }
+        if (top & RightColumn)     { mask |= 1 << AdjacencyIndex::TOP_RIGHT;    }
+        if (bottom)                { mask |= 1 << AdjacencyIndex::BOTTOM;       }
+        if (bottom & LeftColumn)   { mask |= 1 << AdjacencyIndex::BOTTOM_LEFT;  }
+        if (bottom & RightColumn)  { mask |= 1 << AdjacencyIndex::BOTTOM_RIGHT; }
+        if (any & LeftColumn)      { mask |= 1 << AdjacencyIndex::LEFT;         }
+        if (any & RightColumn)     { mask |= 1 << AdjacencyIndex::RIGHT;        }
+
+        return mask;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::IsNextGenerationNeighbor(AdjacencyIndex adjacency) const
+    {
+        if (m_pNeighbors[adjacency])
         {
             return false;
         }
 
         const int64_t BufferLeftX   = m_xMin - 1;
-        const int64_t BufferRightX  = m_xMin + m_width;
+        const int64_t BufferRightX  = m_xMin + SUBGRID_WIDTH;
         const int64_t BufferTopY    = m_yMin - 1;
-        const int64_t BufferBottomY = m_yMin + m_height;
+        const int64_t BufferBottomY = m_yMin + SUBGRID_HEIGHT;
 
         const int64_t LeftX   = m_xMin;
-        const int64_t RightX  = m_xMin + m_width - 1;
+        const int64_t RightX  = m_xMin + SUBGRID_WIDTH - 1;
         const int64_t TopY    = m_yMin;
-        const int64_t BottomY = m_yMin + m_height - 1;
+        const int64_t BottomY = m_yMin + SUBGRID_HEIGHT - 1;
 
         switch (adjacency)
         {
@@ -423,106 +1320,37 @@ namespace GameOfLife
                    GetCellState(RightX, BufferTopY);
         //
         // For strict cardinal directions, it is sufficient to determine whether or not a
-        // new neighbor needs to exist if three consecutive live cells are found, 
-        // including the ghost buffers.
+        // new neighbor needs to exist if enough live cells to give birth are found
+        // within three consecutive cells along the edge, including the ghost buffers.
+        // Unless the rule can give birth from a single cell, any such run includes
+        // an interior cell, so an empty edge row or column can be skipped without
+        // looking at it.
         //
         case GameOfLife::TOP:
-        {
-            uint8_t* pStart = &m_pCurrentCellGrid[GetOffset(BufferLeftX, TopY)];
-            uint32_t numConsecutiveLivingCells = 0;
-            for (int64_t i = 0; i < m_bufferWidth; i++)
-            {
-                if (*pStart)
-                {
-                    numConsecutiveLivingCells++;
-                }
-                else
-                {
-                    numConsecutiveLivingCells = 0;
-                }
-
-                if (numConsecutiveLivingCells == 3)
-                {
-                    return true;
-                }
-
-                pStart++;
-            }
-        }
-            break;
         case GameOfLife::BOTTOM:
         {
-            uint8_t* pStart = &m_pCurrentCellGrid[GetOffset(BufferLeftX, BottomY)];
-            uint32_t consecutiveLivingCells = 0;
-            for (int64_t i = 0; i < m_bufferWidth; i++)
+            const uint32_t Row = adjacency == GameOfLife::TOP ? 0 : SUBGRID_HEIGHT - 1;
+            if (!Utility::TestBit(m_liveRowMasks[GetGridIndex(m_pCurrentCellGrid)], Row) &&
+                !(m_format.LifeRule.Birth & (1 << 1)))
             {
-                if (*pStart)
-                {
-                    consecutiveLivingCells++;
-                }
-                else
-                {
-                    consecutiveLivingCells = 0;
-                }
-
-                if (consecutiveLivingCells == 3)
-                {
-                    return true;
-                }
-
-                pStart++;
+                return false;
             }
+
+            return CanGiveBirthAcross(GetRowBits(m_pCurrentCellGrid, m_yMin + Row));
         }
-            break;
 
         case GameOfLife::LEFT:
-        {
-            uint8_t consecutiveLivingCells = 0;
-            uint8_t* pStart = &m_pCurrentCellGrid[GetOffset(LeftX, BufferTopY)];
-            for (int64_t i = 0; i < m_bufferHeight; i++)
-            {
-                if (*pStart)
-                {
-                    ++consecutiveLivingCells;
-                }
-                else
-                {
-                    consecutiveLivingCells = 0;
-                }
-
-                if (consecutiveLivingCells == 3)
-                {
-                    return true;
-                }
-
-                pStart += m_bufferWidth;
-            }
-        }
-            break;
         case GameOfLife::RIGHT:
         {
-            uint8_t consecutiveLivingCells = 0;
-            uint8_t* pStart = &m_pCurrentCellGrid[GetOffset(RightX, BufferTopY)];
-            for (int64_t i = 0; i < m_bufferHeight; i++)
+            const int64_t X = adjacency == GameOfLife::LEFT ? LeftX : RightX;
+            if (!(m_liveColumns[GetGridIndex(m_pCurrentCellGrid)] & GetColumnBit(X)) &&
+                !(m_format.LifeRule.Birth & (1 << 1)))
             {
-                if (*pStart)
-                {
-                    ++consecutiveLivingCells;
-                }
-                else
-                {
-                    consecutiveLivingCells = 0;
-                }
-
-                if (consecutiveLivingCells == 3)
-                {
-                    return true;
-                }
-
-                pStart += m_bufferWidth;
+                return false;
             }
+
+            return CanGiveBirthAcross(GetColumnBits(m_pCurrentCellGrid, X));
         }
-            break;
         default:
             break;
         }
@@ -533,89 +1361,133 @@ namespace GameOfLife
         return false;
     }
 
-    void SubGrid::CopyBorder(const SubGrid& other, AdjacencyIndex adjacency)
+    template <int64_t TileWidth, int64_t TileHeight>
+    uint32_t SubGrid<TileWidth, TileHeight>::GetNeighborsInReach(uint32_t distance) const
     {
+        const size_t Current = GetGridIndex(m_pCurrentCellGrid);
+        const GhostRing Ring = GetGhostRing(m_pCurrentCellGrid);
+
         //
-        // Use the proper grid pointer for our neighbor's data. TODO: 
-        // interface should refer to generation rather than checking pointers
-        // like this. This is clunky.
+        // Padded columns and rows holding living cells, counting ghost
+        // cells. The left and top neighbors' cells are at padded column or
+        // row zero and before, and the right and bottom neighbors' just past
+        // the interior.
         //
-        uint8_t* pNeighborGrid = other.m_pCurrentCellGrid;
-        if (other.m_generation > m_generation)
+        const RowType Columns =
+            m_liveColumns[Current] | Ring.Top | Ring.Bottom |
+            (Ring.Left  ? RowType(1) : RowType(0)) |
+            (Ring.Right ? RowType(1) << static_cast<uint32_t>(SUBGRID_WIDTH + 1) : RowType(0));
+        const RowType Rows =
+            ((m_liveRowMasks[Current] | Ring.Left | Ring.Right) << 1) |
+            (Ring.Top    ? RowType(1) : RowType(0)) |
+            (Ring.Bottom ? RowType(1) << static_cast<uint32_t>(SUBGRID_HEIGHT + 1) : RowType(0));
+
+        if (!Columns || !distance)
+        {
+            return 0;
+        }
+
+        const uint32_t ColumnReach = static_cast<uint32_t>(std::min<int64_t>(distance, int64_t(SUBGRID_WIDTH)));
+        const uint32_t RowReach    = static_cast<uint32_t>(std::min<int64_t>(distance, int64_t(SUBGRID_HEIGHT)));
+
+        const bool Left   = !!(Columns & ~(~RowType(0) << (ColumnReach + 1)));
+        const bool Right  = !!(Columns >> static_cast<uint32_t>(SUBGRID_WIDTH + 1 - ColumnReach));
+        const bool Top    = !!(Rows & ~(~RowType(0) << (RowReach + 1)));
+        const bool Bottom = !!(Rows >> static_cast<uint32_t>(SUBGRID_HEIGHT + 1 - RowReach));
+
+        uint32_t mask = 0;
+        mask |= Top    ? 1 << AdjacencyIndex::TOP    : 0;
+        mask |= Bottom ? 1 << AdjacencyIndex::BOTTOM : 0;
+        mask |= Left   ? 1 << AdjacencyIndex::LEFT   : 0;
+        mask |= Right  ? 1 << AdjacencyIndex::RIGHT  : 0;
+        mask |= Top    && Left  ? 1 << AdjacencyIndex::TOP_LEFT     : 0;
+        mask |= Top    && Right ? 1 << AdjacencyIndex::TOP_RIGHT    : 0;
+        mask |= Bottom && Left  ? 1 << AdjacencyIndex::BOTTOM_LEFT  : 0;
+        mask |= Bottom && Right ? 1 << AdjacencyIndex::BOTTOM_RIGHT : 0;
+
+        return mask;
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGrid<TileWidth, TileHeight>::CanGiveBirthAcross(RowType edge) const
+    {
+        const uint32_t Birth = m_format.LifeRule.Birth;
+        if (!Birth)
+        {
+            return false;
+        }
+
+        switch (Utility::CountTrailingZeros(Birth))
         {
-            pNeighborGrid =
-                OtherPointer(
-                    pNeighborGrid,
-                    other.m_pCellGrids[0],
-                    other.m_pCellGrids[1]
-                    );
+        case 1:
+            return !!edge;
+        case 2:
+            return !!((edge & (edge >> 1)) | (edge & (edge >> 2)));
+        default:
+            return !!(edge & (edge >> 1) & (edge >> 2));
         }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::CopyBorders()
+    {
+        assert(!IsDormant());
 
+        for (int i = 0; i < AdjacencyIndex::MAX; ++i)
+        {
+            SubGrid* pNeighbor = m_pNeighbors[i];
+            if (!pNeighbor)
+            {
+                continue;
+            }
+
+            CopyBorder(*pNeighbor, static_cast<AdjacencyIndex>(i));
+        }
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::CopyBorder(const SubGrid& other, AdjacencyIndex adjacency)
+    {
+        //
+        // Neighbors are read as of our generation. They're either at it, a
+        // generation ahead with ours in their other cell grid, or asleep, in
+        // which case both of their cell grids hold the same cells.
+        //
+        // Ghost cells come from the edges the neighbor published rather than
+        // its cell grid; in the bit-packed layout the neighbor's own ghost
+        // cells share words with its interior, and it may be copying them
+        // concurrently. Every subgrid has the same geometry, so the
+        // neighbor's first and last interior columns are ours too.
+        //
+        static const uint32_t FirstColumn = 1;
+        static const uint32_t LastColumn  = static_cast<uint32_t>(SUBGRID_WIDTH);
+
+        const EdgeRecord& Edges = other.GetEdges(m_generation);
         switch (adjacency)
         {
         case AdjacencyIndex::TOP_LEFT:
-            m_pCurrentCellGrid[GetOffset(m_xMin - 1, m_yMin - 1)] = 
-                other.GetCellState(
-                    pNeighborGrid,
-                    other.XMin() + other.Width()  - 1,
-                    other.YMin() + other.Height() - 1
-                    );
+            SetCellState(m_pCurrentCellGrid, m_xMin - 1, m_yMin - 1, Utility::TestBit(Edges.Bottom, LastColumn));
             break;
         case AdjacencyIndex::TOP:
-            CopyRowFrom(
-                other, pNeighborGrid,
-                *this, m_pCurrentCellGrid,
-                other.YMin() + other.Height() - 1,
-                m_yMin - 1
-                );
+            SetGhostRow(m_pCurrentCellGrid, m_yMin - 1, Edges.Bottom);
             break;
         case AdjacencyIndex::TOP_RIGHT:
-            m_pCurrentCellGrid[GetOffset(m_xMin + m_width, m_yMin - 1)] = 
-                other.GetCellState(
-                    pNeighborGrid,
-                    other.XMin(),
-                    other.YMin() + other.Height() - 1
-                    );
+            SetCellState(m_pCurrentCellGrid, m_xMin + SUBGRID_WIDTH, m_yMin - 1, Utility::TestBit(Edges.Bottom, FirstColumn));
             break;
         case AdjacencyIndex::LEFT:
-            CopyColumnFrom(
-                other, pNeighborGrid,
-                *this, m_pCurrentCellGrid,
-                other.XMin() + other.Width() - 1,
-                m_xMin - 1
-                );
+            SetGhostColumn(m_pCurrentCellGrid, m_xMin - 1, Edges.Right);
             break;
         case AdjacencyIndex::RIGHT:
-            CopyColumnFrom(
-                other, pNeighborGrid,
-                *this, m_pCurrentCellGrid,
-                other.XMin(),
-                m_xMin + m_width
-                );
+            SetGhostColumn(m_pCurrentCellGrid, m_xMin + SUBGRID_WIDTH, Edges.Left);
             break;
         case AdjacencyIndex::BOTTOM_LEFT:
-            m_pCurrentCellGrid[GetOffset(m_xMin - 1, m_yMin + m_height)] = 
-                other.GetCellState(
-                    pNeighborGrid,
-                    other.XMin() + other.Width() - 1,
-                    other.YMin()
-                    );
+            SetCellState(m_pCurrentCellGrid, m_xMin - 1, m_yMin + SUBGRID_HEIGHT, Utility::TestBit(Edges.Top, LastColumn));
             break;
         case AdjacencyIndex::BOTTOM:
-            CopyRowFrom(
-                other, pNeighborGrid,
-                *this, m_pCurrentCellGrid,
-                other.YMin(),
-                m_yMin + m_height
-                );
+            SetGhostRow(m_pCurrentCellGrid, m_yMin + SUBGRID_HEIGHT, Edges.Top);
             break;
         case AdjacencyIndex::BOTTOM_RIGHT:
-            m_pCurrentCellGrid[GetOffset(m_xMin + m_width, m_yMin + m_height)] = 
-                other.GetCellState(
-                    pNeighborGrid,
-                    other.XMin(),
-                    other.YMin()
-                    );
+            SetCellState(m_pCurrentCellGrid, m_xMin + SUBGRID_WIDTH, m_yMin + SUBGRID_HEIGHT, Utility::TestBit(Edges.Top, FirstColumn));
             break;
         default:
             assert(false);
@@ -623,51 +1495,59 @@ namespace GameOfLife
         }
     }
 
-    void SubGrid::ClearBorder(AdjacencyIndex adjacency)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubGrid<TileWidth, TileHeight>::ClearBorder(AdjacencyIndex adjacency)
     {
-        uint8_t* pOtherGrid =
-            OtherPointer(
-                m_pCurrentCellGrid,
-                m_pCellGrids[0],
-                m_pCellGrids[1]
-                );
+        //
+        // Dormant subgrids have no ghost cells to clear, and get them back
+        // dead.
+        //
+        if (IsDormant())
+        {
+            return;
+        }
+
         switch (adjacency)
         {
         case AdjacencyIndex::TOP_LEFT:
-            m_pCellGrids[0][GetOffset(m_xMin - 1, m_yMin - 1)] = 0;
-            m_pCellGrids[1][GetOffset(m_xMin - 1, m_yMin - 1)] = 0;
+            KillCell(m_pCellGrids[0], m_xMin - 1, m_yMin - 1);
+            KillCell(m_pCellGrids[1], m_xMin - 1, m_yMin - 1);
             break;
         case AdjacencyIndex::TOP:
             ClearRow(m_pCellGrids[0], m_yMin - 1);
             ClearRow(m_pCellGrids[1], m_yMin - 1);
             break;
         case AdjacencyIndex::TOP_RIGHT:
-            m_pCellGrids[0][GetOffset(m_xMin + m_width, m_yMin - 1)] = 0;
-            m_pCellGrids[1][GetOffset(m_xMin + m_width, m_yMin - 1)] = 0;
+            KillCell(m_pCellGrids[0], m_xMin + SUBGRID_WIDTH, m_yMin - 1);
+            KillCell(m_pCellGrids[1], m_xMin + SUBGRID_WIDTH, m_yMin - 1);
             break;
         case AdjacencyIndex::LEFT:
-            ClearColumn(m_pCellGrids[0], m_xMin - 1);
-            ClearColumn(m_pCellGrids[1], m_xMin - 1);
+            SetGhostColumn(m_pCellGrids[0], m_xMin - 1, RowType(0));
+            SetGhostColumn(m_pCellGrids[1], m_xMin - 1, RowType(0));
             break;
         case AdjacencyIndex::RIGHT:
-            ClearColumn(m_pCellGrids[0], m_xMin + m_width);
-            ClearColumn(m_pCellGrids[1], m_xMin + m_width);
+            SetGhostColumn(m_pCellGrids[0], m_xMin + SUBGRID_WIDTH, RowType(0));
+            SetGhostColumn(m_pCellGrids[1], m_xMin + SUBGRID_WIDTH, RowType(0));
             break;
         case AdjacencyIndex::BOTTOM_LEFT:
-            m_pCellGrids[0][GetOffset(m_xMin - 1, m_yMin + m_height)] = 0;
-            m_pCellGrids[1][GetOffset(m_xMin - 1, m_yMin + m_height)] = 0;
+            KillCell(m_pCellGrids[0], m_xMin - 1, m_yMin + SUBGRID_HEIGHT);
+            KillCell(m_pCellGrids[1], m_xMin - 1, m_yMin + SUBGRID_HEIGHT);
             break;
         case AdjacencyIndex::BOTTOM:
-            ClearRow(m_pCellGrids[0], m_yMin + m_height);
-            ClearRow(m_pCellGrids[1], m_yMin + m_height);
+            ClearRow(m_pCellGrids[0], m_yMin + SUBGRID_HEIGHT);
+            ClearRow(m_pCellGrids[1], m_yMin + SUBGRID_HEIGHT);
             break;
         case AdjacencyIndex::BOTTOM_RIGHT:
-            m_pCellGrids[0][GetOffset(m_xMin + m_width, m_yMin + m_height)] = 0;
-            m_pCellGrids[1][GetOffset(m_xMin + m_width, m_yMin + m_height)] = 0;
+            KillCell(m_pCellGrids[0], m_xMin + SUBGRID_WIDTH, m_yMin + SUBGRID_HEIGHT);
+            KillCell(m_pCellGrids[1], m_xMin + SUBGRID_WIDTH, m_yMin + SUBGRID_HEIGHT);
             break;
         default:
             assert(false);
             break;
         }
     }
+
+    template class SubGrid<30, 30>;
+    template class SubGrid<62, 62>;
+    template class SubGrid<126, 126>;
 }
@@ -1,102 +1,185 @@
 #pragma once
 
-// 
+//
 // A grid of cells which represents a sub-region of the whole game
 // state.
 //
 
 #include "RectangularGrid.h"
 #include "AdjacencyIndex.h"
+#include "Tile.h"
+#include "Rule.h"
+#include "Kernels/BitKernels.h"
+#include "Kernels/ByteKernels.h"
 
 #include <Utility/AlignedMemoryPool.h>
+#include <Utility/Bits.h>
 
+#include <cstdint>
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 namespace Utility
 {
     template <size_t N> class AlignedMemoryPool;
+    class SpillFile;
 }
 
 namespace GameOfLife
 {
-    class SubGridGraph;
+    template <int64_t TileWidth, int64_t TileHeight> class SubGridGraph;
+    template <int64_t TileWidth, int64_t TileHeight> class SubgridStorage;
+
+    //
+    // Identifies a subgrid within its SubgridStorage.
+    //
+    typedef uint32_t SubgridHandle;
+
+    //
+    // Particularly helpful during initialization-- takes as input a cell
+    // coordinate in world space and returns the subgrid coordinates it
+    // belongs to.
+    //
+    // The implementation is inlined here for easy access from the reference
+    // implementation. This is the only commonality at the moment; any more
+    // and this can probably just be factored out into a separate library.
+    //
+    inline int64_t SnapCoordinateToSubgridCorner(int64_t value, int64_t max)
+    {
+        int64_t newValue;
+
+        if (value >= 0)
+        {
+            //
+            // For positive values and zero, just remove the remainder to
+            // snap back to the next least integer modulo max.
+            //
+            newValue = value - (value % max);
+        }
+        else
+        {
+            //
+            // Negative values are a little trickier; the intent here is still
+            // to get the next-least integer modulo max, but modulus doesn't
+            // do what we need when operating on negative values.
+            //
+            newValue = ((value + 1) / max - 1) * max;
+        }
+
+        return newValue;
+    }
+
+    //
+    // Same as above for a subgrid dimension known at compile time, which
+    // turns the divisions into multiplies.
+    //
+    template <int64_t Max>
+    int64_t SnapCoordinateToSubgridCorner(int64_t value)
+    {
+        return SnapCoordinateToSubgridCorner(value, Max);
+    }
+
+    //
+    // How a subgrid stores its cells, which kernel steps them and the rule
+    // the kernel applies. Only the kernel matching the layout is used.
+    //
+    struct CellFormat
+    {
+        CellFormat(
+            CellLayout layout = CellLayout::BitPacked,
+            Kernels::BitKernelType bitKernel = Kernels::BitKernelType::Adder,
+            Kernels::ByteKernelType byteKernel = Kernels::GetBestByteKernel(),
+            const Rule& lifeRule = Rule()
+            ) : Layout(layout), BitKernel(bitKernel), ByteKernel(byteKernel), LifeRule(lifeRule)
+        {}
+
+        CellLayout              Layout;
+        Kernels::BitKernelType  BitKernel;
+        Kernels::ByteKernelType ByteKernel;
+        Rule                    LifeRule;
+    };
 
     //
-    // This class represents a single static, rectangular subregion 
-    // within world space. The intent is for this class only to indirectly 
+    // What a subgrid's cells did in its most recent step.
+    //
+    // Still:   nothing changed.
+    // Period2: cells changed, but match those of two generations ago.
+    // Active:  anything else.
+    //
+    enum class TileActivity
+    {
+        Active,
+        Still,
+        Period2
+    };
+
+    //
+    // This class represents a single static, rectangular subregion
+    // within world space. The intent is for this class only to indirectly
     // refer to cell grid information, which lives in the SubgridStorage
     // data structure.
     //
-    class SubGrid : public RectangularGrid
+    // Dimensions are template parameters so that every loop bound and buffer
+    // stride is a compile-time constant. SubGrid.cpp explicitly instantiates
+    // the supported sizes.
+    //
+    template <int64_t TileWidth, int64_t TileHeight>
+    class SubGrid final : public Tile
     {
     public:
-        //
-        // Type for describing (x,y) world-space coordinates.
-        //
-        typedef std::pair<int64_t, int64_t> CoordinateType;
+        typedef GameOfLife::CoordinateType CoordinateType;
+        typedef GameOfLife::VertexType VertexType;
 
         //
-        // Type for the vertex buffer ultimately used for rendering living
-        // cells within the subgrid.
-        //
-        struct VertexType
-        {
-            VertexType(int64_t x, int64_t y) :
-                X(static_cast<float>(x)), Y(static_cast<float>(y)) {}
-            float X;
-            float Y;
-        };
-
-        // 
-        // All subgrids will have these logical dimensions or, in the case where
-        // subgrids live on the edge of a world space whose dimensions is not an
-        // even multiple of SUBGRID_WIDTH/HEIGHT, may possibly be smaller.
+        // All subgrids will have these logical dimensions. World space is
+        // always snapped to a multiple of them.
         //
         // A note that the actual cell grid buffers have one cell of padding in
         // each direction to store cell information from neighboring subgrids.
         //
-        static const int64_t SUBGRID_WIDTH = 30;
-        static const int64_t SUBGRID_HEIGHT = 30;
+        static const int64_t SUBGRID_WIDTH  = TileWidth;
+        static const int64_t SUBGRID_HEIGHT = TileHeight;
+
+        static const int64_t BUFFER_WIDTH  = SUBGRID_WIDTH + 2;
+        static const int64_t BUFFER_HEIGHT = SUBGRID_HEIGHT + 2;
 
         //
-        // Particularly helpful during initialization-- takes as input a cell
-        // coordinate in world space and returns the subgrid coordinates it
-        // belongs to.
-        //
-        // The implementation is inlined here for easy access from the reference
-        // implementation. This is the only commonality at the moment; any more
-        // and this can probably just be factored out into a separate library.
+        // Smallest word which holds a full padded row in the bit-packed
+        // layout.
         //
-        static int64_t SubGrid::SnapCoordinateToSubgridCorner(int64_t value, int64_t max)
-        {
-            int64_t newValue;
+        typedef typename std::conditional<
+            BUFFER_WIDTH <= 32, uint32_t,
+            typename std::conditional<BUFFER_WIDTH <= 64, uint64_t, Utility::UInt128>::type
+            >::type RowType;
 
-            if (value >= 0)
-            {
-                //
-                // For positive values and zero, just remove the remainder to
-                // snap back to the next least integer modulo max.
-                //
-                newValue = value - (value % max);
-            }
-            else
-            {
-                //
-                // Negative values are a little trickier; the intent here is still
-                // to get the next-least integer modulo max, but modulus doesn't
-                // do what we need when operating on negative values.
-                //
-                newValue = ((value + 1) / max - 1) * max;
-            }
+        static_assert(
+            BUFFER_WIDTH <= 128,
+            "Padded subgrid rows must fit in a single RowType."
+            );
+        static_assert(
+            !(BUFFER_WIDTH % 32),
+            "The byte-per-cell kernels work on padded rows in multiples of 32 cells."
+            );
+        static_assert(
+            !(SUBGRID_WIDTH % 2) && !(SUBGRID_HEIGHT % 2),
+            "The lookup table kernel steps 2x2 blocks of cells."
+            );
+        static_assert(
+            BUFFER_HEIGHT <= BUFFER_WIDTH,
+            "Ghost columns and row masks are packed into a single RowType."
+            );
 
-            return newValue;
-        }
+        //
+        // Size in bytes of a single cell grid buffer, for sizing the memory
+        // pool sublocks. Each buffer holds a cell grid followed by its live
+        // rows.
+        //
+        static size_t GetCellGridBufferSize(CellLayout layout);
 
         SubGrid(
-            Utility::AlignedMemoryPool<64>& memoryPool, 
-            const RectangularGrid& worldBounds,
-            SubGridGraph& graph,
+            Utility::AlignedMemoryPool<64>& memoryPool,
+            const CellFormat& format,
             int64_t xmin, int64_t ymin,
             uint32_t generation = 0
             );
@@ -108,7 +191,7 @@ namespace GameOfLife
         //
         void RaiseCell(int64_t x, int64_t y);
         void KillCell(int64_t x, int64_t y);
-        bool GetCellState(int64_t x, int64_t y) const;
+        bool GetCellState(int64_t x, int64_t y) const override;
 
         //
         // Retrieves this SubGrid's upper-left cell coordinates.
@@ -116,24 +199,161 @@ namespace GameOfLife
         const CoordinateType& GetCoordinates() const;
 
         //
-        // Retrieve this generation's vertex data for rendering. Contains
-        // only living cell coordinates in world space.
+        // Neighbors by AdjacencyIndex, or null where there are none. The
+        // links live in the subgrids themselves, kept up to date by
+        // SubGridGraph as subgrids come and go, so following one is just a
+        // load.
+        //
+        SubGrid* GetNeighbor(AdjacencyIndex adjacency) const { return m_pNeighbors[adjacency]; }
+
+        //
+        // Where SubgridStorage keeps this subgrid. Handles are small and
+        // dense, so they make good indices into per-subgrid arrays.
+        //
+        SubgridHandle GetHandle() const { return m_handle; }
+        SubGrid* const* GetNeighbors() const { return m_pNeighbors; }
+
+        //
+        // Scans the current generation's live rows, or the dormant rows, for
+        // living cells; see Tile::ExtractVertices().
         //
-        const std::vector<VertexType>& GetVertexData() const;
+        void ExtractVertices(const CoordinateType& origin, std::vector<VertexType>& vertices) const override;
 
         //
         // Returns true if any border cells are living.
         //
         bool HasBorderCells() const;
-         
+
         //
         // Advances the cell states to the next gen and returns the number of living
-        // cells produced.
+        // cells produced. Only touches this subgrid, so subgrids can be stepped
+        // concurrently; ghost cells must already be up to date (see
+        // CopyBorders()) and are left as they were.
         //
         uint32_t AdvanceGeneration();
 
+        //
+        // Temporal blocking. Rather than copying borders every generation, a
+        // subgrid can gather every cell within depth cells of it into a halo
+        // and step depth generations from that alone, the region it knows
+        // shrinking by a cell on each side every generation.
+        //
+        // The halo is depth rows above and below us and depth columns either
+        // side, as rows of GetHaloSize(depth) / (SUBGRID_HEIGHT + 2 * depth)
+        // words with bit x of a row holding halo column x.
+        //
+        static const uint32_t MAX_HALO_DEPTH = 16;
+
+        static size_t GetHaloSize(uint32_t depth);
+
+        //
+        // Writes our cells and those of our neighbors within depth cells of
+        // us, as of our generation, to pHalo. Neighbors must be at our
+        // generation or asleep. Only reads live rows, so neighbors can
+        // gather concurrently, but none of them may step until all are done.
+        //
+        void GatherHalo(uint32_t depth, uint64_t* pHalo) const;
+
+        //
+        // Advances depth generations, at least two, from a halo written by
+        // GatherHalo() and returns the number of living cells produced.
+        // HasChanged() and the like then describe the last of them, as if it
+        // had been stepped by AdvanceGeneration(). Ghost cells are left out
+        // of date; see CopyBorders().
+        //
+        uint32_t AdvanceGenerations(uint32_t depth, uint64_t const* pHalo);
+
         uint32_t GetGeneration() const { return m_generation; }
 
+        //
+        // Number of living cells in the current generation.
+        //
+        uint32_t GetLiveCellCount() const { return m_liveCellCounts[GetGridIndexForGeneration(m_generation)]; }
+
+        //
+        // Sleep/wake scheduling. Stepping a subgrid whose cells and ghost
+        // cells didn't change during the previous generation just reproduces
+        // the same state, so SparseGrid only steps subgrids which are awake.
+        // A subgrid stays awake while its cells change, and is woken by
+        // neighbors whose border cells change.
+        //
+
+        //
+        // True if this subgrid must be stepped at the given generation.
+        //
+        bool IsAwake(uint32_t generation) const { return generation <= m_wakeGeneration; }
+
+        //
+        // Keeps this subgrid awake through the given generation. Returns
+        // false if it already was.
+        //
+        bool Wake(uint32_t generation);
+
+        //
+        // Brings the generation of a subgrid which slept through the last
+        // few generations up to date. Its interior is the same in both cell
+        // grids while asleep, so all that changes is which one is current.
+        // Dormant subgrids get their cell grids back.
+        //
+        void SkipToGeneration(uint32_t generation);
+
+        //
+        // Set by SparseGrid on subgrids it's about to remove, so they can all
+        // be dropped from its list of awake subgrids in a single pass.
+        //
+        void Retire() { m_isRetired = true; }
+        bool IsRetired() const { return m_isRetired; }
+
+        //
+        // A subgrid which has slept for a while can go dormant, handing both
+        // of its cell grid buffers back to the memory pool and trimming its
+        // vertex data to the living cells. All it keeps of its cells is the
+        // rows which have any living, packed together, which is enough to
+        // rebuild the rest. Dormant subgrids can still be read by neighbors
+        // and renderers, but must be brought up to date with
+        // SkipToGeneration() before anything else.
+        //
+        bool IsDormant() const { return !m_pCurrentCellGrid; }
+
+        void MakeDormant();
+
+        //
+        // Bytes of packed rows a dormant subgrid keeps in memory.
+        //
+        size_t GetDormantRowBytes() const;
+
+        //
+        // A dormant subgrid can move its packed rows out to a record of a
+        // spill file, sized by GetSpillRecordSize(). They're read from the
+        // file's mapping from then on, and the record is freed again once
+        // SkipToGeneration() has unpacked them.
+        //
+        static size_t GetSpillRecordSize() { return sizeof(RowType) * SUBGRID_HEIGHT; }
+
+        bool IsSpilled() const { return m_pSpillFile != nullptr; }
+
+        void Spill(Utility::SpillFile& spillFile);
+
+        //
+        // Asks the OS to start reading a spilled subgrid's rows back in, for
+        // a subgrid which is likely to be read or woken soon.
+        //
+        void PrefetchSpilled() const;
+
+        //
+        // Whether the last AdvanceGeneration() changed any cells, and which
+        // neighbors can see the change: bit i is set if the neighbor at
+        // AdjacencyIndex i borders a changed cell.
+        //
+        bool HasChanged() const { return m_hasChanged; }
+        uint32_t GetChangedBorders() const { return m_changedBorders; }
+
+        TileActivity GetActivity() const;
+
+        CellLayout GetCellLayout() const { return m_format.Layout; }
+
+        const CellFormat& GetCellFormat() const { return m_format; }
+
         //
         // Determines if the next generation will impact cells in a neighbor
         // which does not yet exist.
@@ -141,22 +361,44 @@ namespace GameOfLife
         bool IsNextGenerationNeighbor(AdjacencyIndex adjacency) const;
 
         //
-        // Copies border cells of a neighbor according to its adjacency.
+        // Returns a mask with bit i set if any cell of the neighbor at
+        // AdjacencyIndex i lies within distance cells of one of our living
+        // cells or ghost cells, i.e. if changes starting here could reach
+        // it within that many generations. Rows and columns are checked
+        // separately, so the corners are conservative.
+        //
+        uint32_t GetNeighborsInReach(uint32_t distance) const;
+
+        //
+        // Copies border cells of a neighbor, as of our generation, into our
+        // current cell grid according to its adjacency. The neighbor must be
+        // at our generation, one generation ahead of it, or asleep.
         //
         void CopyBorder(const SubGrid& other, AdjacencyIndex adjacency);
 
+        //
+        // CopyBorder() from every neighbor. Only writes our own ghost cells,
+        // so neighbors can copy their borders concurrently. A neighbor may
+        // even be stepped meanwhile, as long as it's at our generation to
+        // begin with.
+        //
+        void CopyBorders();
+
         //
         // Sets border cells to zero.
         //
         void ClearBorder(AdjacencyIndex adjacency);
 
     private:
+        friend class SubGridGraph<TileWidth, TileHeight>;
+        friend class SubgridStorage<TileWidth, TileHeight>;
+
         //
-        // SubGrid objects get tossed around a lot for bookkeeping, so make 
+        // SubGrid objects get tossed around a lot for bookkeeping, so make
         // copies cheap. Place data on the heap; just track pointers in here.
         //
         uint8_t* m_pCellGrids[2];
-        
+
         //
         // Reference to the memory pool for managing cell grid memory.
         // Used to allocate ping-pong cell grid buffers in the constructor,
@@ -165,10 +407,50 @@ namespace GameOfLife
         Utility::AlignedMemoryPool<64>& m_memoryPool;
 
         //
-        // Pointer to the active cell grid.
+        // Pointer to the active cell grid, or null while dormant.
         //
         uint8_t* m_pCurrentCellGrid;
 
+        //
+        // Layout of both cell grids, and the kernel which steps them.
+        //
+        CellFormat m_format;
+
+        //
+        // m_format's rule if the kernels are specialized for it, and its
+        // lookup table if stepping goes through one.
+        //
+        StaticRuleType m_staticRule;
+        const uint8_t* m_pLookupTable;
+
+        //
+        // Mask of the interior (non-ghost) bits in each row.
+        //
+        static RowType InteriorMask()
+        {
+            return (~RowType(0) >> static_cast<uint32_t>(sizeof(RowType) * 8 - SUBGRID_WIDTH)) << 1;
+        }
+
+        //
+        // Masks over interior rows, for the row masks below: every row, and
+        // every even row.
+        //
+        static RowType InteriorRowMask()
+        {
+            return ~RowType(0) >> static_cast<uint32_t>(sizeof(RowType) * 8 - SUBGRID_HEIGHT);
+        }
+
+        static RowType EvenRowMask()
+        {
+            RowType mask = 0;
+            for (uint32_t row = 0; row < SUBGRID_HEIGHT; row += 2)
+            {
+                mask |= RowType(1) << row;
+            }
+
+            return mask;
+        }
+
         //
         // Internal equivalents to the public versions above which may target
         // a particular cell grid, hence the leading parameter in each.
@@ -178,13 +460,10 @@ namespace GameOfLife
         void KillCell(uint8_t* pGrid, int64_t x, int64_t y);
 
         //
-        // Copies a row from a subgrid to another.
+        // Sets a single cell without touching the vertex data. Used for
+        // ghost cells.
         //
-        static void CopyRowFrom(
-            const SubGrid& src, uint8_t const* pSrcGrid,
-            const SubGrid& dst, uint8_t* pDstGrid,
-            int64_t ySrc, int64_t yDst
-        );
+        void SetCellState(uint8_t* pGrid, int64_t x, int64_t y, bool alive);
 
         //
         // Zeroes out a row in the given cell grid buffer.
@@ -192,57 +471,310 @@ namespace GameOfLife
         void ClearRow(uint8_t* pBuffer, int64_t row);
 
         //
-        // Equivalent operations as above, but performed on columns.
+        // Sets the cells of a row between the ghost columns from a padded
+        // row bitmask, leaving the ghost corners alone. y is in world
+        // coordinates.
+        //
+        void SetGhostRow(uint8_t* pGrid, int64_t y, RowType bits);
+
+        //
+        // Sets the cells of a column between the ghost rows from a bitmask
+        // with bit i holding interior row i. x is in world coordinates.
+        //
+        void SetGhostColumn(uint8_t* pGrid, int64_t x, RowType bits);
+
+        //
+        // Returns a full padded row, ghost cells included, as a bitmask
+        // regardless of layout. y is in world coordinates.
         //
-        static void CopyColumnFrom(
-            const SubGrid& src, uint8_t const* pSrcGrid,
-            const SubGrid& dst, uint8_t* pDstGrid,
-            int64_t xSrc, int64_t xDst
-        );
-        void ClearColumn(uint8_t* pBuffer, int64_t col);
+        RowType GetRowBits(uint8_t const* pGrid, int64_t y) const;
 
         //
-        // Get offset into the current cell grid buffer where (x,y) are
+        // The same for a full padded column: bit i is the cell in padded row
+        // i. x is in world coordinates.
+        //
+        RowType GetColumnBits(uint8_t const* pGrid, int64_t x) const;
+
+        //
+        // Get the row index into a bit-packed cell grid buffer and the bit
+        // within that row for (x,y), which are in world coordinates.
+        //
+        size_t GetRowIndex(int64_t y) const;
+        RowType GetColumnBit(int64_t x) const;
+
+        //
+        // Get offset into a byte-per-cell grid buffer where (x,y) are
         // in world coordinates.
         //
         size_t GetOffset(int64_t x, int64_t y) const;
 
+        static RowType* AsRows(uint8_t* pGrid)
+        {
+            return reinterpret_cast<RowType*>(pGrid);
+        }
+
+        static RowType const* AsRows(uint8_t const* pGrid)
+        {
+            return reinterpret_cast<RowType const*>(pGrid);
+        }
+
+        //
+        // Returns true if the living cells along a padded edge row or column
+        // could give birth to a cell just beyond it, i.e. if any three
+        // consecutive cells hold as many living cells as the rule's smallest
+        // birth count. Births needing more than three are assumed possible
+        // with three.
+        //
+        bool CanGiveBirthAcross(RowType edge) const;
+
+        //
+        // Given the changed cells of the top and bottom interior rows and of
+        // all interior rows combined, returns the GetChangedBorders() mask.
+        //
+        static uint32_t GetChangedBorderMask(RowType top, RowType bottom, RowType any);
+
+        //
+        // All ghost cells of a cell grid. Columns hold bit i for interior
+        // row i; rows are the full padded rows, so they include the corners.
+        //
+        struct GhostRing
+        {
+            RowType Top;
+            RowType Bottom;
+            RowType Left;
+            RowType Right;
+
+            bool operator==(const GhostRing& other) const
+            {
+                return Top == other.Top && Bottom == other.Bottom &&
+                       Left == other.Left && Right == other.Right;
+            }
+        };
+
+        GhostRing GetGhostRing(uint8_t const* pGrid) const;
+
+        //
+        // Runs the step kernel for our layout from pSrc into pDst over
+        // numRows interior rows starting at firstRow, writing the living
+        // cells of each of them to pLiveRows[row].
+        //
+        void StepCells(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t firstRow, int64_t numRows,
+            RowType* pLiveRows
+            ) const;
+
+        //
+        // StepCells() with the adder kernel specialized for RuleT.
+        //
+        template <typename RuleT>
+        void StepRowsAdder(
+            uint8_t const* pSrc, uint8_t* pDst,
+            int64_t firstRow, int64_t numRows,
+            RowType* pLiveRows
+            ) const;
+
+        //
+        // Rebuilds m_liveRowMasks[grid], m_liveColumns[grid],
+        // m_liveCellCounts[grid] and m_edges[grid] from m_liveRows[grid].
+        //
+        void UpdateLiveMasks(size_t grid);
+
+        //
+        // Words in each row of a halo of the given depth, including one
+        // spare so a row can be read 64 bits at a time from any column.
+        //
+        static int64_t GetHaloRowWords(uint32_t depth)
+        {
+            return (SUBGRID_WIDTH + 2 * depth + 63) / 64 + 1;
+        }
+
+        //
+        // Steps a halo depth generations in strips 64 columns wide, with
+        // stepper computing each next row of a strip. The interior rows of
+        // the last three generations, oldest first, go to pGenerationsOut.
+        //
+        template <typename StepperT>
+        void StepHalo(
+            uint32_t depth, uint64_t const* pHalo,
+            const StepperT& stepper,
+            RowType (*pGenerationsOut)[SUBGRID_HEIGHT]
+            ) const;
+
+        //
+        // Overwrites a cell grid's interior, live rows and vertex data with
+        // the given interior rows.
+        //
+        void StoreGeneration(size_t grid, RowType const* pRows);
+
+        //
+        // Allocates the cell grid buffers of a dormant subgrid and fills
+        // their live rows and interiors back in from the packed rows. Ghost
+        // cells start out dead.
+        //
+        void Rehydrate();
+
+        //
+        // Writes every interior row of a dormant subgrid to pRows and
+        // returns it.
+        //
+        RowType const* UnpackDormantRows(RowType* pRows) const;
+
+        //
+        // A dormant subgrid's packed rows, wherever they are.
+        //
+        RowType const* GetDormantRows() const;
+
+        //
+        // Bytes taken up by a cell grid within its buffer, i.e. the offset
+        // of the live rows.
+        //
+        static size_t GetCellGridSize(CellLayout layout);
+
+        //
+        // Index within m_pCellGrids of the cell grid holding the given
+        // generation, which must be the current or previous one, or any
+        // generation at all while we're asleep.
+        //
+        size_t GetGridIndexForGeneration(uint32_t generation) const
+        {
+            return (generation ^ m_gridParity) & 1;
+        }
+
+        //
+        // Living cells of a generation's interior rows. Unlike the cell
+        // grids, these are only written while stepping, so neighbors can
+        // read them while we copy borders. Not while dormant, though; see
+        // UnpackDormantRows().
+        //
+        RowType const* GetLiveRows(uint32_t generation) const
+        {
+            return m_liveRows[GetGridIndexForGeneration(generation)];
+        }
+
+        //
+        // The living cells along our edges in one generation, which is all
+        // neighbors need for their ghost cells. Rows are padded like the
+        // live rows, with the corners at either end; columns are transposed,
+        // bit i holding interior row i, so each edge is a single word rather
+        // than a bit from every row.
+        //
+        struct EdgeRecord
+        {
+            RowType Top;
+            RowType Bottom;
+            RowType Left;
+            RowType Right;
+        };
+
+        //
+        // Published along with the live rows, and just as safe to read.
+        //
+        const EdgeRecord& GetEdges(uint32_t generation) const
+        {
+            return m_edges[GetGridIndexForGeneration(generation)];
+        }
+
+        //
+        // Index of pGrid within m_pCellGrids.
+        //
+        size_t GetGridIndex(uint8_t const* pGrid) const
+        {
+            return pGrid == m_pCellGrids[0] ? 0 : 1;
+        }
+
         //
         // Starting (x,y) world-space coordinates for this subgrid.
         //
         CoordinateType m_coordinates;
 
         //
-        // This subgrid's most recently completed generation. Should be
-        // at most behind by 1 generation relative to all other subgrids.
+        // This subgrid's most recently completed generation. Between calls
+        // to SparseGrid::AdvanceGeneration(), every awake subgrid is at the
+        // same generation; sleeping subgrids catch up in SkipToGeneration().
+        // SparseGrid::StepPow2() lets subgrids run ahead of each other, but
+        // never more than a generation ahead of a neighbor.
         //
-        uint32_t       m_generation;
-        SubGridGraph*  m_pGridGraph;
+        uint32_t m_generation;
 
         //
-        // Subgrid width, including ghost buffer space.
+        // Cell grid i holds the generations whose parity is i ^ m_gridParity.
+        // Stepping and skipping both keep this the same for the life of the
+        // subgrid, so neighbors can find the generation they need without
+        // looking at m_pCurrentCellGrid, which changes as we step.
         //
-        int64_t m_bufferWidth;
+        uint32_t m_gridParity;
 
         //
-        // Subgrid height, including ghost buffer space.
+        // See GetNeighbors(). Raw pointers, since neighbors point at each
+        // other; SubGridGraph clears both ends of a link when either
+        // subgrid is removed.
         //
-        int64_t m_bufferHeight;
+        SubGrid* m_pNeighbors[AdjacencyIndex::MAX];
+
+        SubgridHandle m_handle;
 
         //
-        // For rendering. Only contains set cell coordinates.
+        // Living cells of each interior row of either cell grid, in the
+        // bit-packed row format regardless of layout, for finding what
+        // changed in a step. They live in the cell grid buffers, just past
+        // the cells, so they go along with them when we're dormant.
         //
-        std::vector<VertexType> m_vertexData;
+        RowType* m_liveRows[2];
 
         //
-        // For debugging and for updating values in the vertex buffer.
+        // While dormant, the live rows which have living cells, in order;
+        // the row masks say which rows they are. Empty if none do.
         //
-        const RectangularGrid& m_worldBounds;
-    };
+        std::unique_ptr<RowType[]> m_spDormantRows;
 
-    //
-    // Saves some typing. These get copied around a lot, so better to manage
-    // their lifetimes with smart pointers.
-    //
-    typedef std::shared_ptr<SubGrid> SubGridPtr;
+        //
+        // Where the packed rows went if they were spilled; see Spill().
+        //
+        Utility::SpillFile* m_pSpillFile;
+        uint32_t            m_spillRecord;
+
+        //
+        // Bit i of a row mask is set if interior row i has living cells, and
+        // the live columns are all live rows ORed together; the lowest and
+        // highest bits of each give the bounding box of the living cells.
+        // Lets steps and neighbor checks skip empty rows and columns.
+        //
+        RowType m_liveRowMasks[2];
+        RowType m_liveColumns[2];
+
+        //
+        // Living cells in each cell grid. Like the masks, kept while dormant.
+        //
+        uint32_t m_liveCellCounts[2];
+
+        //
+        // Edges of each cell grid's interior; see GetEdges().
+        //
+        EdgeRecord m_edges[2];
+
+        //
+        // Last generation at which this subgrid must be stepped.
+        //
+        uint32_t m_wakeGeneration;
+
+        bool     m_hasChanged;
+        uint32_t m_changedBorders;
+
+        //
+        // True if the current cells match those of two generations ago.
+        //
+        bool m_repeatsEveryOther;
+
+        bool m_isRetired;
+
+        //
+        // Ghost cells seen by the last two steps, indexed by the parity of
+        // the generation they were stepped from. If both the cells and ghost
+        // cells repeat every other generation, the next generation is
+        // already in the other cell grid and the kernel can be skipped.
+        //
+        GhostRing m_ghostRings[2];
+        uint32_t  m_ghostRingGenerations[2];
+    };
 }
@@ -1,8 +1,6 @@
 #include "SubGridGraph.h"
 #include "SparseGrid.h"
 
-#include "CoordinateTypeHash.h"
-
 #include <cassert>
 
 namespace
@@ -23,56 +21,13 @@ namespace
         assert(index >= 0 && index < AdjacencyIndex::MAX);
         return static_cast<AdjacencyIndex>(AdjacencyIndex::MAX - 1 - index);
     }
-
-    struct LookupValue
-    {
-        GameOfLife::SubGridPtr spSubGrid;
-        GameOfLife::SubGrid* ppNeighbors[8];
-    };
 }
 
 namespace GameOfLife
 {
-    struct SubGridGraph::Pimpl
-    {
-        std::unordered_map<SubGrid::CoordinateType, LookupValue> SubgridLookup;
-    };
-
-    SubGridGraph::SubGridGraph()
-        : m_spPimpl(new Pimpl)
-    {}
-    
-    //
-    // For Pimpl
-    //
-    SubGridGraph::~SubGridGraph() = default;
-
-    bool SubGridGraph::GetNeighborArray(
-        SubGrid const* pSubgrid,
-        /* Out */ SubGrid**& ppNeighbors
-    ) const
-    {
-        const SubGrid::CoordinateType& Coordinates = pSubgrid->GetCoordinates();
-        auto it = m_spPimpl->SubgridLookup.find(Coordinates);
-        if (it == m_spPimpl->SubgridLookup.end())
-        {
-            return false;
-        }
-
-        ppNeighbors = it->second.ppNeighbors;
-        return true;
-    }
-
-    bool SubGridGraph::GetNeighborArray(
-        const SubGridPtr spSubgrid,
-        /* out */ SubGrid**& ppNeighbors
-        ) const
-    {
-        return GetNeighborArray(spSubgrid.get(), ppNeighbors);
-    }
-
-    AdjacencyIndex SubGridGraph::GetIndexFromNeighborPosition(
-        SubGrid::CoordinateType coord
+    template <int64_t TileWidth, int64_t TileHeight>
+    AdjacencyIndex SubGridGraph<TileWidth, TileHeight>::GetIndexFromNeighborPosition(
+        CoordinateType coord
         )
     {
         static const AdjacencyIndex LUT[3][3] =
@@ -95,9 +50,10 @@ namespace GameOfLife
         return LUT[coord.second + 1][coord.first + 1];
     }
 
-    SubGrid::CoordinateType SubGridGraph::GetNeighborPositionFromIndex(AdjacencyIndex index)
+    template <int64_t TileWidth, int64_t TileHeight>
+    CoordinateType SubGridGraph<TileWidth, TileHeight>::GetNeighborPositionFromIndex(AdjacencyIndex index)
     {
-        static const SubGrid::CoordinateType LUT[] =
+        static const CoordinateType LUT[] =
         {
             std::make_pair<int64_t, int64_t>(-1, -1), // TOP_LEFT
             std::make_pair<int64_t, int64_t>( 0, -1), // TOP
@@ -113,67 +69,58 @@ namespace GameOfLife
         return LUT[index];
     }
 
-    bool SubGridGraph::AddSubgrid(SubGridPtr spSubgrid)
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::AddSubgrid(SubGridType* pSubgrid)
     {
-        const auto& Coordinates = spSubgrid->GetCoordinates();
-        
-        auto it = m_spPimpl->SubgridLookup.find(Coordinates);
-        if (it != m_spPimpl->SubgridLookup.end()) { return false; }
-
-        m_spPimpl->SubgridLookup[Coordinates] = { spSubgrid, {} };
-
-        return true;
+        return m_subgridLookup.Insert(pSubgrid->GetCoordinates(), pSubgrid);
     }
 
-    bool SubGridGraph::AddSubgrids(const std::vector<SubGridPtr>& subgridPtrs)
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::AddSubgrids(const std::vector<SubGridType*>& subgrids)
     {
         //
         // First pass checks for any duplicates. This is all-or-nothing.
         //
-        for (auto& spSubgrid : subgridPtrs)
+        for (SubGridType* pSubgrid : subgrids)
         {
-            const auto& Coordinates = spSubgrid->GetCoordinates();
-            auto it = m_spPimpl->SubgridLookup.find(Coordinates);
-            if (it != m_spPimpl->SubgridLookup.end()) { return false; }
+            if (m_subgridLookup.Find(pSubgrid->GetCoordinates())) { return false; }
         }
         
-        for (auto& spSubgrid : subgridPtrs)
+        for (SubGridType* pSubgrid : subgrids)
         {
-            const auto& Coordinates = spSubgrid->GetCoordinates();
-            m_spPimpl->SubgridLookup[Coordinates] = { spSubgrid, {} };
+            m_subgridLookup.Insert(pSubgrid->GetCoordinates(), pSubgrid);
         }
 
         return true;
     }
 
-    bool SubGridGraph::RemoveSubgrid(const SubGridPtr& spSubgrid)
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::RemoveSubgrid(SubGridType* pSubgrid)
     {
-        const auto Coordinates = spSubgrid->GetCoordinates();
+        const auto Coordinates = pSubgrid->GetCoordinates();
 
-        auto it = m_spPimpl->SubgridLookup.find(Coordinates);
-        if (it == m_spPimpl->SubgridLookup.end()) { return false; }
+        if (m_subgridLookup.Find(Coordinates) != pSubgrid) { return false; }
 
         //
         // When we remove a vertex we've got to remove its edges as well.
         //
         for (int i = 0; i < AdjacencyIndex::MAX; ++i)
         {
-            SubGrid*& pNeighbor = it->second.ppNeighbors[i];
+            SubGridType*& pNeighbor = pSubgrid->m_pNeighbors[i];
             if (pNeighbor)
             {
                 const AdjacencyIndex ReflectedIndex =
                     GetReflectedAdjacencyIndex(static_cast<AdjacencyIndex>(i));
 
                 pNeighbor->ClearBorder(ReflectedIndex);
-                spSubgrid->ClearBorder(static_cast<AdjacencyIndex>(i));
+                pSubgrid->ClearBorder(static_cast<AdjacencyIndex>(i));
                 
-                const SubGrid::CoordinateType& NeighborCoords = pNeighbor->GetCoordinates();
-                SubGrid*& pNeighborNeighbor = m_spPimpl->SubgridLookup[NeighborCoords].ppNeighbors[ReflectedIndex];
+                SubGridType*& pNeighborNeighbor = pNeighbor->m_pNeighbors[ReflectedIndex];
 
                 //
                 // Asymmetry in the graph. Shouldn't happen.
                 //
-                assert(pNeighborNeighbor == it->second.spSubGrid.get());
+                assert(pNeighborNeighbor == pSubgrid);
 
                 //
                 // Clear respective entries for either subgrid.
@@ -183,51 +130,54 @@ namespace GameOfLife
             }
         }
 
-        m_spPimpl->SubgridLookup.erase(Coordinates);
+        m_subgridLookup.Erase(Coordinates);
 
         return true;
     }
 
-    bool SubGridGraph::QuerySubgrid(
-        const SubGrid::CoordinateType& coord,
-        SubGridPtr& spSubGrid
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::QuerySubgrid(
+        const CoordinateType& coord,
+        SubGridType*& pSubgridOut
         ) const 
     {
-        auto it = m_spPimpl->SubgridLookup.find(coord); 
-        if (it == m_spPimpl->SubgridLookup.end())
+        SubGridType* pSubgrid = m_subgridLookup.Find(coord);
+        if (!pSubgrid)
         {
             return false;
         }
 
-        spSubGrid = it->second.spSubGrid;
+        pSubgridOut = pSubgrid;
 
         return true;
     }
 
-    bool SubGridGraph::QuerySubgrid(const SubGrid::CoordinateType& coord) const 
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::QuerySubgrid(const CoordinateType& coord) const 
     {
-        auto it = m_spPimpl->SubgridLookup.find(coord); 
-        return it != m_spPimpl->SubgridLookup.end();
+        return m_subgridLookup.Find(coord) != nullptr;
     }
 
-    bool SubGridGraph::AddEdge(
-        SubGridPtr spSubgrid1,
-        SubGridPtr spSubgrid2,
+    template <int64_t TileWidth, int64_t TileHeight>
+    bool SubGridGraph<TileWidth, TileHeight>::AddEdge(
+        SubGridType* pSubgrid1,
+        SubGridType* pSubgrid2,
         AdjacencyIndex adjacency
         )
     {
-        auto it1 = m_spPimpl->SubgridLookup.find(spSubgrid1->GetCoordinates());
-        if (it1 == m_spPimpl->SubgridLookup.end()) { return false; }
-
-        auto it2 = m_spPimpl->SubgridLookup.find(spSubgrid2->GetCoordinates());
-        if (it2 == m_spPimpl->SubgridLookup.end()) { return false; }
+        if (!m_subgridLookup.Find(pSubgrid1->GetCoordinates())) { return false; }
+        if (!m_subgridLookup.Find(pSubgrid2->GetCoordinates())) { return false; }
 
         const AdjacencyIndex OneToTwoIndex = adjacency;
         const AdjacencyIndex TwoToOneIndex = GetReflectedAdjacencyIndex(adjacency);
 
-        it1->second.ppNeighbors[OneToTwoIndex] = spSubgrid2.get();
-        it2->second.ppNeighbors[TwoToOneIndex] = spSubgrid1.get();
+        pSubgrid1->m_pNeighbors[OneToTwoIndex] = pSubgrid2;
+        pSubgrid2->m_pNeighbors[TwoToOneIndex] = pSubgrid1;
 
         return true;
     }
+
+    template class SubGridGraph<30, 30>;
+    template class SubGridGraph<62, 62>;
+    template class SubGridGraph<126, 126>;
 }
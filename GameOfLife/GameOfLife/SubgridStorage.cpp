@@ -1,67 +1,142 @@
 #include "SubgridStorage.h"
-#include "SubgridGraph.h"
 
-#include <unordered_map>
+#include <algorithm>
+#include <cassert>
+#include <new>
 
 namespace GameOfLife
 {
-    SubgridStorage::~SubgridStorage() = default;
+    template <int64_t TileWidth, int64_t TileHeight>
+    SubgridStorage<TileWidth, TileHeight>::SubgridStorage()
+        : m_numClaimed(0)
+    {}
 
-    bool SubgridStorage::Add(const SubGridPtr spSubgrid)
+    template <int64_t TileWidth, int64_t TileHeight>
+    SubgridStorage<TileWidth, TileHeight>::~SubgridStorage()
     {
-        const SubGrid::CoordinateType& Coordinates = spSubgrid->GetCoordinates();
-        if (m_subgridMap.find(Coordinates) != m_subgridMap.end())
+        //
+        // Subgrids which were created but never added are destroyed too.
+        //
+        for (size_t handle = 0; handle < m_positions.size(); handle++)
         {
-            return false;
+            if (m_positions[handle] != POSITION_FREE)
+            {
+                GetSubgrid(static_cast<SubgridHandle>(handle))->~SubGridType();
+            }
         }
-
-        m_subgridMap[Coordinates] = spSubgrid;
-        return true;
     }
 
-    bool SubgridStorage::Add(const std::vector<SubGridPtr>& subgridPtrs)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubgridStorage<TileWidth, TileHeight>::Reserve(size_t count)
     {
-        //
-        // Don't add anything if there's a single duplicate.
-        //
-        for (const auto& spSubgrid : subgridPtrs)
+        CommitClaimedHandles();
+
+        while (m_freeHandles.size() < count)
         {
-            if (m_subgridMap.find(spSubgrid->GetCoordinates()) != m_subgridMap.end())
+            const size_t FirstHandle = m_positions.size();
+            if (FirstHandle + CHUNK_SIZE > POSITION_UNLISTED)
+            {
+                throw std::exception("Unrecoverable: Out of subgrid handles!");
+            }
+
+            m_chunks.emplace_back(new Slot[CHUNK_SIZE]);
+            m_positions.resize(FirstHandle + CHUNK_SIZE, static_cast<uint32_t>(POSITION_FREE));
+
+            //
+            // Hand out the new chunk in order, after whatever was freed
+            // before it.
+            //
+            m_freeHandles.insert(m_freeHandles.begin(), CHUNK_SIZE, 0);
+            for (uint32_t i = 0; i < CHUNK_SIZE; i++)
             {
-                return false;
+                m_freeHandles[i] = static_cast<SubgridHandle>(FirstHandle + CHUNK_SIZE - 1 - i);
             }
         }
+    }
 
-        //
-        // No duplicates found. Go ahead and add all subgrids in the vector.
-        //
-        for (const auto& spSubgrid : subgridPtrs)
+    template <int64_t TileWidth, int64_t TileHeight>
+    typename SubgridStorage<TileWidth, TileHeight>::SubGridType*
+    SubgridStorage<TileWidth, TileHeight>::Create(
+        Utility::AlignedMemoryPool<64>& memoryPool,
+        const CellFormat& format,
+        int64_t xmin, int64_t ymin,
+        uint32_t generation
+        )
+    {
+        const size_t Claimed = m_numClaimed++;
+        if (Claimed >= m_freeHandles.size())
         {
-            const SubGrid::CoordinateType& Coordinates = spSubgrid->GetCoordinates();
-            m_subgridMap[Coordinates] = spSubgrid;
+            assert(false);
+            throw std::exception("Unrecoverable: Created more subgrids than were reserved!");
         }
 
-        return true;
+        const SubgridHandle Handle = m_freeHandles[m_freeHandles.size() - 1 - Claimed];
+
+        //
+        // If the constructor throws, the slot stays marked free but is lost
+        // with the rest of the claimed handles.
+        //
+        SubGridType* pSubgrid = GetSubgrid(Handle);
+        new (pSubgrid) SubGridType(memoryPool, format, xmin, ymin, generation);
+        pSubgrid->m_handle = Handle;
+        m_positions[Handle] = POSITION_UNLISTED;
+
+        return pSubgrid;
     }
 
-    bool SubgridStorage::Query(const SubGrid::CoordinateType& coord, SubGridPtr& spSubgridOut)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubgridStorage<TileWidth, TileHeight>::Add(SubGridType* pSubgrid)
     {
-        auto it = m_subgridMap.find(coord);
-        if (it != m_subgridMap.end())
+        CommitClaimedHandles();
+
+        uint32_t& position = m_positions[pSubgrid->GetHandle()];
+        assert(position == POSITION_UNLISTED);
+
+        position = static_cast<uint32_t>(m_subgrids.size());
+        m_subgrids.push_back(pSubgrid);
+    }
+
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubgridStorage<TileWidth, TileHeight>::Add(const std::vector<SubGridType*>& subgrids)
+    {
+        m_subgrids.reserve(m_subgrids.size() + subgrids.size());
+        for (SubGridType* pSubgrid : subgrids)
         {
-            spSubgridOut = it->second;
-            return true;
+            Add(pSubgrid);
         }
+    }
 
-        return false;
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubgridStorage<TileWidth, TileHeight>::Remove(SubGridType* pSubgrid)
+    {
+        CommitClaimedHandles();
+
+        const SubgridHandle Handle = pSubgrid->GetHandle();
+        const uint32_t Position = m_positions[Handle];
+        assert(Position < m_subgrids.size() && m_subgrids[Position] == pSubgrid);
+
+        SubGridType* pLast = m_subgrids.back();
+        m_subgrids[Position] = pLast;
+        m_positions[pLast->GetHandle()] = Position;
+        m_subgrids.pop_back();
+
+        m_positions[Handle] = POSITION_FREE;
+        pSubgrid->~SubGridType();
+        m_freeHandles.push_back(Handle);
     }
 
-    bool SubgridStorage::Remove(const SubGridPtr& spSubgrid)
+    template <int64_t TileWidth, int64_t TileHeight>
+    void SubgridStorage<TileWidth, TileHeight>::CommitClaimedHandles()
     {
-        //
-        // Return false if we didn't actually erase anything because this
-        // subgrid was not found.
-        //
-        return m_subgridMap.erase(spSubgrid->GetCoordinates()) > 0;
+        const size_t Claimed = m_numClaimed;
+        if (Claimed)
+        {
+            m_freeHandles.resize(m_freeHandles.size() - std::min(Claimed, m_freeHandles.size()));
+            m_numClaimed = 0;
+        }
     }
+
+    template class SubgridStorage<30, 30>;
+    template class SubgridStorage<62, 62>;
+    template class SubgridStorage<126, 126>;
 }
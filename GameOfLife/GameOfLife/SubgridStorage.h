@@ -1,55 +1,145 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <type_traits>
 #include <vector>
-#include <unordered_map>
 
 #include "Subgrid.h"
-#include "CoordinateTypeHash.h"
 
 namespace GameOfLife
 {
-    class SubGridGraph;
-
     //
-    // Tracks subgrids and facilitates managing their life cycles.
+    // Owns every subgrid and manages their life cycles.
+    //
+    // Subgrids live in a slab of fixed-size chunks, addressed by compact
+    // handles, so they're packed together rather than strewn across the heap
+    // and never move once created; neighbors' raw pointers to each other stay
+    // valid until one of them is removed. Freed slots are handed out again
+    // before the slab grows. A dense array of the live subgrids makes
+    // visiting all of them a linear scan.
+    //
+    // Create() may be called from several threads at once, for as many
+    // subgrids as were last reserved. Everything else must be called from one
+    // thread at a time.
     //
+    template <int64_t TileWidth, int64_t TileHeight>
     class SubgridStorage
     {
     public:
+        typedef SubGrid<TileWidth, TileHeight> SubGridType;
+
+        SubgridStorage();
+        ~SubgridStorage();
+
         //
-        // If any of the subgrids attempting to be added are already in
-        // storage, Add() returns false and no new subgrids are added.
+        // Makes sure the next count calls to Create() have slots waiting for
+        // them.
         //
-        bool Add(const SubGridPtr spSubgrid);
-        bool Add(const std::vector<SubGridPtr>& subgrids);
+        void Reserve(size_t count);
 
         //
-        // Returns true if the provided subgrid already exists in 
-        // storage.
+        // Constructs a subgrid in a free slot. It isn't part of the storage's
+        // contents until passed to Add(), but is destroyed with the storage
+        // regardless. Throws if every reserved slot has been taken.
         //
-        bool Query(const SubGrid::CoordinateType& coordinate, /* out */SubGridPtr& spSubgridOut);
+        SubGridType* Create(
+            Utility::AlignedMemoryPool<64>& memoryPool,
+            const CellFormat& format,
+            int64_t xmin, int64_t ymin,
+            uint32_t generation = 0
+            );
 
-        ~SubgridStorage();
+        //
+        // Adds subgrids returned by Create() to the dense array.
+        //
+        void Add(SubGridType* pSubgrid);
+        void Add(const std::vector<SubGridType*>& subgrids);
 
-        // 
-        // Returns false if attempting to remove subgrid which does
-        // not exist in storage.
         //
-        bool Remove(const SubGridPtr& spSubgrid);
+        // Destroys an added subgrid and frees its slot. The last subgrid in
+        // the dense array takes its place.
+        //
+        void Remove(SubGridType* pSubgrid);
 
-        size_t GetSize() const { return m_subgridMap.size(); }
+        //
+        // The subgrid with the given handle, which must be live.
+        //
+        SubGridType* GetSubgrid(SubgridHandle handle) const
+        {
+            return reinterpret_cast<SubGridType*>(&m_chunks[handle >> CHUNK_SIZE_LOG2][handle & (CHUNK_SIZE - 1)]);
+        }
+
+        //
+        // The added subgrid with the given handle, or null if there's none,
+        // e.g. because it has since been removed. Handles are reused, so the
+        // subgrid may not be the one the handle was taken from.
+        //
+        SubGridType* FindSubgrid(SubgridHandle handle) const
+        {
+            if (handle >= m_positions.size() || m_positions[handle] >= m_subgrids.size())
+            {
+                return nullptr;
+            }
+
+            return m_subgrids[m_positions[handle]];
+        }
+
+        //
+        // Every handle handed out so far is below this, for sizing arrays
+        // indexed by handle.
+        //
+        size_t GetHandleCapacity() const { return m_positions.size(); }
+
+        size_t GetSize() const { return m_subgrids.size(); }
 
     private:
-        std::unordered_map<SubGrid::CoordinateType, SubGridPtr> m_subgridMap;
+        SubgridStorage(const SubgridStorage& other) = delete;
+        SubgridStorage& operator=(const SubgridStorage& other) = delete;
+
+        static const uint32_t CHUNK_SIZE_LOG2 = 6;
+        static const uint32_t CHUNK_SIZE = 1 << CHUNK_SIZE_LOG2;
+
+        //
+        // m_positions entries for slots which aren't in the dense array.
+        //
+        enum : uint32_t
+        {
+            POSITION_FREE     = 0xFFFFFFFF,
+            POSITION_UNLISTED = 0xFFFFFFFE
+        };
+
+        typedef typename std::aligned_storage<sizeof(SubGridType), alignof(SubGridType)>::type Slot;
+
+        //
+        // Drops the handles taken by Create() from the free list.
+        //
+        void CommitClaimedHandles();
+
+        std::vector<std::unique_ptr<Slot[]>> m_chunks;
+
+        //
+        // Where each handle's subgrid is in m_subgrids, or one of the
+        // POSITION_ values.
+        //
+        std::vector<uint32_t> m_positions;
+
+        //
+        // Free handles, handed out from the back. Create() takes them
+        // without touching the vector, by counting them in m_numClaimed.
+        //
+        std::vector<SubgridHandle> m_freeHandles;
+        std::atomic<size_t> m_numClaimed;
+
+        std::vector<SubGridType*> m_subgrids;
 
     public:
-        using iterator       = decltype(m_subgridMap)::iterator;
-        using const_iterator = decltype(m_subgridMap)::const_iterator;
+        typedef typename std::vector<SubGridType*>::iterator iterator;
+        typedef typename std::vector<SubGridType*>::const_iterator const_iterator;
 
-        iterator begin() { return m_subgridMap.begin(); }
-        iterator end()   { return m_subgridMap.end();   }
-        const_iterator begin() const { return m_subgridMap.begin(); }
-        const_iterator end()   const { return m_subgridMap.end();   }
+        iterator begin() { return m_subgrids.begin(); }
+        iterator end()   { return m_subgrids.end();   }
+        const_iterator begin() const { return m_subgrids.begin(); }
+        const_iterator end()   const { return m_subgrids.end();   }
     };
 }
-
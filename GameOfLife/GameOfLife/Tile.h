@@ -0,0 +1,76 @@
+#pragma once
+
+//
+// Types shared by every tile size, and a geometry-independent view of a
+// single tile for renderers.
+//
+
+#include "RectangularGrid.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace GameOfLife
+{
+    //
+    // Type for describing (x,y) world-space coordinates.
+    //
+    typedef std::pair<int64_t, int64_t> CoordinateType;
+
+    //
+    // Type for the vertex buffer ultimately used for rendering living
+    // cells within a tile.
+    //
+    struct VertexType
+    {
+        VertexType(int64_t x, int64_t y) :
+            X(static_cast<float>(x)), Y(static_cast<float>(y)) {}
+        float X;
+        float Y;
+    };
+
+    //
+    // How cells are stored in the cell grid buffers.
+    //
+    // BitPacked: each row of the padded grid, ghost cells included, lives
+    // in a single row word. Bit 0 holds the left ghost column and bit
+    // width + 1 holds the right ghost column.
+    //
+    // BytePerCell: one byte per cell, rows laid out contiguously. Larger
+    // and slower, but easy for external tools to inspect.
+    //
+    enum class CellLayout
+    {
+        BitPacked,
+        BytePerCell
+    };
+
+    //
+    // Read-only view of a rectangular region of living cells. Lets the
+    // renderers walk the state without knowing the tile dimensions it was
+    // compiled for.
+    //
+    class Tile : public RectangularGrid
+    {
+    public:
+        Tile(int64_t xMin, int64_t width, int64_t yMin, int64_t height)
+            : RectangularGrid(xMin, width, yMin, height)
+        {}
+
+        virtual ~Tile() {}
+
+        //
+        // x, y parameters are in world space.
+        //
+        virtual bool GetCellState(int64_t x, int64_t y) const = 0;
+
+        //
+        // Appends the coordinates of every living cell, relative to origin,
+        // to vertices, in row-major order. Nothing is kept between calls, so
+        // only extract the tiles actually being drawn or written out, once
+        // for each generation that is.
+        //
+        virtual void ExtractVertices(const CoordinateType& origin, std::vector<VertexType>& vertices) const = 0;
+    };
+}
@@ -0,0 +1,219 @@
+#pragma once
+
+//
+// Map from tile coordinates to tiles, for finding a subgrid's neighbors.
+//
+// Keys are the full coordinate pairs, so any tile in the int64 world can be
+// found. They're hashed with Utility::MixBits(), which spreads coordinates
+// that are all multiples of the tile size evenly over the table. Keys and
+// values sit side by side in one flat array probed linearly, so a lookup
+// usually touches a single cache line, and removal shifts later entries
+// back rather than leaving tombstones behind. The array is kept between
+// one eighth and four fifths full, shrinking as tiles are removed.
+//
+// Not thread safe, though any number of threads may look tiles up while
+// nothing is inserted or removed.
+//
+
+#include "Tile.h"
+
+#include <Utility/Hash.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+namespace GameOfLife
+{
+    template <typename T, int64_t TileWidth, int64_t TileHeight>
+    class TileLookup
+    {
+    public:
+        TileLookup() : m_numSlots(0), m_size(0) {}
+
+        //
+        // Returns the tile at coordinates, or null if there isn't one.
+        //
+        T* Find(const CoordinateType& coordinates) const
+        {
+            if (!m_size)
+            {
+                return nullptr;
+            }
+
+            const size_t Mask = m_numSlots - 1;
+            for (size_t index = GetHomeSlot(coordinates); ; index = (index + 1) & Mask)
+            {
+                const Slot& slot = m_spSlots[index];
+                if (!slot.pValue)
+                {
+                    return nullptr;
+                }
+
+                if (slot.Key == coordinates)
+                {
+                    return slot.pValue;
+                }
+            }
+        }
+
+        //
+        // Adds pValue at coordinates. Returns false, changing nothing, if
+        // there's already a tile there.
+        //
+        bool Insert(const CoordinateType& coordinates, T* pValue)
+        {
+            assert(pValue);
+
+            //
+            // Linear probing stays short up to a load factor of about 0.8, and
+            // running fuller than a half keeps the table smaller than the map
+            // it replaced.
+            //
+            if ((m_size + 1) * 5 > m_numSlots * 4)
+            {
+                Rehash(m_numSlots ? m_numSlots * 2 : MIN_SLOTS);
+            }
+
+            const size_t Mask = m_numSlots - 1;
+            for (size_t index = GetHomeSlot(coordinates); ; index = (index + 1) & Mask)
+            {
+                Slot& slot = m_spSlots[index];
+                if (!slot.pValue)
+                {
+                    slot.Key = coordinates;
+                    slot.pValue = pValue;
+                    m_size++;
+                    return true;
+                }
+
+                if (slot.Key == coordinates)
+                {
+                    return false;
+                }
+            }
+        }
+
+        //
+        // Removes the tile at coordinates. Returns false if there wasn't one.
+        //
+        bool Erase(const CoordinateType& coordinates)
+        {
+            if (!m_size)
+            {
+                return false;
+            }
+
+            const size_t Mask = m_numSlots - 1;
+
+            size_t hole = GetHomeSlot(coordinates);
+            for (; ; hole = (hole + 1) & Mask)
+            {
+                if (!m_spSlots[hole].pValue)
+                {
+                    return false;
+                }
+
+                if (m_spSlots[hole].Key == coordinates)
+                {
+                    break;
+                }
+            }
+
+            //
+            // Shift back every later entry of the run which would otherwise
+            // no longer be reachable from its home slot.
+            //
+            for (size_t index = (hole + 1) & Mask; m_spSlots[index].pValue; index = (index + 1) & Mask)
+            {
+                const size_t Home = GetHomeSlot(m_spSlots[index].Key);
+                if (((index - Home) & Mask) >= ((index - hole) & Mask))
+                {
+                    m_spSlots[hole] = m_spSlots[index];
+                    hole = index;
+                }
+            }
+
+            m_spSlots[hole].pValue = nullptr;
+            m_size--;
+
+            //
+            // Give memory back once most tiles are gone, e.g. after a soup
+            // dies down. A quarter of the slots leaves the table at most half
+            // full, well short of growing again.
+            //
+            if (m_numSlots > MIN_SLOTS && m_size < m_numSlots / 8)
+            {
+                Rehash(std::max(m_numSlots / 4, size_t(MIN_SLOTS)));
+            }
+
+            return true;
+        }
+
+        size_t GetSize() const { return m_size; }
+
+        //
+        // Bytes taken up by the table itself.
+        //
+        size_t GetMemoryUsage() const { return m_numSlots * sizeof(Slot); }
+
+    private:
+        TileLookup(const TileLookup& other) = delete;
+        TileLookup& operator=(const TileLookup& other) = delete;
+
+        static const size_t MIN_SLOTS = 64;
+
+        struct Slot
+        {
+            CoordinateType Key;
+            T*             pValue;
+        };
+
+        size_t GetHomeSlot(const CoordinateType& coordinates) const
+        {
+            assert(!(coordinates.first % TileWidth) && !(coordinates.second % TileHeight));
+
+            const uint64_t Hash = Utility::MixBits(
+                static_cast<uint64_t>(coordinates.first) ^
+                Utility::MixBits(static_cast<uint64_t>(coordinates.second))
+                );
+            return static_cast<size_t>(Hash) & (m_numSlots - 1);
+        }
+
+        void Rehash(size_t numSlots)
+        {
+            std::unique_ptr<Slot[]> spOldSlots(new Slot[numSlots]);
+            spOldSlots.swap(m_spSlots);
+            const size_t NumOldSlots = m_numSlots;
+            m_numSlots = numSlots;
+
+            for (size_t i = 0; i < m_numSlots; i++)
+            {
+                m_spSlots[i].pValue = nullptr;
+            }
+
+            const size_t Mask = m_numSlots - 1;
+            for (size_t i = 0; i < NumOldSlots; i++)
+            {
+                const Slot& OldSlot = spOldSlots[i];
+                if (!OldSlot.pValue)
+                {
+                    continue;
+                }
+
+                size_t index = GetHomeSlot(OldSlot.Key);
+                while (m_spSlots[index].pValue)
+                {
+                    index = (index + 1) & Mask;
+                }
+
+                m_spSlots[index] = OldSlot;
+            }
+        }
+
+        std::unique_ptr<Slot[]> m_spSlots;
+        size_t                  m_numSlots;
+        size_t                  m_size;
+    };
+}
@@ -1,10 +1,48 @@
 #pragma once
 
+//
+// Fixed-size sublocks aligned on an N-byte boundary, carved out of larger
+// superblocks.
+//
+// Superblocks are mapped straight from the OS, optionally on huge pages so
+// a large world's cell grids take fewer TLB entries. Whether that cuts TLB
+// misses is unmeasured, so it's off by default; the halo benchmark counts
+// them with --hugepages=1 where the OS exposes the counters.
+//
+// Superblocks are aligned on their own size, a power of two, so the
+// superblock holding a sublock is found by masking off the low bits of its
+// address. Each starts with a header tracking its sublocks; free sublocks
+// are chained through their own first bytes. Allocating and freeing are
+// therefore constant time however many sublocks are in use.
+//
+// Superblocks with room to spare are kept in a list, the ones which are
+// entirely free at the back so they're the last to be handed out. Up to a
+// configurable number of entirely free superblocks are held on to rather
+// than unmapped straight away, so a workload hovering around a superblock
+// boundary doesn't keep mapping and unmapping the same one. Their memory is
+// still handed back to the OS, just not their address range.
+//
+// Each thread also keeps a small cache of sublocks in front of the shared
+// superblocks, so threads creating and retiring tiles at the same time only
+// take the pool's lock once per batch of sublocks. A thread whose cache runs
+// dry refills half of it in one go, and one whose cache fills up flushes the
+// older half back. Cached sublocks count as in use as far as their
+// superblocks are concerned, until the pool is destroyed.
+//
+
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <list>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
 #include <vector>
 
+#include "PageMemory.h"
+
 namespace Utility
 {
     template <size_t N>
@@ -12,167 +50,577 @@ namespace Utility
     {
     private:
         //
-        // Contains a chunk of sub-blocks, allocated on the N-boundary.
+        // Header at the start of every superblock, followed by its sublocks
+        // from the next N-byte boundary on.
         //
         struct SuperBlock
         {
             //
-            // Pointer to the actual base of this block.
+            // The pool which owns it, to catch buffers freed to the wrong
+            // pool.
             //
-            uint8_t* pBase;
+            AlignedMemoryPool* pPool;
 
             //
-            // Pointer to the aligned base.
+            // Every superblock is in the list of all superblocks; those with
+            // free sublocks are also in the available list.
             //
-            uint8_t* pAligned;
+            SuperBlock* pPrev;
+            SuperBlock* pNext;
+            SuperBlock* pPrevAvailable;
+            SuperBlock* pNextAvailable;
+            bool IsAvailable;
 
             //
-            // For auto-cleanup on aligned buffer removal.
+            // Freed sublocks, most recently freed first. Sublocks past
+            // NumCarved have never been handed out and aren't on the list.
             //
-            size_t Refcount;
+            uint8_t* pFreeList;
+            size_t NumCarved;
+            size_t NumUsed;
         };
 
-        std::vector<SuperBlock> m_superblocks;
+        //
+        // A thread's cache of sublocks, most recently freed last. Only the
+        // owning thread touches Sublocks; the counters are atomic so they can
+        // be summed up from any thread.
+        //
+        struct ThreadCache
+        {
+            std::thread::id       Owner;
+            std::vector<uint8_t*> Sublocks;
+            std::atomic<uint64_t> Hits;
+            std::atomic<uint64_t> Refills;
+            std::atomic<uint64_t> Flushes;
+        };
 
-        typedef typename std::vector<SuperBlock>::iterator SuperblockIterator;
+        //
+        // The cache the current thread used last, and the pool it belongs
+        // to. Pools are told apart by an id which is never reused, rather
+        // than their address, in case a pool is destroyed and another one
+        // created in its place.
+        //
+        struct CacheLookup
+        {
+            uint64_t     PoolId;
+            ThreadCache* pCache;
+        };
+
+        static const size_t HEADER_SIZE = (sizeof(SuperBlock) + N - 1) & ~(N - 1);
+
+        static_assert(!(N & (N - 1)), "Alignment must be a power of two.");
+        static_assert(N >= sizeof(uint8_t*), "Free sublocks must be able to hold a pointer.");
 
     public:
         AlignedMemoryPool() = default;
 
-        AlignedMemoryPool(size_t sublockSize, size_t superblockLength)
+        //
+        // Each superblock holds at least superblockLength sublocks, rounded
+        // up to fill its power-of-two size, which is at least a page, or a
+        // huge page with useHugePages. Up to maxEmptySuperblocks entirely
+        // free superblocks are kept around for reuse. Each thread caches up
+        // to cacheLength sublocks; zero turns caching off.
+        //
+        AlignedMemoryPool(
+            size_t sublockSize,
+            size_t superblockLength,
+            size_t maxEmptySuperblocks = 2,
+            size_t cacheLength = 16,
+            bool useHugePages = false
+            )
             : m_sublockSize(sublockSize),
-              m_sublocksPerSuperblock(superblockLength),
-              m_length(m_sublockSize * m_sublocksPerSuperblock)
+              m_maxEmptySuperblocks(maxEmptySuperblocks),
+              m_cacheLength(cacheLength),
+              m_cacheBatch(cacheLength > 1 ? cacheLength / 2 : cacheLength),
+              m_useHugePages(useHugePages),
+              m_id(GetNextPoolId()++),
+              m_pSuperblocks(nullptr),
+              m_pAvailableFront(nullptr),
+              m_pAvailableBack(nullptr),
+              m_numSuperblocks(0),
+              m_numEmptySuperblocks(0)
         {
             if (sublockSize % N)
             {
                 throw "Sublock size must be a multiple of alignment.";
             }
+
+            m_superblockSize = GetPageSize();
+            if (useHugePages)
+            {
+                m_superblockSize = std::max(m_superblockSize, GetHugePageSize());
+            }
+
+            while (m_superblockSize < HEADER_SIZE + sublockSize * superblockLength)
+            {
+                m_superblockSize *= 2;
+            }
+
+            m_sublocksPerSuperblock = (m_superblockSize - HEADER_SIZE) / sublockSize;
         }
 
         ~AlignedMemoryPool()
         {
-            for (auto& superblock : m_superblocks)
+            for (const std::unique_ptr<ThreadCache>& spCache : m_caches)
             {
-                delete[] superblock.pBase;
-                assert(superblock.Refcount == 0);
+                for (uint8_t* pSublock : spCache->Sublocks)
+                {
+                    FreeLocked(pSublock);
+                }
+            }
+
+            while (m_pSuperblocks)
+            {
+                SuperBlock* pSuperblock = m_pSuperblocks;
+                m_pSuperblocks = pSuperblock->pNext;
+
+                assert(pSuperblock->NumUsed == 0);
+                UnmapPages(pSuperblock, m_superblockSize);
             }
         }
 
+        //
+        // Allocate() and Free() may be called from several threads at once.
+        // Sublocks come back zeroed.
+        //
         uint8_t* Allocate()
         {
-            SuperblockIterator superIt;
-            uint8_t* pAligned = nullptr;
-            if (m_freeBuffers.empty())
+            uint8_t* pSublock;
+
+            ThreadCache* pCache = GetThreadCache();
+            if (pCache)
             {
-                superIt = AllocateSuperblock();
-                pAligned = m_freeBuffers.back();
+                if (pCache->Sublocks.empty())
+                {
+                    Refill(*pCache);
+                }
+                else
+                {
+                    Increment(pCache->Hits);
+                }
+
+                pSublock = pCache->Sublocks.back();
+                pCache->Sublocks.pop_back();
             }
             else
             {
-                pAligned = m_freeBuffers.back();
-                superIt = FindParentSuperblock(pAligned);
+                std::lock_guard<std::mutex> lock(m_mutex);
+                pSublock = AllocateLocked();
             }
-            assert(!(reinterpret_cast<size_t>(pAligned) & (N - 1)));
-
-            m_freeBuffers.pop_back();
-            m_usedBuffers.push_back(pAligned);
-            assert(superIt != m_superblocks.end());
-            superIt->Refcount++;
 
-            memset(pAligned, 0, m_sublockSize);
+            assert(!(reinterpret_cast<size_t>(pSublock) & (N - 1)));
+            memset(pSublock, 0, m_sublockSize);
 
-            return pAligned;
+            return pSublock;
         }
 
         void Free(uint8_t* pBuffer)
         {
-            auto usedIt = std::find(m_usedBuffers.begin(), m_usedBuffers.end(), pBuffer);
-            if (usedIt == m_usedBuffers.end())
+            SuperBlock* pSuperblock = GetSuperblock(pBuffer);
+            if (pSuperblock->pPool != this)
             {
-                throw "Buffer to free could not be found in used list.";
+                throw "Buffer to free was not allocated from this pool.";
             }
 
-            m_usedBuffers.erase(usedIt);
-            m_freeBuffers.push_back(pBuffer);
+            assert(!((pBuffer - GetFirstSublock(pSuperblock)) % m_sublockSize));
 
-            auto superIt = FindParentSuperblock(pBuffer);
-            assert(superIt != m_superblocks.end());
-            assert(superIt->Refcount > 0);
-
-            superIt->Refcount--;
-            if (!superIt->Refcount && m_superblocks.size() > 1)
+            ThreadCache* pCache = GetThreadCache();
+            if (pCache)
             {
-                auto it = m_freeBuffers.begin();
-                while (it != m_freeBuffers.end())
+                if (pCache->Sublocks.size() >= m_cacheLength)
                 {
-                    auto prev = it;
-                    if (*it >= superIt->pAligned && *it <= superIt->pAligned + m_length)
-                    {
-                        ++it;
-                        m_freeBuffers.erase(prev);
-                    }
-                    else
-                    {
-                        ++it;
-                    }
+                    Flush(*pCache);
                 }
-                m_superblocks.erase(superIt);
+
+                pCache->Sublocks.push_back(pBuffer);
+                return;
             }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            FreeLocked(pBuffer);
         }
 
+        size_t GetSuperblockCount() const { return m_numSuperblocks; }
+
+        size_t GetSublocksPerSuperblock() const { return m_sublocksPerSuperblock; }
+
+        //
+        // Totals over every thread's cache: allocations served straight from
+        // a cache, and the batches refilled from and flushed back to the
+        // shared superblocks.
+        //
+        uint64_t GetCacheHits() const { return SumCounters(&ThreadCache::Hits); }
+        uint64_t GetCacheRefills() const { return SumCounters(&ThreadCache::Refills); }
+        uint64_t GetCacheFlushes() const { return SumCounters(&ThreadCache::Flushes); }
+
     private:
-        SuperblockIterator FindParentSuperblock(uint8_t* pAligned)
+        AlignedMemoryPool(const AlignedMemoryPool& other) = delete;
+        AlignedMemoryPool& operator=(const AlignedMemoryPool& other) = delete;
+
+        static std::atomic<uint64_t>& GetNextPoolId()
+        {
+            static std::atomic<uint64_t> nextPoolId(1);
+            return nextPoolId;
+        }
+
+        static CacheLookup& GetCacheLookup()
+        {
+            static thread_local CacheLookup lookup = { 0, nullptr };
+            return lookup;
+        }
+
+        static void Increment(std::atomic<uint64_t>& counter)
+        {
+            counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        uint64_t SumCounters(std::atomic<uint64_t> ThreadCache::* pCounter) const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            uint64_t total = 0;
+            for (const std::unique_ptr<ThreadCache>& spCache : m_caches)
+            {
+                total += ((*spCache).*pCounter).load(std::memory_order_relaxed);
+            }
+
+            return total;
+        }
+
+        //
+        // Returns the calling thread's cache, creating it the first time the
+        // thread uses this pool, or null if caching is off.
+        //
+        ThreadCache* GetThreadCache()
+        {
+            if (!m_cacheLength)
+            {
+                return nullptr;
+            }
+
+            CacheLookup& lookup = GetCacheLookup();
+            if (lookup.PoolId == m_id)
+            {
+                return lookup.pCache;
+            }
+
+            const std::thread::id ThreadId = std::this_thread::get_id();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            ThreadCache* pCache = nullptr;
+            for (const std::unique_ptr<ThreadCache>& spCache : m_caches)
+            {
+                if (spCache->Owner == ThreadId)
+                {
+                    pCache = spCache.get();
+                    break;
+                }
+            }
+
+            if (!pCache)
+            {
+                std::unique_ptr<ThreadCache> spCache(new ThreadCache());
+                spCache->Owner = ThreadId;
+                spCache->Sublocks.reserve(m_cacheLength);
+                spCache->Hits.store(0);
+                spCache->Refills.store(0);
+                spCache->Flushes.store(0);
+
+                pCache = spCache.get();
+                m_caches.push_back(std::move(spCache));
+            }
+
+            lookup.PoolId = m_id;
+            lookup.pCache = pCache;
+
+            return pCache;
+        }
+
+        //
+        // Takes a batch of sublocks for an empty cache under a single lock.
+        // Running out of memory part way through is only an error if not
+        // even one sublock could be had.
+        //
+        void Refill(ThreadCache& cache)
+        {
+            assert(cache.Sublocks.empty());
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            try
+            {
+                while (cache.Sublocks.size() < m_cacheBatch)
+                {
+                    cache.Sublocks.push_back(AllocateLocked());
+                }
+            }
+            catch (...)
+            {
+                if (cache.Sublocks.empty())
+                {
+                    throw;
+                }
+            }
+
+            Increment(cache.Refills);
+        }
+
+        //
+        // Returns the least recently freed batch of a full cache under a
+        // single lock, keeping the ones most likely still in the CPU cache.
+        //
+        void Flush(ThreadCache& cache)
+        {
+            const size_t Count = std::min(m_cacheBatch, cache.Sublocks.size());
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (size_t i = 0; i < Count; i++)
+                {
+                    FreeLocked(cache.Sublocks[i]);
+                }
+            }
+
+            cache.Sublocks.erase(cache.Sublocks.begin(), cache.Sublocks.begin() + Count);
+            Increment(cache.Flushes);
+        }
+
+        //
+        // Allocate() and Free() on the shared superblocks, with m_mutex held.
+        //
+        uint8_t* AllocateLocked()
         {
-            return
-                std::find_if(
-                    m_superblocks.begin(),
-                    m_superblocks.end(),
-                    [pAligned, this](const SuperBlock& superblock)
-                    {
-                        return pAligned >= superblock.pAligned &&
-                               pAligned <  superblock.pAligned + m_length;
-                    });
+            SuperBlock* pSuperblock = m_pAvailableFront;
+            if (!pSuperblock)
+            {
+                pSuperblock = AllocateSuperblock();
+            }
+
+            uint8_t* pSublock;
+            if (pSuperblock->pFreeList)
+            {
+                pSublock = pSuperblock->pFreeList;
+                memcpy(&pSuperblock->pFreeList, pSublock, sizeof(uint8_t*));
+            }
+            else
+            {
+                assert(pSuperblock->NumCarved < m_sublocksPerSuperblock);
+                pSublock = GetFirstSublock(pSuperblock) + m_sublockSize * pSuperblock->NumCarved++;
+            }
+
+            if (!pSuperblock->NumUsed++)
+            {
+                m_numEmptySuperblocks--;
+            }
+
+            if (pSuperblock->NumUsed == m_sublocksPerSuperblock)
+            {
+                RemoveAvailable(pSuperblock);
+            }
+
+            return pSublock;
         }
 
-        SuperblockIterator AllocateSuperblock()
+        void FreeLocked(uint8_t* pBuffer)
         {
+            SuperBlock* pSuperblock = GetSuperblock(pBuffer);
+
+            assert(pSuperblock->NumUsed > 0);
+
+            memcpy(pBuffer, &pSuperblock->pFreeList, sizeof(uint8_t*));
+            pSuperblock->pFreeList = pBuffer;
+
+            if (!pSuperblock->IsAvailable)
+            {
+                PushAvailableFront(pSuperblock);
+            }
+
+            if (--pSuperblock->NumUsed)
+            {
+                return;
+            }
+
             //
-            // What to do in OOM?
+            // Hand out the sublocks of partly used superblocks first, so
+            // empty ones stay empty and can be released.
             //
-            uint8_t* pSuperblock = new uint8_t[m_length + (N - 1)];
-            memset(pSuperblock, 0, m_length + (N - 1));
+            if (m_numEmptySuperblocks < m_maxEmptySuperblocks)
+            {
+                DiscardSublocks(pSuperblock);
+                m_numEmptySuperblocks++;
+                RemoveAvailable(pSuperblock);
+                PushAvailableBack(pSuperblock);
+                return;
+            }
+
+            ReleaseSuperblock(pSuperblock);
+        }
+
+        SuperBlock* GetSuperblock(uint8_t* pSublock) const
+        {
+            return reinterpret_cast<SuperBlock*>(
+                reinterpret_cast<size_t>(pSublock) & ~(m_superblockSize - 1)
+                );
+        }
+
+        static uint8_t* GetFirstSublock(SuperBlock* pSuperblock)
+        {
+            return reinterpret_cast<uint8_t*>(pSuperblock) + HEADER_SIZE;
+        }
+
+        SuperBlock* AllocateSuperblock()
+        {
+            //
+            // Only the header is written here; the OS backs sublocks with
+            // memory as they're first handed out.
+            //
+            void* pPages = MapPages(m_superblockSize, m_superblockSize, m_useHugePages);
+            if (!pPages)
+            {
+                throw std::bad_alloc();
+            }
+
+            SuperBlock* pSuperblock = static_cast<SuperBlock*>(pPages);
+            pSuperblock->pPool = this;
+            pSuperblock->pFreeList = nullptr;
+            pSuperblock->NumCarved = 0;
+            pSuperblock->NumUsed = 0;
+            pSuperblock->IsAvailable = false;
+            pSuperblock->pPrevAvailable = nullptr;
+            pSuperblock->pNextAvailable = nullptr;
+
+            pSuperblock->pPrev = nullptr;
+            pSuperblock->pNext = m_pSuperblocks;
+            if (m_pSuperblocks)
+            {
+                m_pSuperblocks->pPrev = pSuperblock;
+            }
+            m_pSuperblocks = pSuperblock;
+
+            m_numSuperblocks++;
+            m_numEmptySuperblocks++;
+            PushAvailableFront(pSuperblock);
+
+            return pSuperblock;
+        }
+
+        void ReleaseSuperblock(SuperBlock* pSuperblock)
+        {
+            assert(!pSuperblock->NumUsed);
+
+            RemoveAvailable(pSuperblock);
+
+            if (pSuperblock->pPrev)
+            {
+                pSuperblock->pPrev->pNext = pSuperblock->pNext;
+            }
+            else
+            {
+                m_pSuperblocks = pSuperblock->pNext;
+            }
 
-            size_t base = reinterpret_cast<size_t>(pSuperblock);
-            if (base & (N - 1))
+            if (pSuperblock->pNext)
             {
-                base &= ~(N - 1);
-                base += N;
+                pSuperblock->pNext->pPrev = pSuperblock->pPrev;
             }
 
-            uint8_t* pAligned = reinterpret_cast<uint8_t*>(base);
-            assert(!(base & (N - 1)));
-            assert(pAligned >= pSuperblock);
-            assert(pSuperblock + N >= pAligned);
+            m_numSuperblocks--;
+            UnmapPages(pSuperblock, m_superblockSize);
+        }
 
-            uint8_t* pSublock = pAligned;
-            for (size_t i = 0; i < m_sublocksPerSuperblock; ++i)
+        //
+        // Gives the memory behind an empty superblock's sublocks back to the
+        // OS while keeping it mapped. Their free list goes with it, so they
+        // start over as never carved.
+        //
+        void DiscardSublocks(SuperBlock* pSuperblock)
+        {
+            assert(!pSuperblock->NumUsed);
+
+            DiscardPages(GetFirstSublock(pSuperblock), m_superblockSize - HEADER_SIZE);
+            pSuperblock->pFreeList = nullptr;
+            pSuperblock->NumCarved = 0;
+        }
+
+        void PushAvailableFront(SuperBlock* pSuperblock)
+        {
+            assert(!pSuperblock->IsAvailable);
+
+            pSuperblock->IsAvailable = true;
+            pSuperblock->pPrevAvailable = nullptr;
+            pSuperblock->pNextAvailable = m_pAvailableFront;
+            if (m_pAvailableFront)
+            {
+                m_pAvailableFront->pPrevAvailable = pSuperblock;
+            }
+            else
             {
-                m_freeBuffers.push_back(pSublock);
-                pSublock += m_sublockSize;
+                m_pAvailableBack = pSuperblock;
             }
+            m_pAvailableFront = pSuperblock;
+        }
 
-            m_superblocks.push_back({ pSuperblock, pAligned, 0 });
+        void PushAvailableBack(SuperBlock* pSuperblock)
+        {
+            assert(!pSuperblock->IsAvailable);
 
-            assert(!m_superblocks.empty());
-            return m_superblocks.end() - 1;
+            pSuperblock->IsAvailable = true;
+            pSuperblock->pNextAvailable = nullptr;
+            pSuperblock->pPrevAvailable = m_pAvailableBack;
+            if (m_pAvailableBack)
+            {
+                m_pAvailableBack->pNextAvailable = pSuperblock;
+            }
+            else
+            {
+                m_pAvailableFront = pSuperblock;
+            }
+            m_pAvailableBack = pSuperblock;
         }
 
-        std::list<uint8_t*> m_freeBuffers;
-        std::list<uint8_t*> m_usedBuffers;
+        void RemoveAvailable(SuperBlock* pSuperblock)
+        {
+            assert(pSuperblock->IsAvailable);
+
+            if (pSuperblock->pPrevAvailable)
+            {
+                pSuperblock->pPrevAvailable->pNextAvailable = pSuperblock->pNextAvailable;
+            }
+            else
+            {
+                m_pAvailableFront = pSuperblock->pNextAvailable;
+            }
+
+            if (pSuperblock->pNextAvailable)
+            {
+                pSuperblock->pNextAvailable->pPrevAvailable = pSuperblock->pPrevAvailable;
+            }
+            else
+            {
+                m_pAvailableBack = pSuperblock->pPrevAvailable;
+            }
+
+            pSuperblock->IsAvailable = false;
+            pSuperblock->pPrevAvailable = nullptr;
+            pSuperblock->pNextAvailable = nullptr;
+        }
 
         size_t m_sublockSize;
-        size_t m_sublocksPerSuperblock;;
-        size_t m_length;
+        size_t m_sublocksPerSuperblock;
+        size_t m_superblockSize;
+        size_t m_maxEmptySuperblocks;
+        size_t m_cacheLength;
+        size_t m_cacheBatch;
+        bool m_useHugePages;
+        uint64_t m_id;
+
+        SuperBlock* m_pSuperblocks;
+        SuperBlock* m_pAvailableFront;
+        SuperBlock* m_pAvailableBack;
+        size_t m_numSuperblocks;
+        size_t m_numEmptySuperblocks;
+
+        std::vector<std::unique_ptr<ThreadCache>> m_caches;
+
+        mutable std::mutex m_mutex;
     };
 }
@@ -0,0 +1,184 @@
+#pragma once
+
+//
+// Bit-twiddling helpers. Thin wrappers around compiler intrinsics so that
+// the cell kernels can stay portable.
+//
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Utility
+{
+    //
+    // Number of set bits in value.
+    //
+    inline uint32_t PopCount(uint32_t value)
+    {
+#if defined(_MSC_VER)
+        return static_cast<uint32_t>(__popcnt(value));
+#else
+        return static_cast<uint32_t>(__builtin_popcount(value));
+#endif
+    }
+
+    inline uint32_t PopCount(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<uint32_t>(__popcnt64(value));
+#elif defined(_MSC_VER)
+        return PopCount(static_cast<uint32_t>(value)) +
+               PopCount(static_cast<uint32_t>(value >> 32));
+#else
+        return static_cast<uint32_t>(__builtin_popcountll(value));
+#endif
+    }
+
+    //
+    // Index of the least significant set bit. Undefined for zero, so callers
+    // must check first.
+    //
+    inline uint32_t CountTrailingZeros(uint32_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<uint32_t>(index);
+#else
+        return static_cast<uint32_t>(__builtin_ctz(value));
+#endif
+    }
+
+    inline uint32_t CountTrailingZeros(uint64_t value)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<uint32_t>(index);
+#elif defined(_MSC_VER)
+        const uint32_t Low = static_cast<uint32_t>(value);
+        return Low ? CountTrailingZeros(Low) :
+                     32 + CountTrailingZeros(static_cast<uint32_t>(value >> 32));
+#else
+        return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+    }
+
+    //
+    // Minimal 128-bit unsigned integer supporting just the operations the
+    // bit-packed cell kernels need. Lets the widest subgrids keep a whole
+    // padded row in a single value.
+    //
+    struct UInt128
+    {
+        uint64_t Low;
+        uint64_t High;
+
+        UInt128() : Low(0), High(0) {}
+        UInt128(uint64_t low) : Low(low), High(0) {}
+        UInt128(uint64_t low, uint64_t high) : Low(low), High(high) {}
+
+        explicit operator bool() const { return !!(Low | High); }
+
+        UInt128 operator~() const { return UInt128(~Low, ~High); }
+
+        UInt128 operator&(const UInt128& other) const { return UInt128(Low & other.Low, High & other.High); }
+        UInt128 operator|(const UInt128& other) const { return UInt128(Low | other.Low, High | other.High); }
+        UInt128 operator^(const UInt128& other) const { return UInt128(Low ^ other.Low, High ^ other.High); }
+
+        UInt128& operator&=(const UInt128& other) { Low &= other.Low; High &= other.High; return *this; }
+        UInt128& operator|=(const UInt128& other) { Low |= other.Low; High |= other.High; return *this; }
+        UInt128& operator^=(const UInt128& other) { Low ^= other.Low; High ^= other.High; return *this; }
+
+        bool operator==(const UInt128& other) const { return Low == other.Low && High == other.High; }
+        bool operator!=(const UInt128& other) const { return !(*this == other); }
+
+        UInt128 operator<<(uint32_t shift) const
+        {
+            if (!shift)      { return *this; }
+            if (shift >= 64) { return UInt128(0, Low << (shift - 64)); }
+            return UInt128(Low << shift, (High << shift) | (Low >> (64 - shift)));
+        }
+
+        UInt128 operator>>(uint32_t shift) const
+        {
+            if (!shift)      { return *this; }
+            if (shift >= 64) { return UInt128(High >> (shift - 64), 0); }
+            return UInt128((Low >> shift) | (High << (64 - shift)), High >> shift);
+        }
+    };
+
+    inline uint32_t PopCount(const UInt128& value)
+    {
+        return PopCount(value.Low) + PopCount(value.High);
+    }
+
+    inline uint32_t CountTrailingZeros(const UInt128& value)
+    {
+        return value.Low ? CountTrailingZeros(value.Low) :
+                           64 + CountTrailingZeros(value.High);
+    }
+
+    //
+    // Clears the least significant set bit, for walking the set bits of a
+    // mask from lowest to highest.
+    //
+    inline uint32_t ClearLowestSetBit(uint32_t value) { return value & (value - 1); }
+    inline uint64_t ClearLowestSetBit(uint64_t value) { return value & (value - 1); }
+    inline UInt128 ClearLowestSetBit(const UInt128& value)
+    {
+        return value.Low ? UInt128(value.Low & (value.Low - 1), value.High) :
+                           UInt128(0, value.High & (value.High - 1));
+    }
+
+    //
+    // The least significant 32 bits of value.
+    //
+    inline uint32_t LowWord(uint32_t value) { return value; }
+    inline uint32_t LowWord(uint64_t value) { return static_cast<uint32_t>(value); }
+    inline uint32_t LowWord(const UInt128& value) { return static_cast<uint32_t>(value.Low); }
+
+    template <typename T>
+    bool TestBit(const T& value, uint32_t bit)
+    {
+        return !!((value >> bit) & T(1));
+    }
+
+    //
+    // Position of (x, y) along a Hilbert curve through the 2^32 by 2^32
+    // grid. Consecutive positions are always adjacent points, and every
+    // aligned square of 2^k by 2^k points is visited in one go.
+    //
+    inline uint64_t GetHilbertIndex(uint32_t x, uint32_t y)
+    {
+        uint64_t index = 0;
+        for (uint32_t half = 1u << 31; half; half >>= 1)
+        {
+            const uint32_t QuadrantX = (x & half) ? 1 : 0;
+            const uint32_t QuadrantY = (y & half) ? 1 : 0;
+            index += static_cast<uint64_t>(half) * half * ((3 * QuadrantX) ^ QuadrantY);
+
+            //
+            // Rotate the quadrant so the curve within it starts and ends
+            // where the curve through the whole square needs it to.
+            //
+            if (!QuadrantY)
+            {
+                if (QuadrantX)
+                {
+                    x = ~x;
+                    y = ~y;
+                }
+
+                const uint32_t Swap = x;
+                x = y;
+                y = Swap;
+            }
+        }
+
+        return index;
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+//
+// Runtime CPU feature detection, for picking between vectorized code
+// paths.
+//
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
+namespace Utility
+{
+    namespace Detail
+    {
+        inline void CpuId(int leaf, int subleaf, int (&registers)[4])
+        {
+#if defined(_MSC_VER)
+            __cpuidex(registers, leaf, subleaf);
+#elif defined(__GNUC__)
+            unsigned int a = 0, b = 0, c = 0, d = 0;
+            __cpuid_count(leaf, subleaf, a, b, c, d);
+            registers[0] = static_cast<int>(a);
+            registers[1] = static_cast<int>(b);
+            registers[2] = static_cast<int>(c);
+            registers[3] = static_cast<int>(d);
+#else
+            registers[0] = registers[1] = registers[2] = registers[3] = 0;
+#endif
+        }
+
+        //
+        // Reads the extended control register, which tells us whether the
+        // OS saves the upper halves of the YMM registers on context switch.
+        //
+        inline unsigned long long ReadXcr0()
+        {
+#if defined(_MSC_VER)
+            return _xgetbv(0);
+#elif defined(__GNUC__)
+            unsigned int eax, edx;
+            __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+            return (static_cast<unsigned long long>(edx) << 32) | eax;
+#else
+            return 0;
+#endif
+        }
+    }
+
+    inline bool CpuHasSSE2()
+    {
+        int registers[4];
+        Detail::CpuId(1, 0, registers);
+        return !!(registers[3] & (1 << 26));
+    }
+
+    inline bool CpuHasAVX2()
+    {
+        int registers[4];
+        Detail::CpuId(0, 0, registers);
+        if (registers[0] < 7)
+        {
+            return false;
+        }
+
+        //
+        // AVX2 is only usable if the OS has enabled AVX state saving
+        // (OSXSAVE + XCR0 bits 1 and 2).
+        //
+        Detail::CpuId(1, 0, registers);
+        const bool HasOsxsave = !!(registers[2] & (1 << 27));
+        const bool HasAvx     = !!(registers[2] & (1 << 28));
+        if (!HasOsxsave || !HasAvx || (Detail::ReadXcr0() & 0x6) != 0x6)
+        {
+            return false;
+        }
+
+        Detail::CpuId(7, 0, registers);
+        return !!(registers[1] & (1 << 5));
+    }
+}
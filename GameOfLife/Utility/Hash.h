@@ -4,6 +4,7 @@
 // Hashing utility functions.
 //
 
+#include <cstdint>
 #include <functional>
 
 namespace Utility
@@ -31,4 +32,21 @@ namespace Utility
         hash_combine(seed, v.second);
         return seed;
     }
+
+    //
+    // Scrambles every bit of value into every bit of the result; the
+    // finalizer from SplitMix64. Unlike std::hash on integers, which is
+    // usually the identity, it's safe to take the low bits of the result
+    // as a table index even when the inputs are all multiples of some
+    // stride.
+    //
+    inline uint64_t MixBits(uint64_t value)
+    {
+        value ^= value >> 30;
+        value *= 0xbf58476d1ce4e5b9ull;
+        value ^= value >> 27;
+        value *= 0x94d049bb133111ebull;
+        value ^= value >> 31;
+        return value;
+    }
 }
@@ -0,0 +1,208 @@
+#include "PageMemory.h"
+
+#include <cstdint>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    uintptr_t AlignUp(uintptr_t address, size_t alignment)
+    {
+        return (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+    }
+
+#if defined(_WIN32)
+    //
+    // Large pages must be committed up front, need the lock pages in memory
+    // privilege, and come back aligned on the large page size.
+    //
+    void* MapLargePages(size_t size, size_t alignment)
+    {
+        const size_t LargePageSize = Utility::GetHugePageSize();
+        if (!LargePageSize || size % LargePageSize || alignment > LargePageSize)
+        {
+            return nullptr;
+        }
+
+        return VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+#else
+    //
+    // Explicit huge pages come from a pool the administrator sets aside, and
+    // are naturally aligned on their size.
+    //
+    void* MapHugeTlbPages(size_t size, size_t alignment)
+    {
+#if defined(MAP_HUGETLB)
+        const size_t HugePageSize = Utility::GetHugePageSize();
+        if (!HugePageSize || size % HugePageSize || alignment > HugePageSize)
+        {
+            return nullptr;
+        }
+
+        void* pPages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        return pPages == MAP_FAILED ? nullptr : pPages;
+#else
+        (void)size;
+        (void)alignment;
+        return nullptr;
+#endif
+    }
+#endif
+}
+
+namespace Utility
+{
+    size_t GetPageSize()
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    size_t GetHugePageSize()
+    {
+#if defined(_WIN32)
+        return GetLargePageMinimum();
+#elif defined(__linux__)
+        //
+        // The PMD-sized huge page, which is what both hugetlbfs and
+        // transparent huge pages default to on x86-64.
+        //
+        return size_t(2) << 20;
+#else
+        return 0;
+#endif
+    }
+
+    void* MapPages(size_t size, size_t alignment, bool useHugePages)
+    {
+#if defined(_WIN32)
+        if (useHugePages)
+        {
+            void* pPages = MapLargePages(size, alignment);
+            if (pPages)
+            {
+                return pPages;
+            }
+        }
+
+        //
+        // VirtualAlloc() only aligns on the allocation granularity, so
+        // reserve enough to find an aligned run, release it and claim the
+        // run. Another thread may map something there in between, in which
+        // case try again.
+        //
+        for (int attempt = 0; attempt < 8; attempt++)
+        {
+            void* pReserved = VirtualAlloc(nullptr, size + alignment, MEM_RESERVE, PAGE_NOACCESS);
+            if (!pReserved)
+            {
+                return nullptr;
+            }
+
+            void* pAligned = reinterpret_cast<void*>(AlignUp(reinterpret_cast<uintptr_t>(pReserved), alignment));
+            VirtualFree(pReserved, 0, MEM_RELEASE);
+
+            void* pPages = VirtualAlloc(pAligned, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+            if (pPages)
+            {
+                return pPages;
+            }
+        }
+
+        return nullptr;
+#else
+        if (useHugePages)
+        {
+            void* pPages = MapHugeTlbPages(size, alignment);
+            if (pPages)
+            {
+                return pPages;
+            }
+        }
+
+        //
+        // Map enough to find an aligned run, then unmap the slack on either
+        // side of it.
+        //
+        const size_t PageSize = GetPageSize();
+        const size_t MappedSize = size + alignment - PageSize;
+
+        void* pMapped = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pMapped == MAP_FAILED)
+        {
+            return nullptr;
+        }
+
+        const uintptr_t Mapped = reinterpret_cast<uintptr_t>(pMapped);
+        const uintptr_t Aligned = AlignUp(Mapped, alignment);
+        if (Aligned > Mapped)
+        {
+            munmap(pMapped, Aligned - Mapped);
+        }
+
+        if (Mapped + MappedSize > Aligned + size)
+        {
+            munmap(reinterpret_cast<void*>(Aligned + size), Mapped + MappedSize - (Aligned + size));
+        }
+
+        void* pPages = reinterpret_cast<void*>(Aligned);
+
+#if defined(MADV_HUGEPAGE)
+        //
+        // Only a hint; the kernel backs the mapping with huge pages where it
+        // can, and it's harmless where transparent huge pages are disabled.
+        //
+        if (useHugePages)
+        {
+            madvise(pPages, size, MADV_HUGEPAGE);
+        }
+#endif
+
+        return pPages;
+#endif
+    }
+
+    void UnmapPages(void* pPages, size_t size)
+    {
+#if defined(_WIN32)
+        (void)size;
+        VirtualFree(pPages, 0, MEM_RELEASE);
+#else
+        munmap(pPages, size);
+#endif
+    }
+
+    void DiscardPages(void* pPages, size_t size)
+    {
+        const size_t PageSize = GetPageSize();
+        const uintptr_t Begin = AlignUp(reinterpret_cast<uintptr_t>(pPages), PageSize);
+        const uintptr_t End = (reinterpret_cast<uintptr_t>(pPages) + size) & ~static_cast<uintptr_t>(PageSize - 1);
+        if (Begin >= End)
+        {
+            return;
+        }
+
+        //
+        // Failing to discard only costs memory, e.g. for large pages, which
+        // can't be discarded piecemeal.
+        //
+#if defined(_WIN32)
+        VirtualAlloc(reinterpret_cast<void*>(Begin), End - Begin, MEM_RESET, PAGE_READWRITE);
+#else
+        madvise(reinterpret_cast<void*>(Begin), End - Begin, MADV_DONTNEED);
+#endif
+    }
+}
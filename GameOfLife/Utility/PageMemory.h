@@ -0,0 +1,43 @@
+#pragma once
+
+//
+// Memory mapped straight from the OS a page at a time, for allocations big
+// enough that the heap's bookkeeping and scattered placement cost more than
+// they're worth. Mapped pages read as zero until written.
+//
+// Huge pages cover many times the memory of a normal page per TLB entry,
+// which matters once the working set runs to hundreds of megabytes. Explicit
+// huge pages are tried first, then transparent ones where the OS has them,
+// then normal pages, so asking for huge pages never makes a mapping fail.
+//
+
+#include <cstddef>
+
+namespace Utility
+{
+    size_t GetPageSize();
+
+    //
+    // The size of the smallest huge page, or zero if the OS has none.
+    //
+    size_t GetHugePageSize();
+
+    //
+    // Maps size bytes aligned on alignment, both powers of two of at least
+    // the page size. Returns null if the OS is out of memory.
+    //
+    void* MapPages(size_t size, size_t alignment, bool useHugePages);
+
+    //
+    // Unmaps memory returned by MapPages() with the size it was mapped with.
+    //
+    void UnmapPages(void* pPages, size_t size);
+
+    //
+    // Hands the physical memory behind whole pages in [pPages, pPages +
+    // size) back to the OS while keeping the mapping, for memory which is
+    // free but likely to be used again. The pages' contents are lost; they
+    // read as zero or garbage afterwards, depending on the OS.
+    //
+    void DiscardPages(void* pPages, size_t size);
+}
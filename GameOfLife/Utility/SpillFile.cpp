@@ -0,0 +1,269 @@
+#include "SpillFile.h"
+#include "PageMemory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <exception>
+#include <limits>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    //
+    // Files are mapped at offsets which are multiples of this.
+    //
+    size_t GetMappingGranularity()
+    {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return info.dwAllocationGranularity;
+#else
+        return Utility::GetPageSize();
+#endif
+    }
+}
+
+namespace Utility
+{
+    SpillFile::SpillFile(const std::string& directory, size_t recordSize, size_t segmentSize)
+        : m_recordSize(recordSize),
+          m_numRecords(0)
+    {
+        assert(recordSize > 0);
+
+        const size_t Granularity = GetMappingGranularity();
+        m_segmentSize = std::max(segmentSize, recordSize);
+        m_segmentSize = (m_segmentSize + Granularity - 1) / Granularity * Granularity;
+        m_recordsPerSegment = m_segmentSize / m_recordSize;
+
+#if defined(_WIN32)
+        char directoryPath[MAX_PATH + 1];
+        if (directory.empty())
+        {
+            if (!GetTempPathA(sizeof(directoryPath), directoryPath))
+            {
+                throw std::exception("Failed to find the temporary directory for the spill file.");
+            }
+        }
+        else
+        {
+            if (directory.size() > MAX_PATH)
+            {
+                throw std::exception("Spill file directory path is too long.");
+            }
+
+            directory.copy(directoryPath, directory.size());
+            directoryPath[directory.size()] = '\0';
+        }
+
+        char path[MAX_PATH + 1];
+        if (!GetTempFileNameA(directoryPath, "gol", 0, path))
+        {
+            throw std::exception("Failed to create spill file.");
+        }
+
+        //
+        // GetTempFileName() creates the file; open it again to have it
+        // deleted on close, and tell the cache manager it's short-lived.
+        //
+        HANDLE hFile = CreateFileA(
+            path,
+            GENERIC_READ | GENERIC_WRITE,
+            0,
+            nullptr,
+            CREATE_ALWAYS,
+            FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE,
+            nullptr
+            );
+        if (hFile == INVALID_HANDLE_VALUE)
+        {
+            DeleteFileA(path);
+            throw std::exception("Failed to create spill file.");
+        }
+
+        m_hFile = hFile;
+#else
+        std::string path = directory;
+        if (path.empty())
+        {
+            const char* pTempDirectory = getenv("TMPDIR");
+            path = pTempDirectory && *pTempDirectory ? pTempDirectory : "/tmp";
+        }
+
+        path += "/gol-spill-XXXXXX";
+        std::vector<char> pathBuffer(path.begin(), path.end());
+        pathBuffer.push_back('\0');
+
+        m_fd = mkstemp(pathBuffer.data());
+        if (m_fd < 0)
+        {
+            throw std::exception("Failed to create spill file.");
+        }
+
+        //
+        // Nothing else needs to find the file, so unlink it straight away;
+        // it's then gone as soon as it's closed, even if we crash.
+        //
+        unlink(pathBuffer.data());
+#endif
+    }
+
+    SpillFile::~SpillFile()
+    {
+#if defined(_WIN32)
+        for (uint8_t* pSegment : m_segments)
+        {
+            UnmapViewOfFile(pSegment);
+        }
+
+        CloseHandle(m_hFile);
+#else
+        for (uint8_t* pSegment : m_segments)
+        {
+            munmap(pSegment, m_segmentSize);
+        }
+
+        close(m_fd);
+#endif
+    }
+
+    uint32_t SpillFile::Allocate()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (!m_freeRecords.empty())
+        {
+            const uint32_t Record = m_freeRecords.back();
+            m_freeRecords.pop_back();
+            return Record;
+        }
+
+        if (m_numRecords == m_segments.size() * m_recordsPerSegment)
+        {
+            if (m_numRecords + m_recordsPerSegment > std::numeric_limits<uint32_t>::max())
+            {
+                throw std::exception("Unrecoverable: Out of spill file records!");
+            }
+
+            AddSegment();
+        }
+
+        return static_cast<uint32_t>(m_numRecords++);
+    }
+
+    void SpillFile::Free(uint32_t record)
+    {
+        assert(record < m_numRecords);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_freeRecords.push_back(record);
+    }
+
+    void SpillFile::Prefetch(uint32_t record) const
+    {
+        const size_t PageSize = GetPageSize();
+        const uintptr_t Begin = reinterpret_cast<uintptr_t>(GetRecord(record)) & ~static_cast<uintptr_t>(PageSize - 1);
+        const uintptr_t End = reinterpret_cast<uintptr_t>(GetRecord(record)) + m_recordSize;
+
+        //
+        // Only a hint; failing just means touching the record waits on the
+        // disk after all.
+        //
+#if defined(_WIN32)
+#if _WIN32_WINNT >= 0x0602
+        WIN32_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = reinterpret_cast<void*>(Begin);
+        range.NumberOfBytes = End - Begin;
+        PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+#else
+        madvise(reinterpret_cast<void*>(Begin), End - Begin, MADV_WILLNEED);
+#endif
+    }
+
+    void SpillFile::Evict()
+    {
+        for (uint8_t* pSegment : m_segments)
+        {
+#if defined(_WIN32)
+            //
+            // Unlocking pages which aren't locked takes them out of the
+            // working set.
+            //
+            VirtualUnlock(pSegment, m_segmentSize);
+#else
+            //
+            // For a shared file mapping, this only unmaps the pages; dirty
+            // ones are still written back to the file.
+            //
+            madvise(pSegment, m_segmentSize, MADV_DONTNEED);
+#endif
+        }
+    }
+
+    void SpillFile::AddSegment()
+    {
+        const uint64_t Offset = static_cast<uint64_t>(m_segments.size()) * m_segmentSize;
+        const uint64_t End = Offset + m_segmentSize;
+
+#if defined(_WIN32)
+        //
+        // Creating a mapping larger than the file extends it. The view keeps
+        // the mapping alive once its handle is closed.
+        //
+        HANDLE hMapping = CreateFileMappingA(
+            m_hFile,
+            nullptr,
+            PAGE_READWRITE,
+            static_cast<DWORD>(End >> 32),
+            static_cast<DWORD>(End),
+            nullptr
+            );
+        if (!hMapping)
+        {
+            throw std::exception("Failed to extend spill file.");
+        }
+
+        void* pSegment = MapViewOfFile(
+            hMapping,
+            FILE_MAP_READ | FILE_MAP_WRITE,
+            static_cast<DWORD>(Offset >> 32),
+            static_cast<DWORD>(Offset),
+            m_segmentSize
+            );
+        CloseHandle(hMapping);
+
+        if (!pSegment)
+        {
+            throw std::exception("Failed to map spill file.");
+        }
+#else
+        //
+        // The file stays sparse until pages are written back to it.
+        //
+        if (ftruncate(m_fd, static_cast<off_t>(End)))
+        {
+            throw std::exception("Failed to extend spill file.");
+        }
+
+        void* pSegment = mmap(nullptr, m_segmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, static_cast<off_t>(Offset));
+        if (pSegment == MAP_FAILED)
+        {
+            throw std::exception("Failed to map spill file.");
+        }
+#endif
+
+        m_segments.push_back(static_cast<uint8_t*>(pSegment));
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+//
+// Fixed-size records in a temporary file mapped into memory, for data too
+// cold to keep in RAM which must still be readable in place. Records the
+// process isn't touching only take up the OS's file cache, which it can
+// write back and reclaim as it needs the memory, and are read back in from
+// the file when they're touched again.
+//
+// The file grows a segment at a time, each mapped on its own, so records
+// never move once allocated. It's deleted when closed.
+//
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Utility
+{
+    class SpillFile
+    {
+    public:
+        //
+        // Creates the file in directory, or the system's temporary directory
+        // if that's empty. segmentSize is rounded up to a multiple of the
+        // granularity the OS maps files at. Throws if the file can't be
+        // created.
+        //
+        SpillFile(const std::string& directory, size_t recordSize, size_t segmentSize = size_t(64) << 20);
+        ~SpillFile();
+
+        //
+        // Returns a free record, growing the file if there are none. Throws
+        // if it can't grow. Free() may be called from several threads at
+        // once, but not alongside Allocate().
+        //
+        uint32_t Allocate();
+        void Free(uint32_t record);
+
+        uint8_t* GetRecord(uint32_t record) const
+        {
+            return m_segments[record / m_recordsPerSegment] + (record % m_recordsPerSegment) * m_recordSize;
+        }
+
+        //
+        // Asks the OS to start reading a record back in from the file, so
+        // touching it later doesn't wait on the disk.
+        //
+        void Prefetch(uint32_t record) const;
+
+        //
+        // Drops every record from the process's resident memory. Their
+        // contents are kept, in the file cache until the OS writes them back
+        // to the file.
+        //
+        void Evict();
+
+        //
+        // Records allocated and not freed.
+        //
+        size_t GetRecordCount() const { return m_numRecords - m_freeRecords.size(); }
+
+        size_t GetFileSize() const { return m_segments.size() * m_segmentSize; }
+
+    private:
+        SpillFile(const SpillFile& other) = delete;
+        SpillFile& operator=(const SpillFile& other) = delete;
+
+        //
+        // Extends the file by a segment and maps it.
+        //
+        void AddSegment();
+
+        size_t m_recordSize;
+        size_t m_segmentSize;
+        size_t m_recordsPerSegment;
+
+#if defined(_WIN32)
+        void* m_hFile;
+#else
+        int m_fd;
+#endif
+
+        std::vector<uint8_t*> m_segments;
+
+        //
+        // Records handed out so far, and the ones since freed, which are
+        // handed out again before the file grows.
+        //
+        size_t m_numRecords;
+        std::vector<uint32_t> m_freeRecords;
+        std::mutex m_mutex;
+    };
+}
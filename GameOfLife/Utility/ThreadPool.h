@@ -0,0 +1,540 @@
+#pragma once
+
+//
+// A fixed set of worker threads for running loops in parallel. The thread
+// calling ParallelFor() takes part in the loop, so a pool of one thread
+// simply runs everything inline.
+//
+// Loops are split into ranges of consecutive indices, and each thread
+// starts out with its own run of consecutive ranges. Threads work through
+// their own ranges from the front and, once out, steal from the back of
+// other threads' runs, i.e. as far as possible from where their owners are
+// working.
+//
+// RunTasks() schedules individual items instead, which may queue up more
+// items as they run, for work whose dependencies are only discovered along
+// the way.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utility
+{
+    class ThreadPool
+    {
+    public:
+        //
+        // numThreads includes the calling thread. Zero picks one thread per
+        // hardware thread.
+        //
+        explicit ThreadPool(size_t numThreads = 0)
+            : m_pBody(nullptr),
+              m_pRangeEnds(nullptr),
+              m_pendingTasks(0),
+              m_abandoned(false),
+              m_taskEpoch(0),
+              m_idleTaskThreads(0),
+              m_busyWorkers(0),
+              m_loopId(0),
+              m_exiting(false)
+        {
+            if (!numThreads)
+            {
+                numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+            }
+
+            for (size_t thread = 0; thread < numThreads; thread++)
+            {
+                m_queues.emplace_back(new RangeQueue());
+            }
+
+            for (size_t thread = 1; thread < numThreads; thread++)
+            {
+                m_workers.emplace_back(&ThreadPool::WorkerMain, this, thread);
+            }
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exiting = true;
+            }
+
+            m_workReady.notify_all();
+            for (std::thread& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        size_t GetThreadCount() const { return m_workers.size() + 1; }
+
+        //
+        // Calls body(i, thread) for every i in [0, rangeEnds.back()), and
+        // returns once every call has. Range k covers the indices from
+        // rangeEnds[k - 1] (or zero) up to rangeEnds[k]; ranges are the unit
+        // of scheduling and stealing, so they should cost about the same.
+        //
+        // thread is the index in [0, GetThreadCount()) of the thread making
+        // the call, for indexing per-thread buffers; the calling thread is
+        // always zero.
+        //
+        // If any call throws, the remaining ranges are abandoned and the
+        // first exception is rethrown here.
+        //
+        void ParallelFor(
+            const std::vector<size_t>& rangeEnds,
+            const std::function<void(size_t, size_t)>& body
+            )
+        {
+            if (rangeEnds.empty())
+            {
+                return;
+            }
+
+            if (m_workers.empty() || rangeEnds.size() == 1)
+            {
+                for (size_t i = 0; i < rangeEnds.back(); i++)
+                {
+                    body(i, 0);
+                }
+
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pBody = &body;
+                m_pRangeEnds = &rangeEnds;
+
+                //
+                // Deal out runs of consecutive ranges, so neighboring ranges
+                // tend to run on the same thread.
+                //
+                const size_t NumRanges  = rangeEnds.size();
+                const size_t NumThreads = m_queues.size();
+                for (size_t thread = 0; thread < NumThreads; thread++)
+                {
+                    RangeQueue& queue = *m_queues[thread];
+                    std::lock_guard<std::mutex> queueLock(queue.Mutex);
+                    queue.Front = NumRanges * thread / NumThreads;
+                    queue.Back  = NumRanges * (thread + 1) / NumThreads;
+                }
+
+                StartLoop();
+            }
+
+            m_workReady.notify_all();
+            RunRanges(0);
+            FinishLoop();
+        }
+
+        //
+        // The same over [0, count) split into ranges of grainSize indices.
+        //
+        void ParallelFor(
+            size_t count,
+            size_t grainSize,
+            const std::function<void(size_t, size_t)>& body
+            )
+        {
+            grainSize = std::max<size_t>(grainSize, 1);
+
+            std::vector<size_t> rangeEnds;
+            for (size_t end = grainSize; end - grainSize < count; end += grainSize)
+            {
+                rangeEnds.push_back(std::min(end, count));
+            }
+
+            ParallelFor(rangeEnds, body);
+        }
+
+        //
+        // Calls body(item, thread) for every item in items and every item
+        // passed to Spawn() along the way, and returns once every call has.
+        // Items run in no particular order. Each thread runs the items it
+        // spawned most recently first, since they likely touch what it just
+        // did, and steals the oldest items of other threads once it runs
+        // out.
+        //
+        // thread and exceptions work as in ParallelFor().
+        //
+        void RunTasks(
+            const std::vector<size_t>& items,
+            const std::function<void(size_t, size_t)>& body
+            )
+        {
+            if (items.empty())
+            {
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pBody = &body;
+                m_pRangeEnds = nullptr;
+
+                //
+                // Deal out runs of consecutive items as above, each one in
+                // reverse so its owner starts at the front of it.
+                //
+                const size_t NumItems   = items.size();
+                const size_t NumThreads = m_queues.size();
+                for (size_t thread = 0; thread < NumThreads; thread++)
+                {
+                    RangeQueue& queue = *m_queues[thread];
+                    std::lock_guard<std::mutex> queueLock(queue.Mutex);
+                    queue.Tasks.assign(
+                        items.rbegin() + (NumItems - NumItems * (thread + 1) / NumThreads),
+                        items.rbegin() + (NumItems - NumItems * thread / NumThreads)
+                        );
+                }
+
+                m_pendingTasks = NumItems;
+                StartLoop();
+            }
+
+            m_workReady.notify_all();
+            RunQueuedTasks(0);
+            FinishLoop();
+        }
+
+        //
+        // Queues up another item for the RunTasks() loop in progress. Only
+        // to be called from its body, with the thread it was passed.
+        //
+        void Spawn(size_t item, size_t thread)
+        {
+            m_pendingTasks++;
+
+            {
+                RangeQueue& queue = *m_queues[thread];
+                std::lock_guard<std::mutex> lock(queue.Mutex);
+                queue.Tasks.push_back(item);
+            }
+
+            m_taskEpoch++;
+            if (m_idleTaskThreads)
+            {
+                WakeIdleTaskThreads(false);
+            }
+        }
+
+    private:
+        ThreadPool(const ThreadPool& other) = delete;
+        ThreadPool& operator=(const ThreadPool& other) = delete;
+
+        void WorkerMain(size_t thread)
+        {
+            uint64_t lastLoopId = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_workReady.wait(lock, [this, lastLoopId]() { return m_exiting || m_loopId != lastLoopId; });
+                    if (m_exiting)
+                    {
+                        return;
+                    }
+
+                    lastLoopId = m_loopId;
+                }
+
+                if (m_pRangeEnds)
+                {
+                    RunRanges(thread);
+                }
+                else
+                {
+                    RunQueuedTasks(thread);
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_busyWorkers == 0)
+                {
+                    m_workDone.notify_one();
+                }
+            }
+        }
+
+        //
+        // Must be called with m_mutex held once the loop's queues are set
+        // up, then followed by waking the workers.
+        //
+        void StartLoop()
+        {
+            m_abandoned = false;
+            m_busyWorkers = m_workers.size();
+            m_spException = nullptr;
+            m_loopId++;
+        }
+
+        //
+        // Waits for the workers to finish the loop in progress, then
+        // rethrows the first exception it raised, if any.
+        //
+        void FinishLoop()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workDone.wait(lock, [this]() { return m_busyWorkers == 0; });
+            m_pBody = nullptr;
+            m_pRangeEnds = nullptr;
+
+            if (m_spException)
+            {
+                std::rethrow_exception(m_spException);
+            }
+        }
+
+        void SetException()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_spException)
+            {
+                m_spException = std::current_exception();
+            }
+
+            m_abandoned = true;
+            WakeIdleTaskThreads(true);
+        }
+
+        //
+        // The ranges [Front, Back) of the loop in progress not yet taken
+        // from a thread's run. The owner takes from the front and thieves
+        // from the back.
+        //
+        // RunTasks() queues items in Tasks instead. The owner takes from the
+        // back and thieves from the front.
+        //
+        struct RangeQueue
+        {
+            RangeQueue() : Front(0), Back(0) {}
+
+            std::mutex Mutex;
+            size_t     Front;
+            size_t     Back;
+
+            std::deque<size_t> Tasks;
+        };
+
+        bool PopRange(size_t thread, size_t& rangeOut)
+        {
+            RangeQueue& queue = *m_queues[thread];
+            std::lock_guard<std::mutex> lock(queue.Mutex);
+            if (queue.Front == queue.Back)
+            {
+                return false;
+            }
+
+            rangeOut = queue.Front++;
+            return true;
+        }
+
+        bool StealRange(size_t thread, size_t& rangeOut)
+        {
+            const size_t NumThreads = m_queues.size();
+            for (size_t i = 1; i < NumThreads; i++)
+            {
+                RangeQueue& queue = *m_queues[(thread + i) % NumThreads];
+                std::lock_guard<std::mutex> lock(queue.Mutex);
+                if (queue.Front != queue.Back)
+                {
+                    rangeOut = --queue.Back;
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void RunRanges(size_t thread)
+        {
+            const std::vector<size_t>& RangeEnds = *m_pRangeEnds;
+
+            size_t range;
+            while (!m_abandoned && (PopRange(thread, range) || StealRange(thread, range)))
+            {
+                const size_t Begin = range ? RangeEnds[range - 1] : 0;
+                const size_t End   = RangeEnds[range];
+                try
+                {
+                    for (size_t i = Begin; i < End; i++)
+                    {
+                        (*m_pBody)(i, thread);
+                    }
+                }
+                catch (...)
+                {
+                    SetException();
+                }
+            }
+        }
+
+        bool PopTask(size_t thread, size_t& itemOut)
+        {
+            RangeQueue& queue = *m_queues[thread];
+            std::lock_guard<std::mutex> lock(queue.Mutex);
+            if (queue.Tasks.empty())
+            {
+                return false;
+            }
+
+            itemOut = queue.Tasks.back();
+            queue.Tasks.pop_back();
+            return true;
+        }
+
+        bool StealTask(size_t thread, size_t& itemOut)
+        {
+            const size_t NumThreads = m_queues.size();
+            for (size_t i = 1; i < NumThreads; i++)
+            {
+                RangeQueue& queue = *m_queues[(thread + i) % NumThreads];
+                std::lock_guard<std::mutex> lock(queue.Mutex);
+                if (!queue.Tasks.empty())
+                {
+                    itemOut = queue.Tasks.front();
+                    queue.Tasks.pop_front();
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void RunQueuedTasks(size_t thread)
+        {
+            //
+            // Running out of items doesn't mean the loop is done, since the
+            // items still running may spawn more.
+            //
+            // When a thread finds nothing to run it spins for a while, since
+            // running items tend to spawn more soon, then parks until one is
+            // spawned or the loop ends. The epoch is read before looking, so
+            // an item spawned after the queues came up empty is never missed.
+            //
+            const uint32_t SpinLimit = 64;
+            uint32_t spins = 0;
+            while (!m_abandoned && m_pendingTasks)
+            {
+                const uint64_t Epoch = m_taskEpoch;
+
+                size_t item;
+                if (!PopTask(thread, item) && !StealTask(thread, item))
+                {
+                    if (++spins < SpinLimit)
+                    {
+                        std::this_thread::yield();
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_taskMutex);
+                    m_idleTaskThreads++;
+                    m_taskReady.wait(lock, [this, Epoch]()
+                    {
+                        return m_abandoned || !m_pendingTasks || m_taskEpoch != Epoch;
+                    });
+                    m_idleTaskThreads--;
+
+                    spins = 0;
+                    continue;
+                }
+
+                spins = 0;
+                try
+                {
+                    (*m_pBody)(item, thread);
+                }
+                catch (...)
+                {
+                    SetException();
+                }
+
+                if (--m_pendingTasks == 0 && m_idleTaskThreads)
+                {
+                    WakeIdleTaskThreads(true);
+                }
+            }
+
+            //
+            // An abandoned loop may leave items behind; don't let them leak
+            // into the next one.
+            //
+            std::lock_guard<std::mutex> lock(m_queues[thread]->Mutex);
+            m_queues[thread]->Tasks.clear();
+        }
+
+        //
+        // Wakes threads parked in RunQueuedTasks(); every one of them once
+        // the loop is over, or just one for a newly spawned item.
+        //
+        void WakeIdleTaskThreads(bool all)
+        {
+            //
+            // Taking the lock means a thread which has just checked for
+            // work is already waiting, so can't miss the notification.
+            //
+            {
+                std::lock_guard<std::mutex> lock(m_taskMutex);
+            }
+
+            if (all)
+            {
+                m_taskReady.notify_all();
+            }
+            else
+            {
+                m_taskReady.notify_one();
+            }
+        }
+
+        std::vector<std::thread> m_workers;
+
+        std::mutex              m_mutex;
+        std::condition_variable m_workReady;
+        std::condition_variable m_workDone;
+
+        //
+        // One queue per thread, the calling thread's first.
+        //
+        std::vector<std::unique_ptr<RangeQueue>> m_queues;
+
+        //
+        // The loop in progress, whose m_pRangeEnds is null if it came from
+        // RunTasks(). m_pendingTasks counts the items queued or running.
+        // m_loopId changes whenever a new one starts, and m_busyWorkers
+        // counts the workers yet to finish it.
+        //
+        const std::function<void(size_t, size_t)>* m_pBody;
+        const std::vector<size_t>* m_pRangeEnds;
+        std::atomic<size_t> m_pendingTasks;
+        std::atomic<bool>   m_abandoned;
+
+        //
+        // Threads with nothing to run during RunTasks() wait on m_taskReady
+        // for m_taskEpoch to change, which it does with every Spawn().
+        // m_idleTaskThreads counts them, so Spawn() only has to signal when
+        // someone's waiting.
+        //
+        std::mutex               m_taskMutex;
+        std::condition_variable  m_taskReady;
+        std::atomic<uint64_t>    m_taskEpoch;
+        std::atomic<size_t>      m_idleTaskThreads;
+        size_t              m_busyWorkers;
+        uint64_t            m_loopId;
+        bool                m_exiting;
+
+        std::exception_ptr  m_spException;
+    };
+}
@@ -0,0 +1,116 @@
+#include "Benchmark.h"
+#include "Baseline/AlignedMemoryPool.h"
+
+#include <Utility/AlignedMemoryPool.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+
+namespace Benchmarks
+{
+    namespace
+    {
+        //
+        // Allocates numLive sublocks, replaces a random live one numChurn
+        // times, then frees them all in random order, as tiles are born and
+        // retired over a run. Returns the milliseconds taken.
+        //
+        template <typename Pool>
+        double MeasureChurn(Pool& pool, size_t numLive, size_t numChurn, uint32_t seed)
+        {
+            std::mt19937 random(seed);
+            std::vector<uint8_t*> live;
+            live.reserve(numLive);
+
+            Stopwatch stopwatch;
+            for (size_t i = 0; i < numLive; i++)
+            {
+                live.push_back(pool.Allocate());
+            }
+
+            for (size_t i = 0; i < numChurn; i++)
+            {
+                const size_t Index = random() % numLive;
+                pool.Free(live[Index]);
+                live[Index] = pool.Allocate();
+            }
+
+            std::shuffle(live.begin(), live.end(), random);
+            for (uint8_t* pSublock : live)
+            {
+                pool.Free(pSublock);
+            }
+
+            return stopwatch.GetMilliseconds();
+        }
+    }
+
+    //
+    // Single-threaded allocation throughput of AlignedMemoryPool, with and
+    // without its thread cache, against the pool from before Allocate() and
+    // Free() were made constant time. The baseline's Free() is linear in
+    // the number of live sublocks, so it's skipped with --baseline=0 for
+    // large counts.
+    //
+    // Options: --live=<n> sublocks (default 10000), --churn=<n>
+    // replacements (default 4 times --live), --size=<bytes> per sublock, a
+    // multiple of 64 (default 128), --superblock=<n> sublocks per superblock
+    // (default 32), --runs (default 3), --baseline=0|1 (default 1),
+    // --seed (default 1).
+    //
+    int RunAllocationThroughput(const Options& options)
+    {
+        const size_t NumLive = static_cast<size_t>(options.GetInt("live", 10000));
+        const size_t NumChurn = static_cast<size_t>(options.GetInt("churn", 4 * static_cast<int64_t>(NumLive)));
+        const size_t SublockSize = static_cast<size_t>(options.GetInt("size", 128));
+        const size_t SuperblockLength = static_cast<size_t>(options.GetInt("superblock", 32));
+        const int64_t NumRuns = options.GetInt("runs", 3);
+        const uint32_t Seed = static_cast<uint32_t>(options.GetInt("seed", 1));
+
+        //
+        // Every live sublock is allocated and freed once, and every
+        // replacement does one of each.
+        //
+        const double NumOperations = 2.0 * (NumLive + NumChurn);
+
+        std::cout << NumLive << " live sublocks of " << SublockSize << " bytes, " << NumChurn << " replacements" << std::endl
+                  << "pool\tbest ms\tM ops/s" << std::endl;
+
+        auto report = [NumRuns, NumOperations](const char* name, const std::function<double()>& measure)
+        {
+            double bestMilliseconds = 0.0;
+            for (int64_t run = 0; run < NumRuns; run++)
+            {
+                const double Milliseconds = measure();
+                bestMilliseconds = run ? std::min(bestMilliseconds, Milliseconds) : Milliseconds;
+            }
+
+            std::cout << name << "\t" << bestMilliseconds << "\t" << NumOperations / bestMilliseconds / 1000.0 << std::endl;
+        };
+
+        report("cached", [=]()
+        {
+            Utility::AlignedMemoryPool<64> pool(SublockSize, SuperblockLength);
+            return MeasureChurn(pool, NumLive, NumChurn, Seed);
+        });
+
+        report("uncached", [=]()
+        {
+            Utility::AlignedMemoryPool<64> pool(SublockSize, SuperblockLength, 2, 0);
+            return MeasureChurn(pool, NumLive, NumChurn, Seed);
+        });
+
+        if (options.GetInt("baseline", 1))
+        {
+            report("baseline", [=]()
+            {
+                Baseline::AlignedMemoryPool<64> pool(SublockSize, SuperblockLength);
+                return MeasureChurn(pool, NumLive, NumChurn, Seed);
+            });
+        }
+
+        return 0;
+    }
+}
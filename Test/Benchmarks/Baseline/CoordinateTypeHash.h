@@ -0,0 +1,25 @@
+#pragma once
+
+//
+// Include in implementation files which require hash functions
+// for the CoordinateType pair types.
+//
+// The hash SubGridGraph's std::unordered_map used before TileLookup
+// replaced it, kept as a baseline for the lookup benchmark.
+//
+
+#include <GameOfLife/Tile.h>
+
+#include <Utility\Hash.h>
+
+namespace std
+{
+    template<>
+    struct hash<GameOfLife::CoordinateType>
+    {
+        std::size_t operator()(const GameOfLife::CoordinateType& coord) const
+        {
+            return Utility::hash_value(coord);
+        }
+    };
+}
@@ -0,0 +1,77 @@
+#include "Benchmark.h"
+
+#include <GameOfLife/Tile.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <random>
+
+namespace Benchmarks
+{
+    Options::Options(const std::vector<std::string>& args)
+    {
+        for (const std::string& arg : args)
+        {
+            const size_t Equals = arg.find('=');
+            if (arg.compare(0, 2, "--") != 0 || Equals == std::string::npos)
+            {
+                throw std::exception("Options must be of the form --name=value.");
+            }
+
+            m_values[arg.substr(2, Equals - 2)] = arg.substr(Equals + 1);
+        }
+    }
+
+    int64_t Options::GetInt(const std::string& name, int64_t defaultValue) const
+    {
+        auto it = m_values.find(name);
+        return it == m_values.end() ? defaultValue : atoll(it->second.c_str());
+    }
+
+    double Options::GetDouble(const std::string& name, double defaultValue) const
+    {
+        auto it = m_values.find(name);
+        return it == m_values.end() ? defaultValue : atof(it->second.c_str());
+    }
+
+    std::vector<GameOfLife::Cell> GenerateSoup(int64_t width, int64_t height, double density, uint32_t seed)
+    {
+        std::mt19937 random(seed);
+        std::bernoulli_distribution isAlive(density);
+
+        std::vector<GameOfLife::Cell> cells;
+        for (int64_t y = 0; y < height; y++)
+        {
+            for (int64_t x = 0; x < width; x++)
+            {
+                if (isAlive(random))
+                {
+                    cells.emplace_back(x, y, false);
+                }
+            }
+        }
+
+        return cells;
+    }
+
+    std::vector<GameOfLife::CoordinateType> GetLivingCells(const GameOfLife::Engine& engine)
+    {
+        std::vector<GameOfLife::CoordinateType> cells;
+        engine.ForEachTile([&cells](const GameOfLife::Tile& tile)
+        {
+            for (int64_t y = tile.YMin(); y < tile.YMin() + tile.Height(); y++)
+            {
+                for (int64_t x = tile.XMin(); x < tile.XMin() + tile.Width(); x++)
+                {
+                    if (tile.GetCellState(x, y))
+                    {
+                        cells.emplace_back(x, y);
+                    }
+                }
+            }
+        });
+
+        std::sort(cells.begin(), cells.end());
+        return cells;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+//
+// Shared pieces of the benchmarks. Each benchmark is a function taking the
+// command line options after its name, returning the process exit code.
+//
+
+#include <GameOfLife/Cell.h>
+#include <GameOfLife/Engine.h>
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Benchmarks
+{
+    //
+    // "--name=value" options, with defaults for the ones not given.
+    //
+    class Options
+    {
+    public:
+        Options(const std::vector<std::string>& args);
+
+        int64_t GetInt(const std::string& name, int64_t defaultValue) const;
+        double GetDouble(const std::string& name, double defaultValue) const;
+
+    private:
+        std::map<std::string, std::string> m_values;
+    };
+
+    class Stopwatch
+    {
+    public:
+        Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+        void Restart() { m_start = std::chrono::steady_clock::now(); }
+
+        double GetMilliseconds() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+        }
+
+    private:
+        std::chrono::steady_clock::time_point m_start;
+    };
+
+    //
+    // A width by height block of cells with its upper-left corner at the
+    // origin, each one alive with the given probability. The same seed gives
+    // the same soup.
+    //
+    std::vector<GameOfLife::Cell> GenerateSoup(int64_t width, int64_t height, double density, uint32_t seed);
+
+    //
+    // Coordinates of every living cell in the engine's current generation,
+    // sorted, to check that variants of a benchmark computed the same thing.
+    //
+    std::vector<GameOfLife::CoordinateType> GetLivingCells(const GameOfLife::Engine& engine);
+
+    int RunAllocationThroughput(const Options& options);
+    int RunHaloDepthSweep(const Options& options);
+    int RunScheduleOrderComparison(const Options& options);
+    int RunTileLookupLatency(const Options& options);
+    int RunThreadedAllocation(const Options& options);
+    int RunCrossThreadFreeTest(const Options& options);
+}
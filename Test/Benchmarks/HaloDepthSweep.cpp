@@ -0,0 +1,99 @@
+#include "Benchmark.h"
+#include "HardwareCounters.h"
+
+#include <GameOfLife/SparseGrid.h>
+
+#include <Utility/AlignedMemoryPool.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace Benchmarks
+{
+    //
+    // Steps the same soup with halo depths 1, 2, 4 and 8, i.e. exchanging
+    // borders every generation (in windowed dataflow) and then once every
+    // 2, 4 and 8. Reports the best of several runs for each, with the dTLB
+    // load misses of the last where the OS can count them, and checks that
+    // they all end up with the same cells.
+    //
+    // Options: --tile=30|62|126 (default 30), --tiles=<n> soup width and
+    // height in tiles (default 20), --density (default 0.3), --generations
+    // (default 512), --step=<k> generations per StepPow2() call as a power
+    // of two, at least 3 for every depth to matter (default 4), --threads
+    // (default 1), --runs (default 3), --seed (default 1), --hugepages=0|1
+    // cell grids on huge pages (default 0).
+    //
+    int RunHaloDepthSweep(const Options& options)
+    {
+        const int64_t TileSize = options.GetInt("tile", 30);
+        const int64_t SoupSize = options.GetInt("tiles", 20) * TileSize;
+        const int64_t Generations = options.GetInt("generations", 512);
+        const uint32_t Step = static_cast<uint32_t>(options.GetInt("step", 4));
+        const size_t NumThreads = static_cast<size_t>(options.GetInt("threads", 1));
+        const int64_t NumRuns = options.GetInt("runs", 3);
+        const bool UseHugePages = options.GetInt("hugepages", 0) != 0;
+
+        const std::vector<GameOfLife::Cell> Soup = GenerateSoup(
+            SoupSize,
+            SoupSize,
+            options.GetDouble("density", 0.3),
+            static_cast<uint32_t>(options.GetInt("seed", 1))
+            );
+
+        std::cout << "Soup of " << Soup.size() << " cells, " << SoupSize << " on a side, tile " << TileSize
+                  << ", " << Generations << " generations, 2^" << Step << " per step, " << NumThreads << " thread(s)"
+                  << (UseHugePages ? ", huge pages" : "") << std::endl
+                  << "halo\tbest ms\tdTLB misses\tliving cells" << std::endl;
+
+        const GameOfLife::CellFormat Format;
+        const uint32_t HaloDepths[] = { 1, 2, 4, 8 };
+        std::vector<GameOfLife::CoordinateType> expectedCells;
+        bool allMatch = true;
+        for (uint32_t haloDepth : HaloDepths)
+        {
+            double bestMilliseconds = 0.0;
+            HardwareCounters counters;
+            std::vector<GameOfLife::CoordinateType> cells;
+            for (int64_t run = 0; run < NumRuns; run++)
+            {
+                Utility::AlignedMemoryPool<64> pool(GameOfLife::GetCellGridBufferSize(TileSize, Format.Layout), 32, 2, 16, UseHugePages);
+                std::unique_ptr<GameOfLife::Engine> spGrid = GameOfLife::CreateSparseGrid(
+                    TileSize, Soup, pool, Format, NumThreads, haloDepth
+                    );
+
+                counters.Start();
+                Stopwatch stopwatch;
+                for (int64_t generation = 0; generation < Generations; generation += int64_t(1) << Step)
+                {
+                    spGrid->StepPow2(Step);
+                }
+
+                const double Milliseconds = stopwatch.GetMilliseconds();
+                counters.Stop();
+                bestMilliseconds = run ? std::min(bestMilliseconds, Milliseconds) : Milliseconds;
+                if (run == NumRuns - 1)
+                {
+                    cells = GetLivingCells(*spGrid);
+                }
+            }
+
+            if (haloDepth == HaloDepths[0])
+            {
+                expectedCells = cells;
+            }
+
+            allMatch = allMatch && cells == expectedCells;
+            std::cout << haloDepth << "\t" << bestMilliseconds << "\t" << counters.FormatCount(HardwareCounters::DataTlbMisses)
+                      << "\t" << cells.size() << std::endl;
+        }
+
+        if (!allMatch)
+        {
+            std::cerr << "Halo depths disagree on the final generation." << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+}
@@ -0,0 +1,106 @@
+#include "HardwareCounters.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#endif
+
+namespace
+{
+#if defined(__linux__)
+    //
+    // Read misses of each cache, in perf's generic cache event encoding.
+    //
+    uint64_t GetReadMissConfig(uint64_t cache)
+    {
+        return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    }
+
+    int OpenEvent(uint64_t config)
+    {
+        perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HW_CACHE;
+        attributes.config = config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+
+        return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+#endif
+}
+
+namespace Benchmarks
+{
+    HardwareCounters::HardwareCounters()
+    {
+        for (int event = 0; event < NUM_EVENTS; event++)
+        {
+            m_descriptors[event] = -1;
+            m_counts[event] = 0;
+        }
+
+#if defined(__linux__)
+        m_descriptors[L1DataMisses] = OpenEvent(GetReadMissConfig(PERF_COUNT_HW_CACHE_L1D));
+        m_descriptors[LastLevelMisses] = OpenEvent(GetReadMissConfig(PERF_COUNT_HW_CACHE_LL));
+        m_descriptors[DataTlbMisses] = OpenEvent(GetReadMissConfig(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+    }
+
+    HardwareCounters::~HardwareCounters()
+    {
+#if defined(__linux__)
+        for (int descriptor : m_descriptors)
+        {
+            if (descriptor >= 0)
+            {
+                close(descriptor);
+            }
+        }
+#endif
+    }
+
+    void HardwareCounters::Start()
+    {
+#if defined(__linux__)
+        for (int descriptor : m_descriptors)
+        {
+            if (descriptor >= 0)
+            {
+                ioctl(descriptor, PERF_EVENT_IOC_RESET, 0);
+                ioctl(descriptor, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    void HardwareCounters::Stop()
+    {
+#if defined(__linux__)
+        for (int event = 0; event < NUM_EVENTS; event++)
+        {
+            const int Descriptor = m_descriptors[event];
+            if (Descriptor < 0)
+            {
+                continue;
+            }
+
+            ioctl(Descriptor, PERF_EVENT_IOC_DISABLE, 0);
+
+            uint64_t count = 0;
+            m_counts[event] = read(Descriptor, &count, sizeof(count)) == sizeof(count) ? count : 0;
+        }
+#endif
+    }
+
+    std::string HardwareCounters::FormatCount(Event event) const
+    {
+        return IsAvailable(event) ? std::to_string(m_counts[event]) : std::string("n/a");
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+//
+// Cache and TLB miss counts for the calling thread, read from the CPU's
+// performance counters through perf_event_open() on Linux. Only the
+// calling thread is counted, so run benchmarks with --threads=1 to count
+// everything.
+//
+// An event is unavailable where the OS doesn't expose it: in VMs without a
+// virtual PMU, under a restrictive kernel.perf_event_paranoid, and on
+// other platforms. Benchmarks then print "n/a" and compare wall time only.
+// On Windows, count the same events by running the benchmark under VTune's
+// Memory Access analysis, or record them into an ETW trace with tracelog's
+// -PMC option and read them in Windows Performance Analyzer.
+//
+
+#include <cstdint>
+#include <string>
+
+namespace Benchmarks
+{
+    class HardwareCounters
+    {
+    public:
+        enum Event
+        {
+            L1DataMisses,
+            LastLevelMisses,
+            DataTlbMisses,
+            NUM_EVENTS
+        };
+
+        HardwareCounters();
+        ~HardwareCounters();
+
+        bool IsAvailable(Event event) const { return m_descriptors[event] >= 0; }
+
+        //
+        // Counts events from Start() to Stop(), replacing the last counts.
+        //
+        void Start();
+        void Stop();
+
+        uint64_t GetCount(Event event) const { return m_counts[event]; }
+
+        //
+        // The last count, or "n/a" if the event is unavailable.
+        //
+        std::string FormatCount(Event event) const;
+
+    private:
+        HardwareCounters(const HardwareCounters& other) = delete;
+        HardwareCounters& operator=(const HardwareCounters& other) = delete;
+
+        int      m_descriptors[NUM_EVENTS];
+        uint64_t m_counts[NUM_EVENTS];
+    };
+}
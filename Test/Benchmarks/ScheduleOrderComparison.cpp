@@ -0,0 +1,122 @@
+#include "Benchmark.h"
+#include "HardwareCounters.h"
+
+#include <GameOfLife/SparseGrid.h>
+
+#include <Utility/AlignedMemoryPool.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace Benchmarks
+{
+    namespace
+    {
+        template <int64_t TileSize>
+        std::unique_ptr<GameOfLife::Engine> CreateGrid(
+            const std::vector<GameOfLife::Cell>& soup,
+            Utility::AlignedMemoryPool<64>& pool,
+            size_t numThreads,
+            GameOfLife::ScheduleOrder order
+            )
+        {
+            return std::unique_ptr<GameOfLife::Engine>(new GameOfLife::SparseGrid<TileSize, TileSize>(
+                soup, pool, GameOfLife::CellFormat(), numThreads, 1, GameOfLife::MemoryBudget(), order
+                ));
+        }
+    }
+
+    //
+    // SparseGrid step time with subgrids stepped, and initially laid out,
+    // along a Hilbert curve against row by row, with L1 data and last level
+    // cache read misses of each order's last run where the OS can count
+    // them. Steps one generation at a time and then in windows of 2^step,
+    // where each subgrid reads a deeper neighborhood. Runs alternate between
+    // the orders, so drift in the machine's speed affects both alike, and it
+    // fails if they don't end up with the same cells.
+    //
+    // Options: --tile=30|62|126 (default 30), --tiles=<n> soup width and
+    // height in tiles (default 100), --density (default 0.3),
+    // --generations (default 64), --step=<k> (default 2), --threads
+    // (default 1), --runs (default 3), --seed (default 1).
+    //
+    int RunScheduleOrderComparison(const Options& options)
+    {
+        const int64_t TileSize = options.GetInt("tile", 30);
+        const int64_t SoupSize = options.GetInt("tiles", 100) * TileSize;
+        const int64_t Generations = options.GetInt("generations", 64);
+        const uint32_t WindowStep = static_cast<uint32_t>(options.GetInt("step", 2));
+        const size_t NumThreads = static_cast<size_t>(options.GetInt("threads", 1));
+        const int64_t NumRuns = options.GetInt("runs", 3);
+
+        auto createGrid = TileSize == 30 ? CreateGrid<30> : TileSize == 62 ? CreateGrid<62> : TileSize == 126 ? CreateGrid<126> : nullptr;
+        if (!createGrid)
+        {
+            throw std::exception("Tile size must be 30, 62 or 126.");
+        }
+
+        const std::vector<GameOfLife::Cell> Soup = GenerateSoup(
+            SoupSize,
+            SoupSize,
+            options.GetDouble("density", 0.3),
+            static_cast<uint32_t>(options.GetInt("seed", 1))
+            );
+
+        std::cout << "Soup of " << Soup.size() << " cells, " << SoupSize << " on a side, tile " << TileSize
+                  << ", " << Generations << " generations, " << NumThreads << " thread(s)" << std::endl
+                  << "step\torder\tbest ms\tL1D misses\tLLC misses\tliving cells" << std::endl;
+
+        const GameOfLife::ScheduleOrder Orders[] = { GameOfLife::ScheduleOrder::Hilbert, GameOfLife::ScheduleOrder::RowMajor };
+        const char* OrderNames[] = { "Hilbert", "row-major" };
+        const uint32_t Steps[] = { 0, WindowStep };
+        bool allMatch = true;
+        for (uint32_t step : Steps)
+        {
+            double bestMilliseconds[2] = {};
+            HardwareCounters counters[2];
+            std::vector<GameOfLife::CoordinateType> cells[2];
+            for (int64_t run = 0; run < NumRuns; run++)
+            {
+                for (size_t order = 0; order < 2; order++)
+                {
+                    const GameOfLife::CellFormat Format;
+                    Utility::AlignedMemoryPool<64> pool(GameOfLife::GetCellGridBufferSize(TileSize, Format.Layout), 32);
+                    std::unique_ptr<GameOfLife::Engine> spGrid = createGrid(Soup, pool, NumThreads, Orders[order]);
+
+                    counters[order].Start();
+                    Stopwatch stopwatch;
+                    for (int64_t generation = 0; generation < Generations; generation += int64_t(1) << step)
+                    {
+                        spGrid->StepPow2(step);
+                    }
+
+                    const double Milliseconds = stopwatch.GetMilliseconds();
+                    counters[order].Stop();
+                    bestMilliseconds[order] = run ? std::min(bestMilliseconds[order], Milliseconds) : Milliseconds;
+                    if (run == NumRuns - 1)
+                    {
+                        cells[order] = GetLivingCells(*spGrid);
+                    }
+                }
+            }
+
+            for (size_t order = 0; order < 2; order++)
+            {
+                std::cout << step << "\t" << OrderNames[order] << "\t" << bestMilliseconds[order] << "\t"
+                          << counters[order].FormatCount(HardwareCounters::L1DataMisses) << "\t"
+                          << counters[order].FormatCount(HardwareCounters::LastLevelMisses) << "\t"
+                          << cells[order].size() << std::endl;
+            }
+
+            allMatch = allMatch && cells[0] == cells[1];
+        }
+
+        if (!allMatch)
+        {
+            std::cerr << "The orders disagree on the final generation." << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+}
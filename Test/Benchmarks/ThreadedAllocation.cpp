@@ -0,0 +1,298 @@
+#include "Benchmark.h"
+
+#include <Utility/AlignedMemoryPool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+
+namespace Benchmarks
+{
+    namespace
+    {
+        const size_t SUBLOCK_SIZE = 128;
+
+        //
+        // Marks a sublock as belonging to owner, so a sublock handed out
+        // twice shows up as one whose mark changed under its holder.
+        //
+        void Mark(uint8_t* pSublock, uint32_t owner)
+        {
+            memset(pSublock, static_cast<int>(owner & 0xff) + 1, SUBLOCK_SIZE);
+        }
+
+        bool IsMarked(const uint8_t* pSublock, uint32_t owner)
+        {
+            const uint8_t Expected = static_cast<uint8_t>((owner & 0xff) + 1);
+            return std::all_of(pSublock, pSublock + SUBLOCK_SIZE, [Expected](uint8_t b) { return b == Expected; });
+        }
+
+        bool IsZeroed(const uint8_t* pSublock)
+        {
+            return std::all_of(pSublock, pSublock + SUBLOCK_SIZE, [](uint8_t b) { return b == 0; });
+        }
+
+        void Check(bool condition, const char* message, std::atomic<bool>& passed)
+        {
+            if (!condition)
+            {
+                std::cerr << "Failed: " << message << std::endl;
+                passed = false;
+            }
+        }
+    }
+
+    //
+    // Several threads at once each keep a set of live sublocks, replacing
+    // random ones, then free another thread's, as workers do when one
+    // retires a tile another created. Sweeps the thread count, with the
+    // thread cache off and at the given length.
+    //
+    // Options: --live=<n> sublocks per thread (default 2000), --churn=<n>
+    // replacements per thread (default 500000), --cache=<n> thread cache
+    // length (default 16), --max-threads (default 8), --runs (default 3).
+    //
+    int RunThreadedAllocation(const Options& options)
+    {
+        const size_t NumLive = static_cast<size_t>(options.GetInt("live", 2000));
+        const size_t NumChurn = static_cast<size_t>(options.GetInt("churn", 500000));
+        const size_t CacheLength = static_cast<size_t>(options.GetInt("cache", 16));
+        const size_t MaxThreads = static_cast<size_t>(options.GetInt("max-threads", 8));
+        const int64_t NumRuns = options.GetInt("runs", 3);
+
+        std::cout << NumLive << " live sublocks of " << SUBLOCK_SIZE << " bytes and " << NumChurn << " replacements per thread, "
+                  << std::thread::hardware_concurrency() << " hardware thread(s)" << std::endl
+                  << "threads\tcache\tbest ms\thits\trefills\tflushes" << std::endl;
+
+        for (size_t numThreads = 1; numThreads <= MaxThreads; numThreads *= 2)
+        {
+            const size_t CacheLengths[] = { 0, CacheLength };
+            for (size_t cacheLength : CacheLengths)
+            {
+                double bestMilliseconds = 0.0;
+                uint64_t hits = 0, refills = 0, flushes = 0;
+                for (int64_t run = 0; run < NumRuns; run++)
+                {
+                    Utility::AlignedMemoryPool<64> pool(SUBLOCK_SIZE, 32, 2, cacheLength);
+                    std::vector<std::vector<uint8_t*>> live(numThreads);
+
+                    Stopwatch stopwatch;
+                    std::vector<std::thread> threads;
+                    for (size_t t = 0; t < numThreads; t++)
+                    {
+                        threads.emplace_back([&pool, &live, t, NumLive, NumChurn]()
+                        {
+                            std::mt19937 random(static_cast<uint32_t>(t + 1));
+                            std::vector<uint8_t*>& sublocks = live[t];
+                            for (size_t i = 0; i < NumLive; i++)
+                            {
+                                sublocks.push_back(pool.Allocate());
+                            }
+
+                            for (size_t i = 0; i < NumChurn; i++)
+                            {
+                                const size_t Index = random() % NumLive;
+                                pool.Free(sublocks[Index]);
+                                sublocks[Index] = pool.Allocate();
+                                sublocks[Index][0] = 1;
+                            }
+                        });
+                    }
+
+                    for (std::thread& thread : threads)
+                    {
+                        thread.join();
+                    }
+
+                    threads.clear();
+                    for (size_t t = 0; t < numThreads; t++)
+                    {
+                        threads.emplace_back([&pool, &live, t, numThreads]()
+                        {
+                            for (uint8_t* pSublock : live[(t + 1) % numThreads])
+                            {
+                                pool.Free(pSublock);
+                            }
+                        });
+                    }
+
+                    for (std::thread& thread : threads)
+                    {
+                        thread.join();
+                    }
+
+                    const double Milliseconds = stopwatch.GetMilliseconds();
+                    bestMilliseconds = run ? std::min(bestMilliseconds, Milliseconds) : Milliseconds;
+                    hits = pool.GetCacheHits();
+                    refills = pool.GetCacheRefills();
+                    flushes = pool.GetCacheFlushes();
+                }
+
+                std::cout << numThreads << "\t" << cacheLength << "\t" << bestMilliseconds << "\t"
+                          << hits << "\t" << refills << "\t" << flushes << std::endl;
+            }
+        }
+
+        return 0;
+    }
+
+    //
+    // Not a timing: checks that sublocks allocated on one thread can be
+    // freed on another, through the freeing thread's cache, without being
+    // handed out twice or losing their contents while held. Exits nonzero
+    // on failure.
+    //
+    // 1. This thread, A, allocates more sublocks than a cache holds and
+    //    passes them to thread B, which frees them, so its cache fills and
+    //    flushes to the shared superblocks.
+    // 2. B then allocates as many, first getting back from its cache the
+    //    last sublocks it freed, and A allocates as many again. No sublock
+    //    may be held by both, and all must come back zeroed.
+    // 3. A allocates and B frees concurrently, handing sublocks over one at
+    //    a time, while both keep checking their own.
+    //
+    // Options: --cache=<n> thread cache length (default 16), --count=<n>
+    // sublocks per phase (default 1000).
+    //
+    int RunCrossThreadFreeTest(const Options& options)
+    {
+        const size_t CacheLength = static_cast<size_t>(options.GetInt("cache", 16));
+        const size_t Count = static_cast<size_t>(options.GetInt("count", 1000));
+        const uint32_t OwnerA = 1;
+        const uint32_t OwnerB = 2;
+
+        Utility::AlignedMemoryPool<64> pool(SUBLOCK_SIZE, 32, 2, CacheLength);
+        std::atomic<bool> passed(true);
+
+        std::vector<uint8_t*> handedOver;
+        for (size_t i = 0; i < Count; i++)
+        {
+            handedOver.push_back(pool.Allocate());
+            Mark(handedOver.back(), OwnerA);
+        }
+
+        std::vector<uint8_t*> heldByA, heldByB;
+        std::thread([&]()
+        {
+            for (uint8_t* pSublock : handedOver)
+            {
+                Check(IsMarked(pSublock, OwnerA), "a sublock changed before the other thread freed it", passed);
+                pool.Free(pSublock);
+            }
+
+            Check(CacheLength == 0 || pool.GetCacheFlushes() > 0, "the freeing thread never flushed its cache", passed);
+
+            const uint64_t HitsBefore = pool.GetCacheHits();
+            for (size_t i = 0; i < Count; i++)
+            {
+                heldByB.push_back(pool.Allocate());
+                Check(IsZeroed(heldByB.back()), "a sublock wasn't zeroed", passed);
+                Mark(heldByB.back(), OwnerB);
+            }
+
+            Check(
+                CacheLength == 0 || (pool.GetCacheHits() > HitsBefore && heldByB.front() == handedOver.back()),
+                "the freeing thread's cache didn't hand back what it freed",
+                passed
+                );
+        }).join();
+
+        for (size_t i = 0; i < Count; i++)
+        {
+            heldByA.push_back(pool.Allocate());
+            Check(IsZeroed(heldByA.back()), "a sublock wasn't zeroed", passed);
+            Mark(heldByA.back(), OwnerA);
+        }
+
+        std::set<uint8_t*> distinct(heldByA.begin(), heldByA.end());
+        distinct.insert(heldByB.begin(), heldByB.end());
+        Check(distinct.size() == 2 * Count, "a sublock was handed out twice", passed);
+        Check(
+            std::all_of(heldByA.begin(), heldByA.end(), [OwnerA](uint8_t* p) { return IsMarked(p, OwnerA); }) &&
+            std::all_of(heldByB.begin(), heldByB.end(), [OwnerB](uint8_t* p) { return IsMarked(p, OwnerB); }),
+            "a held sublock was overwritten",
+            passed
+            );
+
+        //
+        // The same handover, both threads running at once. B frees each
+        // sublock A passes it, and A also churns its own set in between.
+        // B's sublocks stay put, and it checks them as it goes.
+        //
+        std::mutex mutex;
+        std::condition_variable handedOverReady;
+        std::deque<uint8_t*> queue;
+        bool done = false;
+
+        std::thread freer([&]()
+        {
+            for (;;)
+            {
+                uint8_t* pSublock;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    handedOverReady.wait(lock, [&]() { return done || !queue.empty(); });
+                    if (queue.empty())
+                    {
+                        break;
+                    }
+
+                    pSublock = queue.front();
+                    queue.pop_front();
+                }
+
+                Check(IsMarked(pSublock, OwnerA), "a sublock changed before the other thread freed it", passed);
+                pool.Free(pSublock);
+
+                const size_t Index = reinterpret_cast<size_t>(pSublock) / SUBLOCK_SIZE % heldByB.size();
+                Check(IsMarked(heldByB[Index], OwnerB), "a held sublock was overwritten", passed);
+            }
+        });
+
+        std::mt19937 random(OwnerA);
+        for (size_t i = 0; i < Count * 10; i++)
+        {
+            uint8_t* pSublock = pool.Allocate();
+            Mark(pSublock, OwnerA);
+
+            const size_t Index = random() % heldByA.size();
+            Check(IsMarked(heldByA[Index], OwnerA), "a held sublock was overwritten", passed);
+            pool.Free(heldByA[Index]);
+            heldByA[Index] = pool.Allocate();
+            Mark(heldByA[Index], OwnerA);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(pSublock);
+            handedOverReady.notify_one();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+            handedOverReady.notify_one();
+        }
+
+        freer.join();
+
+        for (uint8_t* pSublock : heldByA)
+        {
+            pool.Free(pSublock);
+        }
+
+        for (uint8_t* pSublock : heldByB)
+        {
+            pool.Free(pSublock);
+        }
+
+        std::cout << (passed ? "Passed" : "Failed") << ": " << pool.GetCacheHits() << " cache hits, " << pool.GetCacheRefills()
+                  << " refills, " << pool.GetCacheFlushes() << " flushes" << std::endl;
+        return passed ? 0 : -1;
+    }
+}
@@ -0,0 +1,224 @@
+#include "Benchmark.h"
+#include "Baseline/CoordinateTypeHash.h"
+
+#include <GameOfLife/TileLookup.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+namespace Benchmarks
+{
+    namespace
+    {
+        const int64_t TILE_SIZE = 30;
+
+        //
+        // Counts the bytes a container asks for, not including the
+        // allocator's own headers.
+        //
+        size_t g_allocatedBytes = 0;
+
+        template <typename T>
+        struct CountingAllocator
+        {
+            typedef T value_type;
+
+            CountingAllocator() {}
+            template <typename U> CountingAllocator(const CountingAllocator<U>&) {}
+
+            T* allocate(size_t count)
+            {
+                g_allocatedBytes += count * sizeof(T);
+                return static_cast<T*>(::operator new(count * sizeof(T)));
+            }
+
+            void deallocate(T* p, size_t count)
+            {
+                g_allocatedBytes -= count * sizeof(T);
+                ::operator delete(p);
+            }
+
+            template <typename U> bool operator==(const CountingAllocator<U>&) const { return true; }
+            template <typename U> bool operator!=(const CountingAllocator<U>&) const { return false; }
+        };
+
+        typedef std::unordered_map<
+            GameOfLife::CoordinateType,
+            int*,
+            std::hash<GameOfLife::CoordinateType>,
+            std::equal_to<GameOfLife::CoordinateType>,
+            CountingAllocator<std::pair<const GameOfLife::CoordinateType, int*>>
+            > BaselineMap;
+
+        typedef GameOfLife::TileLookup<int, TILE_SIZE, TILE_SIZE> Lookup;
+
+        //
+        // Adapters so both tables can be measured by the same code.
+        //
+        void Insert(BaselineMap& map, const GameOfLife::CoordinateType& key, int* pValue) { map[key] = pValue; }
+        void Insert(Lookup& lookup, const GameOfLife::CoordinateType& key, int* pValue) { lookup.Insert(key, pValue); }
+
+        bool Contains(const BaselineMap& map, const GameOfLife::CoordinateType& key) { return map.find(key) != map.end(); }
+        bool Contains(const Lookup& lookup, const GameOfLife::CoordinateType& key) { return lookup.Find(key) != nullptr; }
+
+        bool Erase(BaselineMap& map, const GameOfLife::CoordinateType& key) { return map.erase(key) == 1; }
+        bool Erase(Lookup& lookup, const GameOfLife::CoordinateType& key) { return lookup.Erase(key); }
+
+        size_t GetMemoryUsage(const BaselineMap&) { return g_allocatedBytes; }
+        size_t GetMemoryUsage(const Lookup& lookup) { return lookup.GetMemoryUsage(); }
+
+        //
+        // Inserts every key, looks up probes numRounds times, then erases
+        // every key, and reports each step. Returns false if the lookups or
+        // erasures didn't find what they should have.
+        //
+        template <typename Table>
+        bool Measure(
+            const char* name,
+            const std::vector<GameOfLife::CoordinateType>& keys,
+            const std::vector<GameOfLife::CoordinateType>& probes,
+            int64_t numRounds,
+            size_t expectedHits
+            )
+        {
+            int value = 0;
+            Table table;
+
+            Stopwatch stopwatch;
+            for (const GameOfLife::CoordinateType& key : keys)
+            {
+                Insert(table, key, &value);
+            }
+
+            const double InsertMilliseconds = stopwatch.GetMilliseconds();
+            const size_t Bytes = GetMemoryUsage(table);
+
+            size_t hits = 0;
+            stopwatch.Restart();
+            for (int64_t round = 0; round < numRounds; round++)
+            {
+                for (const GameOfLife::CoordinateType& probe : probes)
+                {
+                    hits += Contains(table, probe);
+                }
+            }
+
+            const double LookupMilliseconds = stopwatch.GetMilliseconds();
+
+            bool allErased = true;
+            stopwatch.Restart();
+            for (const GameOfLife::CoordinateType& key : keys)
+            {
+                allErased = Erase(table, key) && allErased;
+            }
+
+            const double EraseMilliseconds = stopwatch.GetMilliseconds();
+
+            std::cout << name << "\t" << InsertMilliseconds << "\t"
+                      << LookupMilliseconds * 1e6 / (numRounds * probes.size()) << "\t"
+                      << EraseMilliseconds << "\t"
+                      << double(Bytes) / keys.size() << std::endl;
+
+            return allErased && hits == expectedHits * numRounds;
+        }
+    }
+
+    //
+    // Tile lookup latency and memory of TileLookup against the
+    // std::unordered_map and hash SubGridGraph used before it. Tiles are
+    // laid out in a square block, as in a dense soup, and then scattered at
+    // random, as in a sparse world. Looks up all 8 neighbors of every tile
+    // in random order, as linking a subgrid's neighbors does.
+    //
+    // The baseline's bytes per tile count what it asks the allocator for,
+    // not the allocator's own per-node headers, which add roughly 16 more.
+    //
+    // Options: --tiles=<n> (default 1000000), --rounds=<n> passes over the
+    // lookups (default 4), --seed (default 1).
+    //
+    int RunTileLookupLatency(const Options& options)
+    {
+        const size_t NumTiles = static_cast<size_t>(options.GetInt("tiles", 1000000));
+        const int64_t NumRounds = options.GetInt("rounds", 4);
+        std::mt19937_64 random(static_cast<uint64_t>(options.GetInt("seed", 1)));
+
+        bool passed = true;
+        const char* Layouts[] = { "block", "scattered" };
+        for (const char* layout : Layouts)
+        {
+            std::vector<GameOfLife::CoordinateType> keys;
+            if (layout == Layouts[0])
+            {
+                const int64_t Side = static_cast<int64_t>(std::ceil(std::sqrt(double(NumTiles))));
+                for (size_t i = 0; i < NumTiles; i++)
+                {
+                    keys.emplace_back(
+                        (static_cast<int64_t>(i) % Side - Side / 2) * TILE_SIZE,
+                        (static_cast<int64_t>(i) / Side - Side / 2) * TILE_SIZE
+                        );
+                }
+            }
+            else
+            {
+                const int64_t Range = 200 * static_cast<int64_t>(std::sqrt(double(NumTiles))) + 1;
+                while (keys.size() < NumTiles)
+                {
+                    keys.emplace_back(
+                        (static_cast<int64_t>(random() % Range) - Range / 2) * TILE_SIZE,
+                        (static_cast<int64_t>(random() % Range) - Range / 2) * TILE_SIZE
+                        );
+                }
+
+                std::sort(keys.begin(), keys.end());
+                keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            }
+
+            std::shuffle(keys.begin(), keys.end(), random);
+
+            std::vector<GameOfLife::CoordinateType> probes;
+            probes.reserve(keys.size() * 8);
+            for (const GameOfLife::CoordinateType& key : keys)
+            {
+                for (int64_t dy = -1; dy <= 1; dy++)
+                {
+                    for (int64_t dx = -1; dx <= 1; dx++)
+                    {
+                        if (dx || dy)
+                        {
+                            probes.emplace_back(key.first + dx * TILE_SIZE, key.second + dy * TILE_SIZE);
+                        }
+                    }
+                }
+            }
+
+            //
+            // Count the hits once up front, so both tables can be checked
+            // against it.
+            //
+            std::vector<GameOfLife::CoordinateType> sortedKeys(keys);
+            std::sort(sortedKeys.begin(), sortedKeys.end());
+            size_t expectedHits = 0;
+            for (const GameOfLife::CoordinateType& probe : probes)
+            {
+                expectedHits += std::binary_search(sortedKeys.begin(), sortedKeys.end(), probe);
+            }
+
+            std::cout << keys.size() << " tiles, " << layout << ", " << expectedHits << " of " << probes.size() << " neighbors present" << std::endl
+                      << "table\tinsert ms\tns/lookup\terase ms\tbytes/tile" << std::endl;
+
+            passed = Measure<BaselineMap>("baseline", keys, probes, NumRounds, expectedHits) && passed;
+            passed = Measure<Lookup>("TileLookup", keys, probes, NumRounds, expectedHits) && passed;
+        }
+
+        if (!passed)
+        {
+            std::cerr << "A table lost or made up tiles." << std::endl;
+            return -1;
+        }
+
+        return 0;
+    }
+}
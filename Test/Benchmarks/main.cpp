@@ -0,0 +1,70 @@
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Benchmark.h"
+
+namespace
+{
+    struct BenchmarkEntry
+    {
+        const char* Name;
+        const char* Description;
+        int (*Run)(const Benchmarks::Options& options);
+    };
+
+    const BenchmarkEntry Entries[] =
+    {
+        { "alloc", "AlignedMemoryPool throughput against the pool it replaced", Benchmarks::RunAllocationThroughput },
+        { "alloc-threads", "AlignedMemoryPool stress on several threads, with and without thread caches", Benchmarks::RunThreadedAllocation },
+        { "alloc-cross-thread", "Test: sublocks freed on another thread than allocated them", Benchmarks::RunCrossThreadFreeTest },
+        { "halo", "SparseGrid step time at halo depths 1, 2, 4 and 8", Benchmarks::RunHaloDepthSweep },
+        { "lookup", "TileLookup latency and memory against the map it replaced", Benchmarks::RunTileLookupLatency },
+        { "order", "SparseGrid step time in Hilbert against row-major order", Benchmarks::RunScheduleOrderComparison },
+    };
+
+    void PrintUsage(const std::string& programName)
+    {
+        std::cerr << "Usage: " << programName << " <benchmark> [--name=value...]" << std::endl
+                  << "Benchmarks:" << std::endl;
+        for (const BenchmarkEntry& entry : Entries)
+        {
+            std::cerr << "  " << entry.Name << "\t" << entry.Description << std::endl;
+        }
+
+        std::cerr << "Each benchmark's options are described in its source file." << std::endl;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
+
+    const std::string Name(argv[1]);
+    for (const BenchmarkEntry& entry : Entries)
+    {
+        if (Name != entry.Name)
+        {
+            continue;
+        }
+
+        try
+        {
+            return entry.Run(Benchmarks::Options(std::vector<std::string>(argv + 2, argv + argc)));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    PrintUsage(argv[0]);
+    return -1;
+}
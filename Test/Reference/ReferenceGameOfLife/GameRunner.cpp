@@ -49,9 +49,13 @@ namespace GoLReference
     // Internal state representation
     //
 
-    GameRunner::GameRunner(const InitialState& initialState) : m_pCurrentState(nullptr)
+    GameRunner::GameRunner(
+        const InitialState& initialState,
+        int64_t tileSize,
+        const GameOfLife::Rule& rule
+        ) : m_pCurrentState(nullptr), m_rule(rule)
     {
-        m_spStates[0].reset(new State(initialState));
+        m_spStates[0].reset(new State(initialState, tileSize));
         m_spStates[1].reset(
             new State(
                 m_spStates[0]->XMin(),
@@ -75,27 +79,13 @@ namespace GoLReference
             for (int64_t x = xMin; x < xMin + m_pCurrentState->Width(); ++x)
             {
                 const uint8_t NumNeighbors = CountNeighbors(*m_pCurrentState, x, y);
-                if (m_pCurrentState->GetCellState(x, y))
+                if (m_rule.IsAliveNext(m_pCurrentState->GetCellState(x, y), NumNeighbors))
                 {
-                    if (NumNeighbors < 2 || NumNeighbors > 3)
-                    {
-                        pOtherBuffer->KillCell(x, y);
-                    }
-                    else
-                    {
-                        pOtherBuffer->RaiseCell(x, y);
-                    }
+                    pOtherBuffer->RaiseCell(x, y);
                 }
                 else
                 {
-                    if (NumNeighbors == 3)
-                    {
-                        pOtherBuffer->RaiseCell(x, y);
-                    }
-                    else
-                    {
-                        pOtherBuffer->KillCell(x, y);
-                    }
+                    pOtherBuffer->KillCell(x, y);
                 }
             }
         }
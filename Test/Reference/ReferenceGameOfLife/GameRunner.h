@@ -7,6 +7,8 @@
 #include "State.h"
 #include "InitialState.h"
 
+#include <GameOfLife/Rule.h>
+
 namespace GoLReference
 {
     //
@@ -15,7 +17,11 @@ namespace GoLReference
     class GameRunner
     {
     public:
-        GameRunner(const InitialState& state);
+        GameRunner(
+            const InitialState& state,
+            int64_t tileSize,
+            const GameOfLife::Rule& rule = GameOfLife::Rule()
+            );
         ~GameRunner() = default;
 
         //
@@ -42,5 +48,7 @@ namespace GoLReference
         // TODO: Pimpl
         std::unique_ptr<State> m_spStates[2];
         State* m_pCurrentState;
+
+        GameOfLife::Rule m_rule;
     };
 }
\ No newline at end of file
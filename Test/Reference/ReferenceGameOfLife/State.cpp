@@ -39,7 +39,7 @@ namespace
 
 namespace GoLReference
 {
-    State::State(const InitialState & initialCells)
+    State::State(const InitialState & initialCells, int64_t tileSize)
         : m_xMin(std::numeric_limits<int64_t>::max()),
           m_yMin(std::numeric_limits<int64_t>::max()),
           m_generation(0)
@@ -72,22 +72,17 @@ namespace GoLReference
             }
         }
 
-        //
-        // TODO: Include subgrid.h and use those dimensions, once
-        // projects are merged.
-        //
-
         //
         // Snap state to subgrid boundaries.
         //
-        using SubGrid = GameOfLife::SubGrid;
-        m_xMin = SubGrid::SnapCoordinateToSubgridCorner(m_xMin, SubGrid::SUBGRID_WIDTH);
-        m_yMin = SubGrid::SnapCoordinateToSubgridCorner(m_yMin, SubGrid::SUBGRID_HEIGHT);
-
-        xMax = SubGrid::SnapCoordinateToSubgridCorner(xMax, SubGrid::SUBGRID_WIDTH);
-        xMax += SubGrid::SUBGRID_WIDTH;
-        yMax = SubGrid::SnapCoordinateToSubgridCorner(yMax, SubGrid::SUBGRID_HEIGHT);
-        yMax += SubGrid::SUBGRID_HEIGHT;
+        using GameOfLife::SnapCoordinateToSubgridCorner;
+        m_xMin = SnapCoordinateToSubgridCorner(m_xMin, tileSize);
+        m_yMin = SnapCoordinateToSubgridCorner(m_yMin, tileSize);
+
+        xMax = SnapCoordinateToSubgridCorner(xMax, tileSize);
+        xMax += tileSize;
+        yMax = SnapCoordinateToSubgridCorner(yMax, tileSize);
+        yMax += tileSize;
 
         m_width = xMax - m_xMin;
         m_height = yMax - m_yMin;
@@ -15,7 +15,11 @@ namespace GoLReference
     class State
     {
     public:
-        State(const InitialState& initialState);
+        //
+        // World bounds are snapped to multiples of tileSize so that they
+        // match those of a GameOfLife::SparseGrid with the same subgrid size.
+        //
+        State(const InitialState& initialState, int64_t tileSize);
         State(int64_t xmin, int64_t width, int64_t ymin, int64_t height);
 
         ~State() = default;
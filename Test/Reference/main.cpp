@@ -10,18 +10,44 @@
 
 void PrintUsage(const std::string& programName)
 {
-    std::cerr << "Usage: " << programName << " <filepath to initial state> <# generations> <output path>" << std::endl;
+    std::cerr << "Usage: " << programName << " [--rule=<B/S>] <filepath to initial state> <# generations> <output path> [subgrid size]" << std::endl;
 }
 
 int main(int argc, char** argv)
 {
-    if (argc < 4)
+    //
+    // Pull out the rule option, if any; everything else is positional.
+    //
+    GameOfLife::Rule rule;
+    std::vector<std::string> args;
+    for (int i = 0; i < argc; i++)
+    {
+        const std::string Arg(argv[i]);
+        if (Arg.compare(0, 7, "--rule=") != 0)
+        {
+            args.push_back(Arg);
+            continue;
+        }
+
+        try
+        {
+            rule = GameOfLife::Rule::Parse(Arg.substr(7));
+        }
+        catch (const std::exception& e)
+        {
+            std::cerr << e.what() << std::endl;
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    if (args.size() < 4)
     {
         PrintUsage(argv[0]);
         return -1;
     }
 
-    const std::string filename(argv[1]);
+    const std::string filename(args[1]);
     std::ifstream in(filename);
     if (!in.good())
     {
@@ -29,8 +55,19 @@ int main(int argc, char** argv)
         return -1;
     }
 
-    int32_t generationsRemaining = atoi(argv[2]);
-    std::string outputFilename(argv[3]);
+    int32_t generationsRemaining = atoi(args[2].c_str());
+    std::string outputFilename(args[3]);
+
+    //
+    // Must match the subgrid size the implementation under test was run
+    // with, since it determines the world bounds.
+    //
+    const int64_t tileSize = args.size() > 4 ? atoi(args[4].c_str()) : 30;
+    if (tileSize <= 0)
+    {
+        PrintUsage(argv[0]);
+        return -1;
+    }
 
     GoLReference::InitialState state;
 
@@ -42,7 +79,7 @@ int main(int argc, char** argv)
         state.emplace_back(cellX, cellY, false);
     }
 
-    GoLReference::GameRunner runner(state);
+    GoLReference::GameRunner runner(state, tileSize, rule);
 
     GoLReference::FileStateRenderer renderer(outputFilename);
     do
@@ -0,0 +1,179 @@
+from generate_gol_primitives import generate_primitive, primitives_dict
+
+import random as rd
+import subprocess
+import tempfile
+import sys
+import os
+
+import shutil
+
+DEFAULT_NUM_TESTS=10
+DEFAULT_NUM_GENERATIONS=100
+
+#
+# The reference implementation processes every cell in the world's bounding
+# box, so it can't run worlds whose living cells are far apart. Instead, these
+# tests check the test target against itself: moving every cell by the same
+# offset must move every later generation by that offset too.
+#
+# The world is toroidal, with bounds snapped to the tile grid, so offsets are
+# multiples of every tile size in use (30, 62, 126 and Hashlife's 64). Cluster
+# positions and offsets are kept well inside the int64 range so the moved
+# world's bounding box still fits.
+#
+TRANSLATION_STRIDE=624960
+DEFAULT_RANGE_CLUSTER=(-(1 << 60), 1 << 60)
+DEFAULT_RANGE_OFFSET=(-(1 << 60) // TRANSLATION_STRIDE, (1 << 60) // TRANSLATION_STRIDE)
+DEFAULT_NUM_CLUSTERS=(2, 4)
+DEFAULT_PRIMITIVES_PER_CLUSTER=(5, 40)
+DEFAULT_WIDTH=100
+DEFAULT_HEIGHT=100
+
+#
+# Cluster origins for the first test, which every run includes. More than two
+# billion tiles apart, which the tile lookup once failed on.
+#
+FIXED_CLUSTERS=[(0, 0), (64424509440, 0)]
+
+#
+# GolFarApartTest:
+# 1) Generates random GoL primitives in a few clusters scattered over the world
+#    into a config file, and the same cells moved by a random offset into a
+#    second one.
+# 2) Runs the test target on both and checks that each generation of the second
+#    is the first moved by the offset.
+#
+class GolFarApartTest:
+    #
+    # testtarget_exe: "real" GoL implementation
+    # num_tests: Number of tests to run
+    # extra_args: Passed through to the test target after the output file
+    #
+    def __init__(self, testtarget_exe, num_tests, extra_args):
+        assert(os.path.isfile(testtarget_exe))
+        self.testtarget_exe = testtarget_exe
+        self.num_tests      = num_tests
+        self.extra_args     = extra_args
+
+    def generate_cells(self, clusters):
+        cells = []
+        for xmin,ymin in clusters:
+            num_primitives = rd.randrange(*DEFAULT_PRIMITIVES_PER_CLUSTER)
+            for primitive_index in range(num_primitives):
+                primitive_key = rd.choice(primitives_dict.keys())
+
+                x = rd.randrange(xmin, xmin + DEFAULT_WIDTH)
+                y = rd.randrange(ymin, ymin + DEFAULT_HEIGHT)
+                rotations = rd.randrange(1, 4)
+
+                cells.extend(generate_primitive(primitive_key, x, y, rotations))
+
+        return cells
+
+    def write_cells(self, path, cells, dx, dy):
+        with open(path, 'w') as fw:
+            for x,y in cells:
+                fw.write("({0},{1})\n".format(x + dx, y + dy))
+
+    #
+    # Returns the world bounds and set of living cells of every generation in
+    # the test target's output.
+    #
+    def read_generations(self, path):
+        generations = []
+        with open(path, 'r') as handle:
+            while True:
+                first_line = handle.readline()
+                if not first_line:
+                    break
+
+                # Expected format: (xmin,ymin,width,height), then the generation
+                # and the number of tiles, then each tile in the same format.
+                bounds = tuple(int(d) for d in first_line.strip().strip('()').split(','))
+                handle.readline()
+                num_tiles = int(handle.readline())
+
+                living = set()
+                for tile_index in range(num_tiles):
+                    xmin,ymin,width,height = [int(d) for d in handle.readline().strip().strip('()').split(',')]
+                    for y in range(height):
+                        row = handle.readline().strip().split(',')
+                        for x in range(width):
+                            if row[x] == '1':
+                                living.add((xmin + x, ymin + y))
+
+                generations.append((bounds, living))
+
+        return generations
+
+    def run_target(self, input_file, output_file):
+        args = [self.testtarget_exe, input_file, str(DEFAULT_NUM_GENERATIONS), output_file] + self.extra_args
+        return subprocess.call(args) == 0 and os.path.isfile(output_file)
+
+    def run_test(self, test_index):
+        if test_index == 0:
+            clusters = FIXED_CLUSTERS
+        else:
+            num_clusters = rd.randrange(*DEFAULT_NUM_CLUSTERS)
+            clusters = [(rd.randrange(*DEFAULT_RANGE_CLUSTER), rd.randrange(*DEFAULT_RANGE_CLUSTER)) for i in range(num_clusters)]
+
+        dx = rd.randrange(*DEFAULT_RANGE_OFFSET) * TRANSLATION_STRIDE
+        dy = rd.randrange(*DEFAULT_RANGE_OFFSET) * TRANSLATION_STRIDE
+
+        temp_dir = tempfile.mkdtemp()
+        input_file = os.path.join(temp_dir, "input.txt")
+        moved_input_file = os.path.join(temp_dir, "moved_input.txt")
+        output_file = os.path.join(temp_dir, "output.txt")
+        moved_output_file = os.path.join(temp_dir, "moved_output.txt")
+
+        cells = self.generate_cells(clusters)
+        self.write_cells(input_file, cells, 0, 0)
+        self.write_cells(moved_input_file, cells, dx, dy)
+
+        failure = None
+        if not self.run_target(input_file, output_file) or not self.run_target(moved_input_file, moved_output_file):
+            failure = "test target failed"
+        else:
+            generations = self.read_generations(output_file)
+            moved_generations = self.read_generations(moved_output_file)
+            if len(generations) != len(moved_generations):
+                failure = "{0} generations, but {1} once moved".format(len(generations), len(moved_generations))
+
+            for generation_index in range(len(generations)):
+                if failure:
+                    break
+
+                bounds,living = generations[generation_index]
+                moved_bounds,moved_living = moved_generations[generation_index]
+                expected_bounds = (bounds[0] + dx, bounds[1] + dy, bounds[2], bounds[3])
+                expected_living = set((x + dx, y + dy) for x,y in living)
+                if moved_bounds != expected_bounds or moved_living != expected_living:
+                    failure = "generation {0} differs once moved".format(generation_index)
+
+        if failure:
+            print "{0}: Failed! {1}; offset ({2},{3}), input files are in {4}".format(test_index, failure, dx, dy, temp_dir)
+            exit(-1)
+        else:
+            print "{0}: Succeeded".format(test_index)
+
+        shutil.rmtree(temp_dir)
+
+    def run_tests(self):
+        for test_index in range(self.num_tests):
+            self.run_test(test_index)
+
+def print_usage(program_name):
+    print "Usage: python {0} <testtarget_exe> [num_tests={1}] [testtarget_args...]".format(program_name, DEFAULT_NUM_TESTS)
+
+if __name__=="__main__":
+    if len(sys.argv) < 2:
+        print_usage(sys.argv[0])
+        exit(-1)
+
+    testtarget_exe = sys.argv[1]
+    num_tests = int(sys.argv[2]) if len(sys.argv) > 2 else DEFAULT_NUM_TESTS
+    extra_args = sys.argv[3:]
+
+    test = GolFarApartTest(testtarget_exe, num_tests, extra_args)
+    test.run_tests()